@@ -5,33 +5,530 @@
 #include "functor.hpp"
 #include "numeric.hpp"
 #include "memory.hpp"
+#include "heap.hpp"
+#include "pair.hpp"
+#include "simd.hpp"
 
 __STLL_NAMESPACE_START__
 
 
-template <typename InputIterator1, typename InputIterator2, typename Pred>
-bool lexicographical_compare(
-        InputIterator1 first1, InputIterator1 last1,
-        InputIterator2 first2, InputIterator2 last2,
-        const Pred& pred) {
+namespace
+{
 
-    while (first1 != last1 && first2 != last2) {
-        if (pred(*first1, *first2))
-            return true;
-        else if (*first1 != *first2)
+// Compares the elements with a value, for find.
+template <typename Tp>
+struct __equal_value {
+    const Tp&   value;
+
+    explicit __equal_value(const Tp& value)
+        :value(value)
+    {}
+
+    template <typename Value>
+    bool operator()(const Value& x) const {
+        return x == value;
+    }
+};
+
+template <typename InputIterator, typename Predicate>
+inline InputIterator __find_if(InputIterator first, InputIterator last,
+                               Predicate pred, input_iterator_tag) {
+    while (first != last && !pred(*first))
+        ++first;
+    return first;
+}
+
+// Unrolled four times: one test of trip_count per four elements instead of
+// one test of first != last per element.
+template <typename RandomAccessIterator, typename Predicate>
+RandomAccessIterator __find_if(RandomAccessIterator first,
+                               RandomAccessIterator last,
+                               Predicate pred, random_access_iterator_tag) {
+    typename iterator_traits<RandomAccessIterator>::difference_type
+        trip_count = (last - first) >> 2;
+
+    for (; trip_count > 0; --trip_count) {
+        if (pred(*first))
+            return first;
+        ++first;
+        if (pred(*first))
+            return first;
+        ++first;
+        if (pred(*first))
+            return first;
+        ++first;
+        if (pred(*first))
+            return first;
+        ++first;
+    }
+
+    switch (last - first) {
+    case 3:
+        if (pred(*first))
+            return first;
+        ++first;
+        /* fall through */
+    case 2:
+        if (pred(*first))
+            return first;
+        ++first;
+        /* fall through */
+    case 1:
+        if (pred(*first))
+            return first;
+        ++first;
+        /* fall through */
+    default:
+        return last;
+    }
+}
+
+template <typename InputIterator, typename Tp>
+inline InputIterator __find(InputIterator first, InputIterator last,
+                            const Tp& value, false_type) {
+    return __find_if(first, last, __equal_value<Tp>(value),
+                     iterator_category(first));
+}
+
+template <typename Value, typename Tp>
+inline Value* __find_contiguous(Value* first, Value* last, const Tp& value,
+                                false_type) {
+    return __find_if(first, last, __equal_value<Tp>(value),
+                     random_access_iterator_tag());
+}
+
+#ifdef __STLL_SIMD__
+template <typename Value, typename Tp>
+inline Value* __find_contiguous(Value* first, Value* last, const Tp& value,
+                                true_type) {
+    return first + (__simd_find<Tp>(first, last, value) - first);
+}
+#endif
+
+// A contiguous range of the type of value is searched with SIMD.
+template <typename Value, typename Tp>
+inline Value* __find(Value* first, Value* last, const Tp& value,
+                     false_type) {
+    typedef typename simd_reduce_traits<Value, Tp>::vectorizable
+            vectorizable;
+    return __find_contiguous(first, last, value, vectorizable());
+}
+
+// Search a segmented range (deque) one segment at a time.
+template <typename InputIterator, typename Tp>
+InputIterator __find(InputIterator first, InputIterator last,
+                     const Tp& value, true_type) {
+    typedef segmented_iterator_traits<InputIterator> traits;
+    typedef typename traits::local_iterator local_iterator;
+
+    typename traits::segment_iterator seg_first = traits::segment(first);
+    typename traits::segment_iterator seg_last = traits::segment(last);
+    if (seg_first == seg_last) {
+        local_iterator pos = __find(traits::local(first), traits::local(last),
+                                    value, false_type());
+        return traits::compose(seg_first, pos);
+    }
+
+    local_iterator pos = __find(traits::local(first), traits::end(seg_first),
+                                value, false_type());
+    if (pos != traits::end(seg_first))
+        return traits::compose(seg_first, pos);
+    for (++seg_first; seg_first != seg_last; ++seg_first) {
+        pos = __find(traits::begin(seg_first), traits::end(seg_first),
+                     value, false_type());
+        if (pos != traits::end(seg_first))
+            return traits::compose(seg_first, pos);
+    }
+    pos = __find(traits::begin(seg_last), traits::local(last),
+                 value, false_type());
+    return traits::compose(seg_last, pos);
+}
+
+}
+
+template <typename InputIterator, typename Tp>
+InputIterator find(InputIterator first, InputIterator last, const Tp& value) {
+    typedef typename segmented_iterator_traits<InputIterator>
+            ::is_segmented_iterator segmented;
+    return __find(first, last, value, segmented());
+}
+
+template <typename InputIterator, typename Predicate>
+inline InputIterator find_if(InputIterator first, InputIterator last,
+                             Predicate pred) {
+    return __find_if(first, last, pred, iterator_category(first));
+}
+
+
+namespace
+{
+
+template <typename InputIterator, typename Tp>
+typename iterator_traits<InputIterator>::difference_type
+__count(InputIterator first, InputIterator last, const Tp& value,
+        false_type) {
+    typename iterator_traits<InputIterator>::difference_type n = 0;
+    for (; first != last; ++first) {
+        if (*first == value)
+            ++n;
+    }
+    return n;
+}
+
+template <typename Value, typename Tp>
+inline ptrdiff_t __count_contiguous(Value* first, Value* last,
+                                    const Tp& value, false_type) {
+    ptrdiff_t n = 0;
+    for (; first != last; ++first) {
+        if (*first == value)
+            ++n;
+    }
+    return n;
+}
+
+#ifdef __STLL_SIMD__
+template <typename Value, typename Tp>
+inline ptrdiff_t __count_contiguous(Value* first, Value* last,
+                                    const Tp& value, true_type) {
+    return ptrdiff_t(__simd_count<Tp>(first, last, value));
+}
+#endif
+
+template <typename Value, typename Tp>
+inline ptrdiff_t __count(Value* first, Value* last, const Tp& value,
+                         false_type) {
+    typedef typename simd_reduce_traits<Value, Tp>::vectorizable
+            vectorizable;
+    return __count_contiguous(first, last, value, vectorizable());
+}
+
+// Count in a segmented range (deque) one segment at a time.
+template <typename InputIterator, typename Tp>
+typename iterator_traits<InputIterator>::difference_type
+__count(InputIterator first, InputIterator last, const Tp& value,
+        true_type) {
+    typedef segmented_iterator_traits<InputIterator> traits;
+
+    typename traits::segment_iterator seg_first = traits::segment(first);
+    typename traits::segment_iterator seg_last = traits::segment(last);
+    if (seg_first == seg_last) {
+        return __count(traits::local(first), traits::local(last), value,
+                       false_type());
+    }
+
+    typename iterator_traits<InputIterator>::difference_type n =
+        __count(traits::local(first), traits::end(seg_first), value,
+                false_type());
+    for (++seg_first; seg_first != seg_last; ++seg_first) {
+        n += __count(traits::begin(seg_first), traits::end(seg_first), value,
+                     false_type());
+    }
+    return n + __count(traits::begin(seg_last), traits::local(last), value,
+                       false_type());
+}
+
+}
+
+template <typename InputIterator, typename Tp>
+inline typename iterator_traits<InputIterator>::difference_type
+count(InputIterator first, InputIterator last, const Tp& value) {
+    typedef typename segmented_iterator_traits<InputIterator>
+            ::is_segmented_iterator segmented;
+    return __count(first, last, value, segmented());
+}
+
+template <typename InputIterator, typename Predicate>
+typename iterator_traits<InputIterator>::difference_type
+count_if(InputIterator first, InputIterator last, Predicate pred) {
+    typename iterator_traits<InputIterator>::difference_type n = 0;
+    for (; first != last; ++first) {
+        if (pred(*first))
+            ++n;
+    }
+    return n;
+}
+
+
+template <typename InputIterator1, typename InputIterator2,
+          typename BinaryPredicate>
+pair<InputIterator1, InputIterator2>
+mismatch(InputIterator1 first1, InputIterator1 last1,
+         InputIterator2 first2, BinaryPredicate pred) {
+    while (first1 != last1 && pred(*first1, *first2)) {
+        ++first1;
+        ++first2;
+    }
+    return make_pair(first1, first2);
+}
+
+template <typename InputIterator1, typename InputIterator2,
+          typename BinaryPredicate>
+bool equal(InputIterator1 first1, InputIterator1 last1,
+           InputIterator2 first2, BinaryPredicate pred) {
+    for (; first1 != last1; ++first1, ++first2) {
+        if (!pred(*first1, *first2))
             return false;
     }
-    return first1 == last1;
+    return true;
 }
 
-template <typename InputIterator1, typename InputIterator2, typename Pred>
+template <typename InputIterator1, typename InputIterator2, typename Compare>
 bool lexicographical_compare(InputIterator1 first1, InputIterator1 last1,
-                            InputIterator2 first2, InputIterator2 last2) {
+                             InputIterator2 first2, InputIterator2 last2,
+                             Compare comp) {
+    for (; first1 != last1 && first2 != last2; ++first1, ++first2) {
+        if (comp(*first1, *first2))
+            return true;
+        if (comp(*first2, *first1))
+            return false;
+    }
+    return first1 == last1 && first2 != last2;
+}
+
+namespace
+{
+
+template <typename InputIterator1, typename InputIterator2>
+pair<InputIterator1, InputIterator2>
+__mismatch(InputIterator1 first1, InputIterator1 last1,
+           InputIterator2 first2, false_type) {
+    while (first1 != last1 && *first1 == *first2) {
+        ++first1;
+        ++first2;
+    }
+    return make_pair(first1, first2);
+}
+
+template <typename InputIterator1, typename InputIterator2>
+bool __equal(InputIterator1 first1, InputIterator1 last1,
+             InputIterator2 first2, false_type, false_type) {
+    for (; first1 != last1; ++first1, ++first2) {
+        if (!(*first1 == *first2))
+            return false;
+    }
+    return true;
+}
+
+template <typename InputIterator1, typename InputIterator2>
+inline bool __lexicographical_compare(InputIterator1 first1,
+                                      InputIterator1 last1,
+                                      InputIterator2 first2,
+                                      InputIterator2 last2, false_type) {
     typedef typename iterator_traits<InputIterator1>::value_type value_type;
+    return STLL_NAMESPACE::lexicographical_compare(first1, last1,
+                                                   first2, last2,
+                                                   less<value_type>());
+}
+
+#ifdef __STLL_SIMD__
+template <typename Pointer1, typename Pointer2>
+inline pair<Pointer1, Pointer2> __mismatch(Pointer1 first1, Pointer1 last1,
+                                           Pointer2 first2, true_type) {
+    typedef typename iterator_traits<Pointer1>::value_type Tp;
+    ptrdiff_t n = __simd_mismatch<Tp>(first1, last1, first2) - first1;
+    return make_pair(first1 + n, first2 + n);
+}
+
+// Integers are equal when their bytes are.
+template <typename Pointer1, typename Pointer2>
+inline bool __equal(Pointer1 first1, Pointer1 last1, Pointer2 first2,
+                    true_type, true_type) {
+    return __simd_equal_bytes(first1, last1, first2);
+}
 
-    return lexicographical_compare(first1, last1,
-                                   first2, last2,
-                                   less<value_type>());
+// Floating point numbers are not: 0.0 == -0.0 and NaN != NaN.
+template <typename Pointer1, typename Pointer2>
+inline bool __equal(Pointer1 first1, Pointer1 last1, Pointer2 first2,
+                    true_type, false_type) {
+    typedef typename iterator_traits<Pointer1>::value_type Tp;
+    return __simd_mismatch<Tp>(first1, last1, first2) == last1;
+}
+
+// The first difference of two ranges of integers decides; there is none
+// for floating point numbers, a NaN is neither less nor greater.
+template <typename Pointer1, typename Pointer2>
+bool __lexicographical_compare(Pointer1 first1, Pointer1 last1,
+                               Pointer2 first2, Pointer2 last2, true_type) {
+    typedef typename iterator_traits<Pointer1>::value_type Tp;
+    bool shorter = last1 - first1 < last2 - first2;
+    Pointer1 end1 = shorter ? last1 : first1 + (last2 - first2);
+    ptrdiff_t n = __simd_mismatch<Tp>(first1, end1, first2) - first1;
+    if (first1 + n != end1)
+        return first1[n] < first2[n];
+    return shorter;
+}
+#endif
+
+}
+
+/*
+ * mismatch, equal and lexicographical_compare compare contiguous ranges of
+ * one arithmetic type with SIMD, equal compares ranges of integers with
+ * memcmp.
+ */
+template <typename InputIterator1, typename InputIterator2>
+inline pair<InputIterator1, InputIterator2>
+mismatch(InputIterator1 first1, InputIterator1 last1, InputIterator2 first2) {
+    typedef typename simd_compare_traits<InputIterator1, InputIterator2>
+            ::vectorizable vectorizable;
+    return __mismatch(first1, last1, first2, vectorizable());
+}
+
+template <typename InputIterator1, typename InputIterator2>
+inline bool equal(InputIterator1 first1, InputIterator1 last1,
+                  InputIterator2 first2) {
+    typedef simd_compare_traits<InputIterator1, InputIterator2> traits;
+    return __equal(first1, last1, first2, typename traits::vectorizable(),
+                   typename traits::integral());
+}
+
+template <typename InputIterator1, typename InputIterator2>
+inline bool lexicographical_compare(InputIterator1 first1,
+                                    InputIterator1 last1,
+                                    InputIterator2 first2,
+                                    InputIterator2 last2) {
+    typedef typename simd_compare_traits<InputIterator1, InputIterator2>
+            ::integral integral;
+    return __lexicographical_compare(first1, last1, first2, last2,
+                                     integral());
+}
+
+
+/*
+ * min_element and max_element find the first smallest and the first
+ * greatest element, minmax_element the first smallest and the last
+ * greatest one, like std::minmax_element.
+ * On a contiguous range of an arithmetic type the extreme values are
+ * found with SIMD, then their positions with a SIMD search: two passes
+ * which each run much faster than one pass which tracks positions. A
+ * range with a NaN takes the plain loop, a NaN changes what it finds.
+ */
+template <typename ForwardIterator, typename Compare>
+ForwardIterator min_element(ForwardIterator first, ForwardIterator last,
+                            const Compare& comp) {
+    if (first == last)
+        return last;
+    ForwardIterator result = first;
+    while (++first != last) {
+        if (comp(*first, *result))
+            result = first;
+    }
+    return result;
+}
+
+template <typename ForwardIterator, typename Compare>
+ForwardIterator max_element(ForwardIterator first, ForwardIterator last,
+                            const Compare& comp) {
+    if (first == last)
+        return last;
+    ForwardIterator result = first;
+    while (++first != last) {
+        if (comp(*result, *first))
+            result = first;
+    }
+    return result;
+}
+
+template <typename ForwardIterator, typename Compare>
+pair<ForwardIterator, ForwardIterator>
+minmax_element(ForwardIterator first, ForwardIterator last,
+               const Compare& comp) {
+    ForwardIterator min_result = first;
+    ForwardIterator max_result = first;
+    if (first == last)
+        return make_pair(min_result, max_result);
+    while (++first != last) {
+        if (comp(*first, *min_result))
+            min_result = first;
+        if (!comp(*first, *max_result))
+            max_result = first;
+    }
+    return make_pair(min_result, max_result);
+}
+
+namespace
+{
+
+template <typename ForwardIterator>
+inline ForwardIterator __min_element(ForwardIterator first,
+                                     ForwardIterator last, false_type) {
+    typedef typename iterator_traits<ForwardIterator>::value_type Tp;
+    return STLL_NAMESPACE::min_element(first, last, less<Tp>());
+}
+
+template <typename ForwardIterator>
+inline ForwardIterator __max_element(ForwardIterator first,
+                                     ForwardIterator last, false_type) {
+    typedef typename iterator_traits<ForwardIterator>::value_type Tp;
+    return STLL_NAMESPACE::max_element(first, last, less<Tp>());
+}
+
+template <typename ForwardIterator>
+inline pair<ForwardIterator, ForwardIterator>
+__minmax_element(ForwardIterator first, ForwardIterator last, false_type) {
+    typedef typename iterator_traits<ForwardIterator>::value_type Tp;
+    return STLL_NAMESPACE::minmax_element(first, last, less<Tp>());
+}
+
+#ifdef __STLL_SIMD__
+template <typename Pointer>
+Pointer __min_element(Pointer first, Pointer last, true_type) {
+    typedef typename iterator_traits<Pointer>::value_type Tp;
+    Tp min_value, max_value;
+    if (first == last
+        or !__simd_minmax<Tp>(first, last, min_value, max_value))
+        return __min_element(first, last, false_type());
+    return first + (__simd_find<Tp>(first, last, min_value) - first);
+}
+
+template <typename Pointer>
+Pointer __max_element(Pointer first, Pointer last, true_type) {
+    typedef typename iterator_traits<Pointer>::value_type Tp;
+    Tp min_value, max_value;
+    if (first == last
+        or !__simd_minmax<Tp>(first, last, min_value, max_value))
+        return __max_element(first, last, false_type());
+    return first + (__simd_find<Tp>(first, last, max_value) - first);
+}
+
+template <typename Pointer>
+pair<Pointer, Pointer> __minmax_element(Pointer first, Pointer last,
+                                        true_type) {
+    typedef typename iterator_traits<Pointer>::value_type Tp;
+    Tp min_value, max_value;
+    if (first == last
+        or !__simd_minmax<Tp>(first, last, min_value, max_value))
+        return __minmax_element(first, last, false_type());
+    return make_pair(
+        first + (__simd_find<Tp>(first, last, min_value) - first),
+        first + (__simd_find_last<Tp>(first, last, max_value) - first));
+}
+#endif
+
+}
+
+template <typename ForwardIterator>
+inline ForwardIterator min_element(ForwardIterator first,
+                                   ForwardIterator last) {
+    typedef typename simd_iterator_traits<ForwardIterator>::vectorizable
+            vectorizable;
+    return __min_element(first, last, vectorizable());
+}
+
+template <typename ForwardIterator>
+inline ForwardIterator max_element(ForwardIterator first,
+                                   ForwardIterator last) {
+    typedef typename simd_iterator_traits<ForwardIterator>::vectorizable
+            vectorizable;
+    return __max_element(first, last, vectorizable());
+}
+
+template <typename ForwardIterator>
+inline pair<ForwardIterator, ForwardIterator>
+minmax_element(ForwardIterator first, ForwardIterator last) {
+    typedef typename simd_iterator_traits<ForwardIterator>::vectorizable
+            vectorizable;
+    return __minmax_element(first, last, vectorizable());
 }
 
 
@@ -207,6 +704,206 @@ void insert_sort(RandomAcessIterator first, RandomAcessIterator last) {
 }
 
 
+/* Selection: partial_sort, partial_sort_copy, nth_element */
+namespace
+{
+
+template <typename RandomAcessIterator, typename Compare>
+void __insertion_sort(RandomAcessIterator first, RandomAcessIterator last,
+                      const Compare& comp) {
+    typedef typename iterator_traits<RandomAcessIterator>::value_type Tp;
+    if (first == last) return;
+    for (RandomAcessIterator iter = first + 1; iter != last; ++iter) {
+        Tp value = STLL_NAMESPACE::move(*iter);
+        RandomAcessIterator hole = iter;
+        for (; hole != first and comp(value, *(hole - 1)); --hole)
+            *hole = STLL_NAMESPACE::move(*(hole - 1));
+        *hole = STLL_NAMESPACE::move(value);
+    }
+}
+
+// Leave the middle - first smallest elements of [first, last) in the
+// heap [first, middle), in O((last - first) log(middle - first)).
+template <typename RandomAcessIterator, typename Compare>
+void __heap_select(RandomAcessIterator first, RandomAcessIterator middle,
+                   RandomAcessIterator last, const Compare& comp) {
+    typedef typename iterator_traits<RandomAcessIterator>::difference_type
+            Distance;
+    typedef typename iterator_traits<RandomAcessIterator>::value_type
+            Tp;
+    STLL_NAMESPACE::make_heap(first, middle, comp);
+    Distance len = middle - first;
+    for (RandomAcessIterator iter = middle; iter < last; ++iter) {
+        if (comp(*iter, *first)) {
+            Tp value = STLL_NAMESPACE::move(*iter);
+            *iter = STLL_NAMESPACE::move(*first);
+            __adjust_heap<2>(first, Distance(0), len,
+                             STLL_NAMESPACE::move(value), comp);
+        }
+    }
+}
+
+// Swap the median of *a, *b and *c into *result.
+template <typename RandomAcessIterator, typename Compare>
+void __move_median_to_first(RandomAcessIterator result,
+                            RandomAcessIterator a, RandomAcessIterator b,
+                            RandomAcessIterator c, const Compare& comp) {
+    if (comp(*a, *b)) {
+        if (comp(*b, *c))
+            STLL_NAMESPACE::iter_swap(result, b);
+        else if (comp(*a, *c))
+            STLL_NAMESPACE::iter_swap(result, c);
+        else
+            STLL_NAMESPACE::iter_swap(result, a);
+    } else if (comp(*a, *c)) {
+        STLL_NAMESPACE::iter_swap(result, a);
+    } else if (comp(*b, *c)) {
+        STLL_NAMESPACE::iter_swap(result, c);
+    } else {
+        STLL_NAMESPACE::iter_swap(result, b);
+    }
+}
+
+// Hoare partition of [first, last) around *pivot, which lies outside it.
+// The median of three guarantees an element on each side that stops the
+// scans, so they need no bound checks.
+template <typename RandomAcessIterator, typename Compare>
+RandomAcessIterator __unguarded_partition(RandomAcessIterator first,
+                                          RandomAcessIterator last,
+                                          RandomAcessIterator pivot,
+                                          const Compare& comp) {
+    for (;;) {
+        while (comp(*first, *pivot))
+            ++first;
+        --last;
+        while (comp(*pivot, *last))
+            --last;
+        if (!(first < last))
+            return first;
+        STLL_NAMESPACE::iter_swap(first, last);
+        ++first;
+    }
+}
+
+template <typename Size>
+inline Size __lg(Size n) {
+    Size k = 0;
+    for (; n > 1; n >>= 1)
+        ++k;
+    return k;
+}
+
+}
+
+
+// Sort the middle - first smallest elements of [first, last) into
+// [first, middle), the order of the others is unspecified.
+template <typename RandomAcessIterator, typename Compare>
+void partial_sort(RandomAcessIterator first, RandomAcessIterator middle,
+                  RandomAcessIterator last, const Compare& comp) {
+    if (first == middle) return;
+    STLL_NAMESPACE::__heap_select(first, middle, last, comp);
+    STLL_NAMESPACE::sort_heap(first, middle, comp);
+}
+
+template <typename RandomAcessIterator>
+inline void partial_sort(RandomAcessIterator first,
+                         RandomAcessIterator middle,
+                         RandomAcessIterator last) {
+    typedef typename iterator_traits<RandomAcessIterator>::value_type Tp;
+    STLL_NAMESPACE::partial_sort(first, middle, last, less<Tp>());
+}
+
+
+// Copy the smallest elements of [first, last) into [result_first,
+// result_last) in sorted order, and return the end of the copied range.
+// The input is read once, in O(n log k) with k the size of the result.
+template <typename InputIterator, typename RandomAcessIterator,
+          typename Compare>
+RandomAcessIterator partial_sort_copy(InputIterator first,
+                                      InputIterator last,
+                                      RandomAcessIterator result_first,
+                                      RandomAcessIterator result_last,
+                                      const Compare& comp) {
+    typedef typename iterator_traits<RandomAcessIterator>::difference_type
+            Distance;
+    typedef typename iterator_traits<RandomAcessIterator>::value_type
+            Tp;
+    RandomAcessIterator result_real_last = result_first;
+    for (; first != last and result_real_last != result_last; ++first) {
+        *result_real_last = *first;
+        ++result_real_last;
+    }
+    if (result_real_last == result_first)
+        return result_real_last;
+
+    STLL_NAMESPACE::make_heap(result_first, result_real_last, comp);
+    Distance len = result_real_last - result_first;
+    for (; first != last; ++first) {
+        if (comp(*first, *result_first))
+            __adjust_heap<2>(result_first, Distance(0), len, Tp(*first), comp);
+    }
+    STLL_NAMESPACE::sort_heap(result_first, result_real_last, comp);
+    return result_real_last;
+}
+
+template <typename InputIterator, typename RandomAcessIterator>
+inline RandomAcessIterator partial_sort_copy(InputIterator first,
+                                             InputIterator last,
+                                             RandomAcessIterator result_first,
+                                             RandomAcessIterator result_last) {
+    typedef typename iterator_traits<RandomAcessIterator>::value_type Tp;
+    return STLL_NAMESPACE::partial_sort_copy(first, last,
+                                             result_first, result_last,
+                                             less<Tp>());
+}
+
+
+/*
+ * nth_element: put in *nth the element which would be there if [first,
+ * last) were sorted, with no greater element before it and no smaller
+ * one after it.
+ * Introselect: quickselect with a median of three pivot, and when it
+ * recurses too deep, a heap select, so the worst case stays O(n log n)
+ * while the average is O(n).
+ */
+template <typename RandomAcessIterator, typename Compare>
+void nth_element(RandomAcessIterator first, RandomAcessIterator nth,
+                 RandomAcessIterator last, const Compare& comp) {
+    typedef typename iterator_traits<RandomAcessIterator>::difference_type
+            Distance;
+    if (first == last or nth == last) return;
+
+    Distance depth_limit = 2 * __lg(Distance(last - first));
+    while (last - first > 3) {
+        if (depth_limit == 0) {
+            STLL_NAMESPACE::__heap_select(first, nth + 1, last, comp);
+            STLL_NAMESPACE::iter_swap(first, nth);
+            return;
+        }
+        --depth_limit;
+        RandomAcessIterator middle = first + (last - first) / 2;
+        STLL_NAMESPACE::__move_median_to_first(first, first + 1, middle,
+                                               last - 1, comp);
+        RandomAcessIterator cut =
+                STLL_NAMESPACE::__unguarded_partition(first + 1, last,
+                                                      first, comp);
+        if (cut <= nth)
+            first = cut;
+        else
+            last = cut;
+    }
+    STLL_NAMESPACE::__insertion_sort(first, last, comp);
+}
+
+template <typename RandomAcessIterator>
+inline void nth_element(RandomAcessIterator first, RandomAcessIterator nth,
+                        RandomAcessIterator last) {
+    typedef typename iterator_traits<RandomAcessIterator>::value_type Tp;
+    STLL_NAMESPACE::nth_element(first, nth, last, less<Tp>());
+}
+
+
 __STLL_NAMESPACE_FINISH__
 
 
@@ -1,25 +1,82 @@
 #ifndef ALLOCATOR_HPP
 #define ALLOCATOR_HPP
 #include <cstddef>
+#include <new>
 
 #include "base.hpp"
 #include "utility.hpp"
+#include "move.hpp"
 
 __STLL_NAMESPACE_START__
 
 
+#ifdef STLL_ALLOC_STATS
+
+// Counters of allocator, shared by every Tp.
+template <int inst>
+struct allocator_counters_template {
+    static size_t allocations;
+    static size_t deallocations;
+    static size_t live_bytes;
+    static size_t peak_live_bytes;
+};
+
+template <int inst>
+size_t allocator_counters_template<inst>::allocations = 0;
+
+template <int inst>
+size_t allocator_counters_template<inst>::deallocations = 0;
+
+template <int inst>
+size_t allocator_counters_template<inst>::live_bytes = 0;
+
+template <int inst>
+size_t allocator_counters_template<inst>::peak_live_bytes = 0;
+
+using allocator_counters = allocator_counters_template<0>;
+
+#endif
+
 namespace
 {
 
+// operator new only guarantees __STDCPP_DEFAULT_NEW_ALIGNMENT__, a bigger
+// alignment goes through its aligned overload.
+inline void* __allocate_bytes(size_t bytes, size_t align) {
+    void* result = align > __STDCPP_DEFAULT_NEW_ALIGNMENT__
+                   ? ::operator new(bytes, std::align_val_t(align))
+                   : ::operator new(bytes);
+    __STLL_ALLOC_STAT(
+        ++allocator_counters::allocations;
+        allocator_counters::live_bytes += bytes;
+        if (allocator_counters::live_bytes
+            > allocator_counters::peak_live_bytes)
+            allocator_counters::peak_live_bytes =
+                allocator_counters::live_bytes;
+    )
+    return result;
+}
+
+inline void __deallocate_bytes(void* mem, size_t bytes, size_t align) {
+    (void)bytes;
+    __STLL_ALLOC_STAT(
+        ++allocator_counters::deallocations;
+        allocator_counters::live_bytes -= bytes;
+    )
+    if (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        ::operator delete(mem, std::align_val_t(align));
+    else
+        ::operator delete(mem);
+}
+
 template <class Tp>
 inline Tp* __allocate(size_t size, const Tp*) {
-    Tp* result = static_cast<Tp*>(::operator new(size * sizeof(Tp)));
-    return result;
+    return static_cast<Tp*>(__allocate_bytes(size * sizeof(Tp), alignof(Tp)));
 }
 
 template <class Tp>
-inline void __deallocate(Tp* mem) {
-    operator delete(static_cast<void*>(mem));
+inline void __deallocate(Tp* mem, size_t size) {
+    __deallocate_bytes(mem, size * sizeof(Tp), alignof(Tp));
 }
 
 }
@@ -35,14 +92,84 @@ public:
     typedef size_t       size_type;
     typedef ptrdiff_t    difference_type;
 
+    template <class Up>
+    struct rebind {
+        typedef allocator<Up> other;
+    };
+
 public:
+    allocator() {}
+
+    template <class Up>
+    allocator(const allocator<Up>&) {}
+
     static pointer allocate(size_type size,
                      const void* ptr=static_cast<const void*>(nullptr)) {
         return __allocate(size, static_cast<const_pointer>(ptr));
     }
 
-    static void deallocate(pointer ptr, size_type) {
-        __deallocate(ptr);
+    static void deallocate(pointer ptr, size_type size) {
+        __deallocate(ptr, size);
+    }
+
+    static pointer address(const_reference elem) {
+        return pointer(&elem);
+    }
+
+    static const_pointer const_address(const_reference elem) {
+        return const_pointer(&elem);
+    }
+
+    static size_type max_size() {
+        return max(size_type(1), size_type(~size_t(0) / sizeof (Tp)));
+    }
+};
+
+
+enum {CACHE_LINE_SIZE = 64};
+
+/*
+ * aligned_allocator: storage starts on an Align boundary, or on alignof(Tp)
+ * if it is bigger. Align must be a power of two.
+ * SIMD kernels can use aligned loads on the data of a vector using it, and
+ * with Align = CACHE_LINE_SIZE the first element does not share a cache
+ * line with another object.
+ */
+template <class Tp, size_t Align>
+class aligned_allocator {
+public:
+    typedef Tp           value_type;
+    typedef Tp*          pointer;
+    typedef const Tp*    const_pointer;
+    typedef Tp&          reference;
+    typedef const Tp&    const_reference;
+    typedef size_t       size_type;
+    typedef ptrdiff_t    difference_type;
+
+    enum {alignment = Align > alignof(Tp) ? Align : alignof(Tp)};
+
+    template <class Up>
+    struct rebind {
+        typedef aligned_allocator<Up, Align> other;
+    };
+
+    static_assert((Align & (Align - 1)) == 0,
+                  "alignment must be a power of two");
+
+public:
+    aligned_allocator() {}
+
+    template <class Up>
+    aligned_allocator(const aligned_allocator<Up, Align>&) {}
+
+    static pointer allocate(size_type size,
+                     const void* =static_cast<const void*>(nullptr)) {
+        return static_cast<pointer>(
+                    __allocate_bytes(size * sizeof(Tp), alignment));
+    }
+
+    static void deallocate(pointer ptr, size_type size) {
+        __deallocate_bytes(ptr, size * sizeof(Tp), alignment);
     }
 
     static pointer address(const_reference elem) {
@@ -58,6 +185,53 @@ public:
     }
 };
 
+
+/*
+ * cache_padded: a value alone on its cache line(s).
+ * Elements of a vector<cache_padded<counter>> updated by different threads
+ * never share a line, so they do not bounce between the cores' caches.
+ */
+template <class Tp>
+struct alignas(CACHE_LINE_SIZE) cache_padded {
+    Tp value;
+
+    cache_padded()
+        :value()
+    {}
+
+    cache_padded(const Tp& value)
+        :value(value)
+    {}
+
+    cache_padded(Tp&& value)
+        :value(STLL_NAMESPACE::move(value))
+    {}
+
+    Tp& get() {
+        return value;
+    }
+
+    const Tp& get() const {
+        return value;
+    }
+
+    Tp& operator*() {
+        return value;
+    }
+
+    const Tp& operator*() const {
+        return value;
+    }
+
+    Tp* operator->() {
+        return &value;
+    }
+
+    const Tp* operator->() const {
+        return &value;
+    }
+};
+
 __STLL_NAMESPACE_FINISH__
 
-#endif // ALLOCATpOR_HPP
+#endif // ALLOCATOR_HPP
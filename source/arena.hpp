@@ -0,0 +1,243 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <new>
+#include <cstdint>
+
+#include "base.hpp"
+
+__STLL_NAMESPACE_START__
+
+/*
+ * arena: a monotonic region of memory.
+ * allocate() bumps a pointer inside the current chunk, and takes a new,
+ * twice as large, chunk when it is full. deallocate() only gives back the
+ * most recent allocation, everything else is freed at once by reset(),
+ * release() or the destructor: a whole object graph built in an arena goes
+ * away without visiting its nodes.
+ *
+ * Chunks come from the upstream arena if there is one, else from
+ * ::operator new. An arena can start from a caller's buffer, for example
+ * on the stack, and only go to the heap when that buffer is full.
+ */
+class arena {
+public:
+    typedef size_t      size_type;
+
+    enum {DEFAULT_CHUNK_SIZE = 4096};
+    enum {MAX_CHUNK_SIZE = 1 << 20};
+
+protected:
+    // Header of an owned chunk, the chunk's bytes follow it.
+    struct alignas(alignof(max_align_t)) chunk_header {
+        chunk_header*   next;
+        size_type       size;
+    };
+
+    char*           cur;
+    char*           limit;
+    chunk_header*   chunks;
+    char*           initial_buffer;
+    size_type       initial_size;
+    size_type       next_chunk_size;
+    size_type       used;
+    arena*          upstream;
+
+public:
+    explicit arena(size_type chunk_size=DEFAULT_CHUNK_SIZE,
+                   arena* upstream=nullptr)
+        :cur(nullptr), limit(nullptr), chunks(nullptr)
+        ,initial_buffer(nullptr), initial_size(0)
+        ,next_chunk_size(chunk_size), used(0), upstream(upstream)
+    {}
+
+    // Serve allocations from buffer first, buffer must outlive the arena.
+    arena(void* buffer, size_type size, arena* upstream=nullptr)
+        :cur(static_cast<char*>(buffer)), limit(cur + size), chunks(nullptr)
+        ,initial_buffer(cur), initial_size(size)
+        ,next_chunk_size(size < size_type(DEFAULT_CHUNK_SIZE)
+                         ? size_type(DEFAULT_CHUNK_SIZE) : size)
+        ,used(0), upstream(upstream)
+    {}
+
+    arena(const arena&) = delete;
+
+    arena& operator=(const arena&) = delete;
+
+    ~arena() {
+        release();
+    }
+
+    void* allocate(size_type bytes, size_type align=alignof(max_align_t)) {
+        if (bytes == 0)
+            bytes = 1;
+        char* result = align_up(cur, align);
+        if (cur == nullptr or result > limit
+            or size_type(limit - result) < bytes) {
+            add_chunk(bytes + align);
+            result = align_up(cur, align);
+        }
+        cur = result + bytes;
+        used += bytes;
+        return result;
+    }
+
+    // Only the most recent allocation is really given back, which makes
+    // a push_back followed by a pop_back, or a vector growing in place of
+    // its last buffer, cheap.
+    void deallocate(void* ptr, size_type bytes) {
+        if (bytes == 0)
+            bytes = 1;
+        if (static_cast<char*>(ptr) + bytes == cur) {
+            cur = static_cast<char*>(ptr);
+            used -= bytes;
+        }
+    }
+
+    // Forget every allocation. The most recent chunk, or the initial
+    // buffer, is kept for the next round, the other chunks are released.
+    void reset() {
+        chunk_header* keep = initial_buffer ? nullptr : chunks;
+        release_chunks(keep ? keep->next : chunks);
+        chunks = keep;
+        if (keep) {
+            keep->next = nullptr;
+            cur = reinterpret_cast<char*>(keep + 1);
+            limit = cur + keep->size;
+        } else {
+            cur = initial_buffer;
+            limit = initial_buffer + initial_size;
+        }
+        used = 0;
+    }
+
+    // Forget every allocation and give every chunk back.
+    void release() {
+        release_chunks(chunks);
+        chunks = nullptr;
+        cur = initial_buffer;
+        limit = initial_buffer + initial_size;
+        used = 0;
+    }
+
+    // Bytes handed out since the last reset.
+    size_type bytes_used() const {
+        return used;
+    }
+
+    // Bytes held by the arena, including the initial buffer.
+    size_type bytes_reserved() const {
+        size_type total = initial_size;
+        for (chunk_header* chunk = chunks; chunk; chunk = chunk->next)
+            total += chunk->size;
+        return total;
+    }
+
+protected:
+    static char* align_up(char* ptr, size_type align) {
+        uintptr_t value = reinterpret_cast<uintptr_t>(ptr);
+        value = (value + align - 1) & ~uintptr_t(align - 1);
+        return reinterpret_cast<char*>(value);
+    }
+
+    void add_chunk(size_type min_bytes) {
+        size_type size = next_chunk_size < min_bytes ? min_bytes
+                                                     : next_chunk_size;
+        if (next_chunk_size < MAX_CHUNK_SIZE)
+            next_chunk_size <<= 1;
+
+        size_type total = sizeof(chunk_header) + size;
+        void* memory = upstream ? upstream->allocate(total)
+                                : ::operator new(total);
+        chunk_header* chunk = static_cast<chunk_header*>(memory);
+        chunk->next = chunks;
+        chunk->size = size;
+        chunks = chunk;
+        cur = reinterpret_cast<char*>(chunk + 1);
+        limit = cur + size;
+    }
+
+    void release_chunks(chunk_header* chunk) {
+        while (chunk) {
+            chunk_header* next = chunk->next;
+            if (upstream)
+                upstream->deallocate(chunk, sizeof(chunk_header) + chunk->size);
+            else
+                ::operator delete(chunk);
+            chunk = next;
+        }
+    }
+};
+
+
+/*
+ * arena_allocator: a stateful allocator drawing from an arena.
+ * It converts implicitly from arena&, so a container can be built with
+ * its arena as the allocator argument:
+ *     arena request_arena;
+ *     vector<int, arena_allocator<int>> v(request_arena);
+ */
+template <typename Tp>
+class arena_allocator {
+public:
+    typedef Tp           value_type;
+    typedef Tp*          pointer;
+    typedef const Tp*    const_pointer;
+    typedef Tp&          reference;
+    typedef const Tp&    const_reference;
+    typedef size_t       size_type;
+    typedef ptrdiff_t    difference_type;
+
+    template <typename Up>
+    struct rebind {
+        typedef arena_allocator<Up> other;
+    };
+
+protected:
+    template <typename Up>
+    friend class arena_allocator;
+
+    arena* resource;
+
+public:
+    arena_allocator(arena& resource)
+        :resource(&resource)
+    {}
+
+    template <typename Up>
+    arena_allocator(const arena_allocator<Up>& other)
+        :resource(other.resource)
+    {}
+
+    pointer allocate(size_type size,
+                     const void* =static_cast<const void*>(nullptr)) {
+        return static_cast<pointer>(
+                    resource->allocate(size * sizeof(Tp), alignof(Tp)));
+    }
+
+    void deallocate(pointer ptr, size_type size) {
+        resource->deallocate(ptr, size * sizeof(Tp));
+    }
+
+    arena& get_arena() const {
+        return *resource;
+    }
+
+    size_type max_size() const {
+        return size_type(~size_t(0) / sizeof(Tp));
+    }
+
+    template <typename Up>
+    bool operator==(const arena_allocator<Up>& other) const {
+        return resource == other.resource;
+    }
+
+    template <typename Up>
+    bool operator!=(const arena_allocator<Up>& other) const {
+        return resource != other.resource;
+    }
+};
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // ARENA_HPP
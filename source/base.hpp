@@ -32,5 +32,16 @@
 #define __ANONYMOUS_NAMESPACE_START namespace {
 #define __ANONYMOUS_NAMESPACE_FINISH }
 
+/*
+ * Allocation statistics, see alloc_stats in pool_alloc.hpp.
+ * The counters on the allocation paths only exist when STLL_ALLOC_STATS is
+ * defined before any file of STLL is included, otherwise they cost nothing.
+ */
+#ifdef STLL_ALLOC_STATS
+#define __STLL_ALLOC_STAT(...) __VA_ARGS__
+#else
+#define __STLL_ALLOC_STAT(...)
+#endif
+
 
 #endif // BASE_HPP
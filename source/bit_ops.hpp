@@ -0,0 +1,323 @@
+#ifndef BIT_OPS_HPP
+#define BIT_OPS_HPP
+
+#include <cstdint>
+#include <stdexcept>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#include "base.hpp"
+#include "simd.hpp"
+#include "vector.hpp"
+
+/*
+ * Operations on arrays of 64 bits words holding bits, bit i of the array
+ * being bit i % 64 of word i / 64: the storage of bitset and bit_vector.
+ * The bits past the size in the last word are kept 0, so a count or a
+ * search needs no mask.
+ */
+
+__STLL_NAMESPACE_START__
+
+enum {BIT_WORD_BITS = 64};
+
+namespace
+{
+
+// The number of set bits of word: a popcnt where the target has it.
+inline unsigned __bit_popcount(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    word -= (word >> 1) & 0x5555555555555555ull;
+    word = (word & 0x3333333333333333ull)
+           + ((word >> 2) & 0x3333333333333333ull);
+    word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return unsigned((word * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// The index of the lowest set bit of word, which is not 0: a tzcnt or
+// bsf.
+inline unsigned __bit_ctz(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    unsigned index = 0;
+    for (; (word & 1) == 0; word >>= 1)
+        ++index;
+    return index;
+#endif
+}
+
+// The index of the k-th (from 0) set bit of word, which has more than k:
+// one pdep with BMI2, else a search by bytes.
+inline unsigned __bit_select(uint64_t word, unsigned k) {
+#if defined(__BMI2__)
+    return __bit_ctz(_pdep_u64(uint64_t(1) << k, word));
+#else
+    unsigned shift = 0;
+    for (;; shift += 8) {
+        unsigned ones = __bit_popcount((word >> shift) & 0xff);
+        if (k < ones)
+            break;
+        k -= ones;
+    }
+    word >>= shift;
+    for (; k > 0; --k)
+        word &= word - 1;
+    return shift + __bit_ctz(word);
+#endif
+}
+
+inline size_t __bits_words(size_t bits) {
+    return (bits + BIT_WORD_BITS - 1) / BIT_WORD_BITS;
+}
+
+// The set bits of [first, last).
+inline size_t __bits_count(const uint64_t* first, const uint64_t* last) {
+#ifdef __STLL_SIMD__
+    return __simd_popcount(first, last);
+#else
+    size_t total = 0;
+    for (; first != last; ++first)
+        total += __bit_popcount(*first);
+    return total;
+#endif
+}
+
+// result[i] = first1[i] Operation first2[i], Operation one of SIMD_BIT_*.
+template <int Operation>
+inline void __bits_apply(const uint64_t* first1, const uint64_t* last1,
+                         const uint64_t* first2, uint64_t* result) {
+#ifdef __STLL_SIMD__
+    __simd_bitwise<Operation>(first1, last1, first2, result);
+#else
+    for (; first1 != last1; ++first1, ++first2, ++result) {
+        switch (Operation) {
+        case SIMD_BIT_AND:
+            *result = *first1 & *first2;
+            break;
+        case SIMD_BIT_OR:
+            *result = *first1 | *first2;
+            break;
+        case SIMD_BIT_XOR:
+            *result = *first1 ^ *first2;
+            break;
+        default:
+            *result = *first1 & ~*first2;
+            break;
+        }
+    }
+#endif
+}
+
+/*
+ * The index of the first set bit at or after bit pos of the count words,
+ * or size_t(-1). The words after the one of pos are skipped a vector at a
+ * time, so a sparse array is scanned at memory speed.
+ */
+inline size_t __bits_find(const uint64_t* words, size_t count, size_t pos) {
+    size_t index = pos / BIT_WORD_BITS;
+    if (index >= count)
+        return size_t(-1);
+    uint64_t word = words[index] & (~uint64_t(0) << (pos % BIT_WORD_BITS));
+    if (word != 0)
+        return index * BIT_WORD_BITS + __bit_ctz(word);
+    const uint64_t* first = words + index + 1;
+    const uint64_t* last = words + count;
+#ifdef __STLL_SIMD__
+    first = __simd_find_nonzero(first, last);
+#else
+    while (first != last and *first == 0)
+        ++first;
+#endif
+    if (first == last)
+        return size_t(-1);
+    return (first - words) * BIT_WORD_BITS + __bit_ctz(*first);
+}
+
+}
+
+
+/*
+ * bit_reference: the reference of bitset and bit_vector, a proxy for one
+ * bit of a word.
+ */
+class bit_reference {
+protected:
+    uint64_t*   word;
+    uint64_t    mask;
+
+public:
+    bit_reference(uint64_t* word, size_t bit)
+        :word(word), mask(uint64_t(1) << bit)
+    {}
+
+    operator bool() const {
+        return (*word & mask) != 0;
+    }
+
+    bool operator~() const {
+        return (*word & mask) == 0;
+    }
+
+    bit_reference& operator=(bool value) {
+        if (value)
+            *word |= mask;
+        else
+            *word &= ~mask;
+        return *this;
+    }
+
+    bit_reference& operator=(const bit_reference& another) {
+        return *this = bool(another);
+    }
+
+    bit_reference& flip() {
+        *word ^= mask;
+        return *this;
+    }
+};
+
+
+/*
+ * rank_select: a succinct index over the bits of a bitset or bit_vector,
+ * for as long as they do not change. rank1(i) is the number of ones
+ * before bit i, select1(k) the index of the k-th one (from 0).
+ * Rank uses the rank9 layout of Vigna: for each block of 512 bits, the
+ * ones before the block and the 9 bits counts of the ones before each of
+ * its words in the block, two words per block, i.e. 25% of the bits. A
+ * rank reads these two words and makes one popcount, in O(1).
+ * Select keeps the block of every 512th one, so it only searches the
+ * blocks between two samples, then the counts of one block, then one
+ * word. That is O(1) unless the ones are so sparse that 512 of them span
+ * many blocks, where the binary search over those blocks takes
+ * O(log(n / ones)).
+ */
+class rank_select {
+public:
+    typedef size_t      size_type;
+
+    static constexpr size_type npos = size_type(-1);
+
+    enum {BLOCK_WORDS = 8};
+    enum {BLOCK_BITS = BLOCK_WORDS * BIT_WORD_BITS};
+    enum {SAMPLE_ONES = 512};
+
+protected:
+    const uint64_t*     words;
+    size_type           bits;
+    size_type           ones;
+    // Two per block and two for the end: the ones before the block, and
+    // the packed counts of the ones before its words 1 to 7.
+    vector<uint64_t>    counts;
+    // samples[s] is the block of the (s * SAMPLE_ONES)-th one.
+    vector<size_type>   samples;
+
+public:
+    rank_select()
+        :words(nullptr), bits(0), ones(0)
+    {}
+
+    rank_select(const uint64_t* words, size_type bits)
+        :words(words), bits(bits), ones(0) {
+        build();
+    }
+
+    // Bits is a bitset or a bit_vector.
+    template <typename Bits>
+    explicit rank_select(const Bits& bits)
+        :rank_select(bits.data(), bits.size())
+    {}
+
+    size_type size() const {
+        return bits;
+    }
+
+    // The number of ones.
+    size_type count() const {
+        return ones;
+    }
+
+    // The ones in [0, pos), pos <= size().
+    size_type rank1(size_type pos) const {
+        size_type word = pos / BIT_WORD_BITS;
+        size_type block = word / BLOCK_WORDS;
+        size_type in_block = word % BLOCK_WORDS;
+        size_type rank = counts[2 * block];
+        if (in_block != 0)
+            rank += (counts[2 * block + 1] >> (9 * (in_block - 1))) & 0x1ff;
+        if (pos % BIT_WORD_BITS != 0) {
+            uint64_t below = (uint64_t(1) << (pos % BIT_WORD_BITS)) - 1;
+            rank += __bit_popcount(words[word] & below);
+        }
+        return rank;
+    }
+
+    // The zeros in [0, pos), pos <= size().
+    size_type rank0(size_type pos) const {
+        return pos - rank1(pos);
+    }
+
+    // The index of the k-th one from 0, or npos if there are only k.
+    size_type select1(size_type k) const {
+        if (k >= ones)
+            return npos;
+        size_type sample = k / SAMPLE_ONES;
+        // The last block whose ones before it are at most k.
+        size_type low = samples[sample];
+        size_type high = sample + 1 < samples.size() ? samples[sample + 1]
+                                                      : blocks() - 1;
+        while (low < high) {
+            size_type middle = low + (high - low + 1) / 2;
+            if (counts[2 * middle] <= k)
+                low = middle;
+            else
+                high = middle - 1;
+        }
+        k -= counts[2 * low];
+        uint64_t packed = counts[2 * low + 1];
+        size_type in_block = 0;
+        while (in_block + 1 < BLOCK_WORDS
+               and ((packed >> (9 * in_block)) & 0x1ff) <= k)
+            ++in_block;
+        if (in_block != 0)
+            k -= (packed >> (9 * (in_block - 1))) & 0x1ff;
+        size_type word = low * BLOCK_WORDS + in_block;
+        return word * BIT_WORD_BITS + __bit_select(words[word], unsigned(k));
+    }
+
+protected:
+    size_type blocks() const {
+        return (__bits_words(bits) + BLOCK_WORDS - 1) / BLOCK_WORDS;
+    }
+
+    void build() {
+        size_type word_count = __bits_words(bits);
+        counts.reserve(2 * blocks() + 2);
+        for (size_type block = 0; block < blocks(); ++block) {
+            uint64_t packed = 0;
+            size_type in_block = 0;
+            for (size_type i = 0; i < BLOCK_WORDS; ++i) {
+                size_type word = block * BLOCK_WORDS + i;
+                if (i != 0)
+                    packed |= uint64_t(in_block) << (9 * (i - 1));
+                if (word < word_count)
+                    in_block += __bit_popcount(words[word]);
+            }
+            counts.push_back(ones);
+            counts.push_back(packed);
+            for (; samples.size() * SAMPLE_ONES < ones + in_block;)
+                samples.push_back(block);
+            ones += in_block;
+        }
+        counts.push_back(ones);
+        counts.push_back(0);
+    }
+};
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // BIT_OPS_HPP
@@ -0,0 +1,379 @@
+#ifndef BIT_VECTOR_HPP
+#define BIT_VECTOR_HPP
+
+#include <stdexcept>
+
+#include "base.hpp"
+#include "allocator.hpp"
+#include "bit_ops.hpp"
+#include "utility.hpp"
+
+__STLL_NAMESPACE_START__
+
+/*
+ * bit_vector: a growable array of bits packed in 64 bits words, one byte
+ * per 8 flags where a vector<char> takes 8. Scans run over the words:
+ * count() with the SIMD popcount kernel, find_first() and find_next()
+ * skipping a vector of clear words at a time, the bitwise operators with
+ * the SIMD bitwise kernel; on large arrays they are bound by the memory
+ * bandwidth.
+ * Build a rank_select on it for rank and select in O(1); the index reads
+ * the words in place, so it is valid until the bit_vector changes.
+ */
+template <typename Alloc=allocator<uint64_t>>
+class bit_vector {
+public:
+    typedef bool                value_type;
+    typedef bit_reference       reference;
+    typedef bool                const_reference;
+    typedef size_t              size_type;
+    typedef ptrdiff_t           difference_type;
+
+    typedef typename Alloc::template rebind<uint64_t>::other word_allocator;
+    typedef bit_vector<Alloc>   self;
+
+    static const size_type npos = size_type(-1);
+
+protected:
+    word_allocator  data_allocator;
+    uint64_t*       words;
+    size_type       bits;
+    size_type       word_cap;
+
+public:
+    bit_vector()
+        :data_allocator(), words(nullptr), bits(0), word_cap(0)
+    {}
+
+    explicit bit_vector(const Alloc& allocator)
+        :data_allocator(allocator), words(nullptr), bits(0), word_cap(0)
+    {}
+
+    explicit bit_vector(size_type size, bool value=false,
+                        const Alloc& allocator=Alloc())
+        :bit_vector(allocator) {
+        resize(size, value);
+    }
+
+    bit_vector(const self& another)
+        :data_allocator(another.data_allocator), words(nullptr), bits(0),
+         word_cap(0) {
+        reserve(another.bits);
+        copy_words(another.words, another.word_count(), words);
+        bits = another.bits;
+    }
+
+    bit_vector(self&& another)
+        :data_allocator(another.data_allocator), words(another.words),
+         bits(another.bits), word_cap(another.word_cap) {
+        another.words = nullptr;
+        another.bits = another.word_cap = 0;
+    }
+
+    ~bit_vector() {
+        release();
+    }
+
+    self& operator=(const self& another) {
+        if (this != &another) {
+            self copy(another);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    // another is left empty.
+    self& operator=(self&& another) {
+        if (this != &another) {
+            self moved(STLL_NAMESPACE::move(another));
+            swap(moved);
+        }
+        return *this;
+    }
+
+    void swap(self& another) {
+        STLL_NAMESPACE::swap(data_allocator, another.data_allocator);
+        STLL_NAMESPACE::swap(words, another.words);
+        STLL_NAMESPACE::swap(bits, another.bits);
+        STLL_NAMESPACE::swap(word_cap, another.word_cap);
+    }
+
+    size_type size() const {
+        return bits;
+    }
+
+    size_type capacity() const {
+        return word_cap * BIT_WORD_BITS;
+    }
+
+    bool empty() const {
+        return bits == 0;
+    }
+
+    // The words of the bits, bit i is bit i % 64 of word i / 64.
+    const uint64_t* data() const {
+        return words;
+    }
+
+    size_type word_count() const {
+        return __bits_words(bits);
+    }
+
+    bool operator[](size_type pos) const {
+        return (words[pos / BIT_WORD_BITS] >> (pos % BIT_WORD_BITS)) & 1;
+    }
+
+    reference operator[](size_type pos) {
+        return reference(words + pos / BIT_WORD_BITS, pos % BIT_WORD_BITS);
+    }
+
+    bool at(size_type pos) const {
+        if (pos >= bits)
+            throw std::range_error("index out of range");
+        return (*this)[pos];
+    }
+
+    reference at(size_type pos) {
+        if (pos >= bits)
+            throw std::range_error("index out of range");
+        return (*this)[pos];
+    }
+
+    bool test(size_type pos) const {
+        return at(pos);
+    }
+
+    bool front() const {
+        return (*this)[0];
+    }
+
+    bool back() const {
+        return (*this)[bits - 1];
+    }
+
+    void reserve(size_type size) {
+        if (__bits_words(size) > word_cap)
+            reallocate(__bits_words(size));
+    }
+
+    void push_back(bool value) {
+        if (bits % BIT_WORD_BITS == 0) {
+            size_type index = bits / BIT_WORD_BITS;
+            if (index == word_cap)
+                reallocate(max(size_type(1), word_cap * 2));
+            words[index] = 0;
+        }
+        if (value)
+            words[bits / BIT_WORD_BITS] |=
+                uint64_t(1) << (bits % BIT_WORD_BITS);
+        ++bits;
+    }
+
+    void pop_back() {
+        --bits;
+        (*this)[bits] = false;
+    }
+
+    // New bits are value.
+    void resize(size_type size, bool value=false) {
+        if (size <= bits) {
+            bits = size;
+            trim();
+            return;
+        }
+        reserve(size);
+        size_type old_words = word_count();
+        if (value and bits % BIT_WORD_BITS != 0)
+            words[old_words - 1] |= ~uint64_t(0) << (bits % BIT_WORD_BITS);
+        bits = size;
+        for (size_type i = old_words; i < word_count(); ++i)
+            words[i] = value ? ~uint64_t(0) : 0;
+        trim();
+    }
+
+    void clear() {
+        bits = 0;
+    }
+
+    // The number of set bits.
+    size_type count() const {
+        return __bits_count(words, words + word_count());
+    }
+
+    bool all() const {
+        return count() == bits;
+    }
+
+    bool any() const {
+        return find_first() != npos;
+    }
+
+    bool none() const {
+        return !any();
+    }
+
+    // The index of the first set bit, or npos.
+    size_type find_first() const {
+        return __bits_find(words, word_count(), 0);
+    }
+
+    // The index of the first set bit after pos, or npos.
+    size_type find_next(size_type pos) const {
+        if (pos + 1 >= bits)
+            return npos;
+        return __bits_find(words, word_count(), pos + 1);
+    }
+
+    self& set() {
+        for (size_type i = 0; i < word_count(); ++i)
+            words[i] = ~uint64_t(0);
+        trim();
+        return *this;
+    }
+
+    self& set(size_type pos, bool value=true) {
+        (*this)[pos] = value;
+        return *this;
+    }
+
+    self& reset() {
+        for (size_type i = 0; i < word_count(); ++i)
+            words[i] = 0;
+        return *this;
+    }
+
+    self& reset(size_type pos) {
+        (*this)[pos] = false;
+        return *this;
+    }
+
+    self& flip() {
+        for (size_type i = 0; i < word_count(); ++i)
+            words[i] = ~words[i];
+        trim();
+        return *this;
+    }
+
+    self& flip(size_type pos) {
+        (*this)[pos].flip();
+        return *this;
+    }
+
+    // The bitwise operators take the bits both vectors have, the size of
+    // this one is kept: &= clears the bits another has not.
+    self& operator&=(const self& another) {
+        size_type common = apply<SIMD_BIT_AND>(another);
+        for (size_type i = common; i < word_count(); ++i)
+            words[i] = 0;
+        return *this;
+    }
+
+    self& operator|=(const self& another) {
+        apply<SIMD_BIT_OR>(another);
+        trim();
+        return *this;
+    }
+
+    self& operator^=(const self& another) {
+        apply<SIMD_BIT_XOR>(another);
+        trim();
+        return *this;
+    }
+
+    // The set difference: clear the bits set in another, and not.
+    self& operator-=(const self& another) {
+        apply<SIMD_BIT_ANDNOT>(another);
+        return *this;
+    }
+
+    self operator~() const {
+        self result = *this;
+        return result.flip();
+    }
+
+    bool operator==(const self& another) const {
+        if (bits != another.bits)
+            return false;
+        for (size_type i = 0; i < word_count(); ++i) {
+            if (words[i] != another.words[i])
+                return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const self& another) const {
+        return !(*this == another);
+    }
+
+protected:
+    // Apply the operation to the words both have, return their number.
+    template <int Operation>
+    size_type apply(const self& another) {
+        size_type common = min(word_count(), another.word_count());
+        __bits_apply<Operation>(words, words + common, another.words, words);
+        return common;
+    }
+
+    // Clear the bits past the size in the last word.
+    void trim() {
+        if (bits % BIT_WORD_BITS != 0)
+            words[bits / BIT_WORD_BITS] &=
+                (uint64_t(1) << (bits % BIT_WORD_BITS)) - 1;
+    }
+
+    void copy_words(const uint64_t* from, size_type count, uint64_t* to) {
+        for (size_type i = 0; i < count; ++i)
+            to[i] = from[i];
+    }
+
+    void reallocate(size_type new_cap) {
+        uint64_t* new_words = data_allocator.allocate(new_cap);
+        copy_words(words, word_count(), new_words);
+        release();
+        words = new_words;
+        word_cap = new_cap;
+    }
+
+    void release() {
+        if (words)
+            data_allocator.deallocate(words, word_cap);
+        words = nullptr;
+        word_cap = 0;
+    }
+};
+
+template <typename Alloc>
+const typename bit_vector<Alloc>::size_type bit_vector<Alloc>::npos;
+
+
+template <typename Alloc>
+inline bit_vector<Alloc> operator&(const bit_vector<Alloc>& bits1,
+                                   const bit_vector<Alloc>& bits2) {
+    bit_vector<Alloc> result = bits1;
+    return result &= bits2;
+}
+
+template <typename Alloc>
+inline bit_vector<Alloc> operator|(const bit_vector<Alloc>& bits1,
+                                   const bit_vector<Alloc>& bits2) {
+    bit_vector<Alloc> result = bits1;
+    return result |= bits2;
+}
+
+template <typename Alloc>
+inline bit_vector<Alloc> operator^(const bit_vector<Alloc>& bits1,
+                                   const bit_vector<Alloc>& bits2) {
+    bit_vector<Alloc> result = bits1;
+    return result ^= bits2;
+}
+
+template <typename Alloc>
+inline bit_vector<Alloc> operator-(const bit_vector<Alloc>& bits1,
+                                   const bit_vector<Alloc>& bits2) {
+    bit_vector<Alloc> result = bits1;
+    return result -= bits2;
+}
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // BIT_VECTOR_HPP
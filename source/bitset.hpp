@@ -0,0 +1,219 @@
+#ifndef BITSET_HPP
+#define BITSET_HPP
+
+#include <stdexcept>
+
+#include "base.hpp"
+#include "bit_ops.hpp"
+
+__STLL_NAMESPACE_START__
+
+/*
+ * bitset: N bits packed in 64 bits words, 8 flags per byte.
+ * count() and the bitwise operators run the SIMD kernels over the words;
+ * find_first() and find_next() skip 64 clear bits per word and a vector
+ * of words at a time, then take the lowest set bit with a tzcnt.
+ * Build a rank_select on it for rank and select in O(1).
+ */
+template <size_t N>
+class bitset {
+public:
+    typedef size_t              size_type;
+    typedef bool                value_type;
+    typedef bit_reference       reference;
+    typedef bool                const_reference;
+
+    typedef bitset<N>           self;
+
+    static const size_type npos = size_type(-1);
+
+    enum {WORD_COUNT = N == 0 ? 1 : (N + BIT_WORD_BITS - 1) / BIT_WORD_BITS};
+
+protected:
+    uint64_t    words[WORD_COUNT];
+
+public:
+    constexpr bitset()
+        :words()
+    {}
+
+    // The low N bits of value.
+    bitset(unsigned long long value)
+        :words() {
+        words[0] = value;
+        trim();
+    }
+
+    constexpr size_type size() const {
+        return N;
+    }
+
+    const uint64_t* data() const {
+        return words;
+    }
+
+    constexpr size_type word_count() const {
+        return WORD_COUNT;
+    }
+
+    bool operator[](size_type pos) const {
+        return (words[pos / BIT_WORD_BITS] >> (pos % BIT_WORD_BITS)) & 1;
+    }
+
+    reference operator[](size_type pos) {
+        return reference(words + pos / BIT_WORD_BITS, pos % BIT_WORD_BITS);
+    }
+
+    bool test(size_type pos) const {
+        if (pos >= N)
+            throw std::range_error("index out of range");
+        return (*this)[pos];
+    }
+
+    // The number of set bits.
+    size_type count() const {
+        return __bits_count(words, words + WORD_COUNT);
+    }
+
+    bool all() const {
+        return count() == N;
+    }
+
+    bool any() const {
+        return find_first() != npos;
+    }
+
+    bool none() const {
+        return !any();
+    }
+
+    // The index of the first set bit, or npos.
+    size_type find_first() const {
+        return __bits_find(words, WORD_COUNT, 0);
+    }
+
+    // The index of the first set bit after pos, or npos.
+    size_type find_next(size_type pos) const {
+        if (pos + 1 >= N)
+            return npos;
+        return __bits_find(words, WORD_COUNT, pos + 1);
+    }
+
+    self& set() {
+        for (size_type i = 0; i < WORD_COUNT; ++i)
+            words[i] = ~uint64_t(0);
+        trim();
+        return *this;
+    }
+
+    self& set(size_type pos, bool value=true) {
+        (*this)[pos] = value;
+        return *this;
+    }
+
+    self& reset() {
+        for (size_type i = 0; i < WORD_COUNT; ++i)
+            words[i] = 0;
+        return *this;
+    }
+
+    self& reset(size_type pos) {
+        (*this)[pos] = false;
+        return *this;
+    }
+
+    self& flip() {
+        for (size_type i = 0; i < WORD_COUNT; ++i)
+            words[i] = ~words[i];
+        trim();
+        return *this;
+    }
+
+    self& flip(size_type pos) {
+        (*this)[pos].flip();
+        return *this;
+    }
+
+    self& operator&=(const self& another) {
+        __bits_apply<SIMD_BIT_AND>(words, words + WORD_COUNT,
+                                   another.words, words);
+        return *this;
+    }
+
+    self& operator|=(const self& another) {
+        __bits_apply<SIMD_BIT_OR>(words, words + WORD_COUNT,
+                                  another.words, words);
+        return *this;
+    }
+
+    self& operator^=(const self& another) {
+        __bits_apply<SIMD_BIT_XOR>(words, words + WORD_COUNT,
+                                   another.words, words);
+        return *this;
+    }
+
+    // The set difference: clear the bits set in another, and not.
+    self& operator-=(const self& another) {
+        __bits_apply<SIMD_BIT_ANDNOT>(words, words + WORD_COUNT,
+                                      another.words, words);
+        return *this;
+    }
+
+    self operator~() const {
+        self result = *this;
+        return result.flip();
+    }
+
+    bool operator==(const self& another) const {
+        for (size_type i = 0; i < WORD_COUNT; ++i) {
+            if (words[i] != another.words[i])
+                return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const self& another) const {
+        return !(*this == another);
+    }
+
+protected:
+    // Clear the bits past N of the last word.
+    void trim() {
+        if (N % BIT_WORD_BITS != 0)
+            words[WORD_COUNT - 1] &= (uint64_t(1) << (N % BIT_WORD_BITS)) - 1;
+        else if (N == 0)
+            words[0] = 0;
+    }
+};
+
+template <size_t N>
+const typename bitset<N>::size_type bitset<N>::npos;
+
+
+template <size_t N>
+inline bitset<N> operator&(const bitset<N>& bits1, const bitset<N>& bits2) {
+    bitset<N> result = bits1;
+    return result &= bits2;
+}
+
+template <size_t N>
+inline bitset<N> operator|(const bitset<N>& bits1, const bitset<N>& bits2) {
+    bitset<N> result = bits1;
+    return result |= bits2;
+}
+
+template <size_t N>
+inline bitset<N> operator^(const bitset<N>& bits1, const bitset<N>& bits2) {
+    bitset<N> result = bits1;
+    return result ^= bits2;
+}
+
+template <size_t N>
+inline bitset<N> operator-(const bitset<N>& bits1, const bitset<N>& bits2) {
+    bitset<N> result = bits1;
+    return result -= bits2;
+}
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // BITSET_HPP
@@ -7,6 +7,9 @@
 
 __STLL_NAMESPACE_START__
 
+template <typename Tp>
+inline void destroy(Tp* ptr);
+
 namespace
 {
 
@@ -50,7 +53,7 @@ inline void construct(Tp1* ptr, const Tp2& value) {
 // Construct object which ptr pointed with args.
 template <typename Tp, typename ...Args>
 inline void construct(Tp* ptr, Args&&... args) {
-    new(ptr)Tp(forward<Args>(args)...);
+    new(ptr)Tp(STLL_NAMESPACE::forward<Args>(args)...);
 }
 
 // Destroy object which ptr pointed.
@@ -5,6 +5,8 @@
 
 #include "allocator.hpp"
 #include "iterator.hpp"
+#include "memory.hpp"
+#include "span.hpp"
 
 
 __STLL_NAMESPACE_START__
@@ -14,243 +16,261 @@ namespace
 enum {DEQUE_BUFFER_SIZE = 256};
 }
 
-template<typename Tp, typename Alloc=allocator<Tp>>
-class deque {
-public:
-    typedef Tp           value_type;
-    typedef Tp*          pointer;
-    typedef const Tp*    const_pointer;
-    typedef Tp&          reference;
-    typedef const Tp&    const_reference;
-    typedef size_t       size_type;
-    typedef ptrdiff_t    difference_type;
+template <typename Tp, typename Ref, typename Ptr>
+struct deque_iterator {
+    typedef random_access_iterator_tag   iterator_category;
+    typedef Tp                           value_type;
+    typedef Ptr                          pointer;
+    typedef Ref                          reference;
+    typedef size_t                       size_type;
+    typedef ptrdiff_t                    difference_type;
+
+    typedef Tp**                         map_pointer;
+
+    typedef deque_iterator<Tp, Tp&, Tp*>               iterator;
+    typedef deque_iterator<Tp, const Tp&, const Tp*>   const_iterator;
+    typedef deque_iterator<Tp, Ref, Ptr>               self;
+
+    // [start, finish) is the buffer which node points to,
+    // cur is the element in that buffer.
+    Tp*         start;
+    Tp*         finish;
+    Tp*         cur;
+    map_pointer node;
+
+    deque_iterator()
+        :start(nullptr), finish(nullptr), cur(nullptr), node(nullptr)
+    {}
 
-    typedef pointer*     map_pointer;
-    typedef Alloc        alloc;
+    deque_iterator(map_pointer _node, Tp* _cur=nullptr) {
+        set_node(_node);
+        if (_cur)
+            cur = _cur;
+    }
 
-    typedef deque<Tp, Alloc>     self;
+    // iterator converts to const_iterator. A template, so that it is not
+    // the copy constructor of iterator, which would deprecate the implicit
+    // copy assignment.
+    template <typename Up>
+    deque_iterator(const deque_iterator<Up, Up&, Up*>& iter)
+        :start(iter.start), finish(iter.finish), cur(iter.cur), node(iter.node)
+    {}
 
-public:
-    class iterator {
-    public:
-        typedef random_access_iterator_tag   iterator_category;
-        typedef Tp                           value_type;
-        typedef Tp*                          pointer;
-        typedef Tp&                          reference;
-        typedef size_t                       size_type;
-        typedef ptrdiff_t                    difference_type;
-
-    public:
-        iterator() = default;
-
-        iterator(map_pointer _node, pointer* _cur=nullptr) {
-            node = _node;
-            cur = (_cur ? _cur: *node);
-            start = *node;
-            finish = start + buffer_size();
-        }
+    reference operator*() const {
+        return *cur;
+    }
 
-        reference operator*() {
-            return *cur;
-        }
+    pointer operator->() const {
+        return cur;
+    }
 
-        pointer operator->() {
-            return cur;
-        }
+    reference operator[](difference_type n) const {
+        return *(*this + n);
+    }
 
-        iterator operator+(const difference_type& size) const {
-            iterator iter = *this;
-            if (cur + size >= start && cur + size < finish) {
-                iter.cur = cur + size;
-            } else if (size > 0) {
-                size_t cur_node_left = finish - cur;
-                size_t node_draft = (size - cur_node_left) / buffer_size()
-                        + 1 - !((size - cur_node_left) % buffer_size())
-                        ;
-                size_t final_node_draft = size
-                        - ((node_draft-1) * buffer_size())
-                        - cur_node_left;
-
-                iter.node = node + node_draft;
-                iter.cur = *iter.node + final_node_draft;
-                iter.start = *iter.node;
-                iter.finish = iter.start + buffer_size();
-            } else {
-                size_t cur_node_advaced = cur - start;
-                size_t node_draft = (size - cur_node_advaced) / buffer_size()
-                        + 1 - !((size - cur_node_advaced) % buffer_size());
-                size_t final_node_draft = size
-                        - ((node_draft-1) * buffer_size())
-                        - cur_node_advaced;
-
-                iter.node = node - node_draft;
-                iter.start = (*iter.node);
-                iter.finish = iter.start + buffer_size();
-                iter.cur = iter.finish - final_node_draft;
-            }
-            return iter;
+    // Only one division is needed to locate the target buffer, and none
+    // at all when the target stays in the current one.
+    self& operator+=(difference_type n) {
+        difference_type offset = n + (cur - start);
+        difference_type size = difference_type(buffer_size());
+        if (offset >= 0 && offset < size) {
+            cur += n;
+        } else {
+            difference_type node_offset = offset > 0
+                    ? offset / size
+                    : -difference_type((-offset - 1) / size) - 1;
+            set_node(node + node_offset);
+            cur = start + (offset - node_offset * size);
         }
+        return *this;
+    }
 
-        iterator& operator+=(const difference_type& size) {
-            iterator& iter = *this;
-            if (cur + size >= start && cur + size < finish) {
-                iter.cur = cur + size;
-            } else if (size > 0) {
-                size_t cur_node_left = finish - cur;
-                size_t node_draft = (size - cur_node_left) / buffer_size()
-                        + 1 - !((size - cur_node_left) % buffer_size())
-                        ;
-                size_t final_node_draft = size
-                        - ((node_draft-1) * buffer_size())
-                        - cur_node_left;
-
-                iter.node = node + node_draft;
-                iter.cur = *iter.node + final_node_draft;
-                iter.start = *iter.node;
-                iter.finish = iter.start + buffer_size();
-            } else {
-
-                size_t cur_node_advaced = cur - start;
-                size_t node_draft = ((-size) - cur_node_advaced) / buffer_size()
-                        + 1 - !((size - cur_node_advaced) % buffer_size())
-                        ;
-                size_t final_node_draft = (-size)
-                        - ((node_draft-1) * buffer_size())
-                        - cur_node_advaced;
-
-                iter.node = node - node_draft;
-                iter.start = *iter.node;
-                iter.finish = iter.start + buffer_size();
-                iter.cur = iter.finish - final_node_draft;
-            }
-            return iter;
-        }
+    self operator+(difference_type n) const {
+        self iter = *this;
+        return iter += n;
+    }
 
-        iterator operator-(const difference_type& size) const {
-            return operator+(-size);
-        }
+    self& operator-=(difference_type n) {
+        return operator+=(-n);
+    }
 
-        iterator operator-=(const difference_type& size) {
-            return operator+=(-size);
-        }
+    self operator-(difference_type n) const {
+        self iter = *this;
+        return iter -= n;
+    }
 
-        iterator& operator++() {
-            return operator+=(1);
+    self& operator++() {
+        if (++cur == finish) {
+            set_node(node + 1);
         }
+        return *this;
+    }
 
-        iterator operator++(int) {
-            iterator iter = *this;
-            operator+=(1);
-            return iter;
-        }
+    self operator++(int) {
+        self iter = *this;
+        ++*this;
+        return iter;
+    }
 
-        iterator& operator--() {
-            return operator+=(-1);
+    self& operator--() {
+        if (cur == start) {
+            set_node(node - 1);
+            cur = finish;
         }
+        --cur;
+        return *this;
+    }
 
-        iterator operator--(int) {
-            iterator iter = *this;
-            operator+=(-1);
-            return iter;
-        }
+    self operator--(int) {
+        self iter = *this;
+        --*this;
+        return iter;
+    }
 
-        bool operator<(const iterator& iter) const {
-            return (node < iter.node || (node == iter.node && cur < iter.cur));
-        }
+    difference_type operator-(const self& iter) const {
+        return difference_type(buffer_size()) * (node - iter.node - 1)
+               + (cur - start) + (iter.finish - iter.cur);
+    }
 
-        bool operator>(const iterator& iter) const {
-            return (node > iter.node || (node == iter.node && cur > iter.cur));
-        }
+    bool operator<(const self& iter) const {
+        return (node < iter.node || (node == iter.node && cur < iter.cur));
+    }
 
-        difference_type operator-(const iterator& iter) const {
-            difference_type distance = 0;
-            if (iter.node == node) {
-                return cur - iter.cur;
-            } else if (this->operator<(iter)) {
-                return -iter.operator-(*this);
-            } else {
-                distance += (cur - start);
-                distance += (iter.finish - iter.cur);
-                distance += buffer_size() * ((node - iter.node) - 1);
-            }
-            return distance;
-        }
+    bool operator>(const self& iter) const {
+        return iter < *this;
+    }
 
-        bool operator==(const iterator& iter) const {
-            return start == iter.start && finish == iter.finish
-                   && cur == iter.cur && node == iter.node;
-        }
+    bool operator<=(const self& iter) const {
+        return !(iter < *this);
+    }
 
-        bool operator!=(const iterator& iter) const {
-            return !operator==(iter);
-        }
+    bool operator>=(const self& iter) const {
+        return !(*this < iter);
+    }
 
-        size_type buffer_size() const {
-            return DEQUE_BUFFER_SIZE;
-        }
+    bool operator==(const self& iter) const {
+        return cur == iter.cur;
+    }
 
-        void set_node(map_pointer _node) {
-            node = _node;
-            start = *node;
-            finish = start + buffer_size();
+    bool operator!=(const self& iter) const {
+        return !operator==(iter);
+    }
 
-            cur = start;
-        }
+    static size_type buffer_size() {
+        return DEQUE_BUFFER_SIZE;
+    }
+
+    void set_node(map_pointer _node) {
+        node = _node;
+        start = *node;
+        finish = start + buffer_size();
+
+        cur = start;
+    }
+};
+
+template <typename Tp, typename Ref, typename Ptr>
+inline deque_iterator<Tp, Ref, Ptr>
+operator+(ptrdiff_t n, const deque_iterator<Tp, Ref, Ptr>& iter) {
+    return iter + n;
+}
+
+/*
+ * A deque is a list of fixed size buffers, so its iterator is segmented:
+ * every node of the map is a contiguous segment [*node, *node + buffer_size).
+ */
+template <typename Tp, typename Ref, typename Ptr>
+struct segmented_iterator_traits<deque_iterator<Tp, Ref, Ptr>> {
+    typedef true_type                       is_segmented_iterator;
+    typedef deque_iterator<Tp, Ref, Ptr>    iterator;
+    typedef Tp**                            segment_iterator;
+    typedef Ptr                             local_iterator;
+
+    static segment_iterator segment(const iterator& iter) {
+        return iter.node;
+    }
+
+    static local_iterator local(const iterator& iter) {
+        return iter.cur;
+    }
 
-    protected:
-        pointer start;
-        pointer finish;
-        pointer cur;
-        map_pointer node;
+    static local_iterator begin(segment_iterator seg) {
+        return *seg;
+    }
+
+    static local_iterator end(segment_iterator seg) {
+        return *seg + iterator::buffer_size();
+    }
 
-        friend class deque;
-    };
+    // The end of a segment is the begin of the next one.
+    static iterator compose(segment_iterator seg, local_iterator local) {
+        if (local == end(seg))
+            return iterator(seg + 1);
+        return iterator(seg, const_cast<Tp*>(local));
+    }
+};
+
+template<typename Tp, typename Alloc=allocator<Tp>>
+class deque {
+public:
+    typedef Tp           value_type;
+    typedef Tp*          pointer;
+    typedef const Tp*    const_pointer;
+    typedef Tp&          reference;
+    typedef const Tp&    const_reference;
+    typedef size_t       size_type;
+    typedef ptrdiff_t    difference_type;
+
+    typedef pointer*     map_pointer;
+    typedef Alloc        alloc;
+    typedef Alloc        allocator_type;
+
+    typedef deque<Tp, Alloc>     self;
+
+    // The map comes from the same allocator as the buffers, so a deque on
+    // an arena does not touch the heap.
+    typedef typename Alloc::template rebind<pointer>::other map_allocator;
+
+    typedef deque_iterator<Tp, Tp&, Tp*>               iterator;
+    typedef deque_iterator<Tp, const Tp&, const Tp*>   const_iterator;
 
 protected:
+    Alloc data_allocator;
     map_pointer map;
     size_type map_size;
     iterator start;
     iterator finish;
 
 public:
-    deque() {
+    deque()
+        :data_allocator() {
+        create_map(0);
+    }
+
+    explicit deque(const Alloc& allocator)
+        :data_allocator(allocator) {
         create_map(0);
     }
 
     template <typename InputIterator>
-    deque(InputIterator first, InputIterator last)
-        :deque() {
-        while (first != last) {
-            push_back(first);
-        }
+    deque(InputIterator first, InputIterator last,
+          const Alloc& allocator=Alloc())
+        :deque(allocator) {
+        append(first, last);
     }
 
-    deque(const std::initializer_list<Tp>& initializer_list)
-        :deque(initializer_list.begin(), initializer_list.end())
+    deque(const std::initializer_list<Tp>& initializer_list,
+          const Alloc& allocator=Alloc())
+        :deque(initializer_list.begin(), initializer_list.end(), allocator)
     {}
 
-    deque(const self& deq) {
-        map = new pointer[deq.map_size];
-        map_size = deq.map_size;
-        size_type start_node_index = deq.start.node - deq.map;
-        size_type finish_node_index = deq.finish.node - deq.map;
-
-        for (size_type index = start_node_index; index <= finish_node_index;
-             ++index)
-        {
-            map[index] = allocate_node();
-            copy(deq.map[index], deq.map[index] + buffer_size(), map[index]);
-        }
-
-        size_type start_iter_draft = deq.start.cur - *(deq.start.node);
-        size_type finish_iter_draft = deq.finish.cur - *(deq.finish.node);
-        start.set_node(deq.map + start_node_index);
-        start.cur = *start.node + start_iter_draft;
-        finish.set_node(deq.map + finish_node_index);
-        finish.cur = *finish.node + finish_iter_draft;
+    deque(const self& deq)
+        :deque(deq.data_allocator) {
+        append(deq.begin(), deq.end());
     }
 
-    deque(self&& deq) {
+    deque(self&& deq)
+        :data_allocator(deq.data_allocator) {
         start = deq.start;
         finish = deq.finish;
         map = deq.map;
@@ -263,37 +283,33 @@ public:
     }
 
     ~deque() {
-        clear();
+        if (map == nullptr)
+            return;
+        STLL_NAMESPACE::destroy(start, finish);
+        for (map_pointer _node = start.node; _node <= finish.node; ++_node)
+            deallocate_node(*_node);
+        deallocate_map(map, map_size);
     }
 
 
-    self& operator=(const deque<Tp>& deq) {
-        clear();
-        map = new pointer[deq.map_size];
-        map_size = deq.map_size;
-        size_type start_node_index = deq.start.node - deq.map;
-        size_type finish_node_index = deq.finish.node - deq.map;
-        for (size_type index = start_node_index; index <= finish_node_index;
-             ++index) {
-            map[index] = allocate_node();
-            copy(deq.map[index], deq.map[index] + buffer_size(), map[index]);
+    self& operator=(const self& deq) {
+        if (this != &deq) {
+            clear();
+            append(deq.begin(), deq.end());
         }
-        size_type start_iter_draft = deq.start.cur - *(deq.start.node);
-        size_type finish_iter_draft = deq.finish.cur - *(deq.finish.node);
-        start.set_node(deq.map + start_node_index);
-        start.cur = *start.node + start_iter_draft;
-        finish.set_node(deq.map + finish_node_index);
-        finish.cur = *finish.node + finish_iter_draft;
         return *this;
     }
 
+    // Destroy all the elements, only the buffer of start is kept.
     void clear() {
-        if (start.cur && finish.cur)
-            for (map_pointer _node = start.node; _node <= finish.node; ++_node)
-                deallocate_node(*_node);
-        if (map)
-            delete []map;
-        map_size = 0;
+        if (map == nullptr) {
+            create_map(0);
+            return;
+        }
+        STLL_NAMESPACE::destroy(start, finish);
+        for (map_pointer _node = start.node + 1; _node <= finish.node; ++_node)
+            deallocate_node(*_node);
+        finish = start;
     }
 
     const value_type& operator[](size_type index) const {
@@ -310,6 +326,7 @@ public:
             ++finish.cur;
         } else {
             reserve_map_at_back();
+            *(finish.node + 1) = allocate_node();
             new(finish.cur)value_type(value);
             ++finish;
         }
@@ -322,6 +339,7 @@ public:
             ++finish.cur;
         } else {
             reserve_map_at_back();
+            *(finish.node + 1) = allocate_node();
             new(finish.cur)value_type(args...);
             ++finish;
         }
@@ -333,6 +351,7 @@ public:
             new (start.cur)value_type(value);
         } else {
             reserve_map_at_front();
+            *(start.node - 1) = allocate_node();
             --start;
             new (start.cur)value_type(value);
         }
@@ -345,16 +364,89 @@ public:
             new (start.cur)value_type(args...);
         } else {
             reserve_map_at_front();
+            *(start.node - 1) = allocate_node();
             --start;
             new (start.cur)value_type(args...);
         }
     }
 
+    Alloc get_allocator() const {
+        return data_allocator;
+    }
+
     void swap(self& another) {
-        swap(start, another.start);
-        swap(finish, another.finish);
-        swap(map, another.map);
-        swap(map_size, another.map_size);
+        STLL_NAMESPACE::swap(data_allocator, another.data_allocator);
+        STLL_NAMESPACE::swap(start, another.start);
+        STLL_NAMESPACE::swap(finish, another.finish);
+        STLL_NAMESPACE::swap(map, another.map);
+        STLL_NAMESPACE::swap(map_size, another.map_size);
+    }
+
+    /*
+     * Bulk operations.
+     * The map and the buffers are reserved once for the whole range, then
+     * every buffer is filled or drained with a tight loop (memmove for
+     * trivially copyable types) instead of one capacity check per element.
+     */
+
+    // Append [first, last) after the last element.
+    template <typename InputIterator>
+    void append(InputIterator first, InputIterator last) {
+        append_range(first, last, iterator_category(first));
+    }
+
+    // Insert [first, last) before the first element, keeping its order.
+    template <typename ForwardIterator>
+    void prepend(ForwardIterator first, ForwardIterator last) {
+        size_type n = size_type(STLL_NAMESPACE::distance(first, last));
+        iterator new_start = reserve_elements_at_front(n);
+        STLL_NAMESPACE::uninitialized_copy(first, last, new_start);
+        start = new_start;
+    }
+
+    // Pop n elements from the front, write them to out in the order of
+    // successive pop_front() calls, and return the end of out.
+    template <typename OutputIterator>
+    OutputIterator pop_front_n(size_type n, OutputIterator out) {
+        typedef typename type_traits<Tp>::has_trivial_assignment_operator
+                trivial;
+        while (n > 0) {
+            size_type count = front_block_count(n);
+            out = move_block(start.cur, start.cur + count, out, trivial());
+            pop_front_block(count);
+            n -= count;
+        }
+        return out;
+    }
+
+    void pop_front_n(size_type n) {
+        while (n > 0) {
+            size_type count = front_block_count(n);
+            pop_front_block(count);
+            n -= count;
+        }
+    }
+
+    // Pop n elements from the back, write them to out in the order of
+    // successive pop_back() calls, and return the end of out.
+    template <typename OutputIterator>
+    OutputIterator pop_back_n(size_type n, OutputIterator out) {
+        while (n > 0) {
+            size_type count = back_block_count(n);
+            for (pointer p = finish.cur; p != finish.cur - count; ++out)
+                *out = STLL_NAMESPACE::move(*--p);
+            pop_back_block(count);
+            n -= count;
+        }
+        return out;
+    }
+
+    void pop_back_n(size_type n) {
+        while (n > 0) {
+            size_type count = back_block_count(n);
+            pop_back_block(count);
+            n -= count;
+        }
     }
 
     value_type& front() {
@@ -382,10 +474,9 @@ public:
     }
 
     void pop_front() {
-        iterator first = start;
-        (&*first)->~value_type();
-        if (first.cur -1 == start.finish)
-            deallocate_node(*first.node);
+        (&*start)->~value_type();
+        if (start.cur == start.finish - 1)
+            deallocate_node(*start.node);
         ++start;
     }
 
@@ -409,47 +500,191 @@ public:
         return finish;
     }
 
+    const_iterator begin() const {
+        return start;
+    }
+
+    const_iterator end() const {
+        return finish;
+    }
+
+    /*
+     * Call f(span<Tp>) on every contiguous segment of the elements, front
+     * to back, e.g. to hand them to writev() or a SIMD algorithm without a
+     * copy.
+     */
+    template <typename Function>
+    void for_each_segment(Function f) {
+        if (map == nullptr)
+            return;
+        for (map_pointer node = start.node; node <= finish.node; ++node) {
+            pointer first = node == start.node ? start.cur : *node;
+            pointer last = node == finish.node ? finish.cur
+                                               : *node + buffer_size();
+            if (first != last)
+                f(span<Tp>(first, last));
+        }
+    }
+
+    template <typename Function>
+    void for_each_segment(Function f) const {
+        const_cast<self*>(this)->for_each_segment([&f](span<Tp> segment) {
+            f(span<const Tp>(segment));
+        });
+    }
+
 
 protected:
-    void refill_map() {
-        map_size;
-        map_pointer new_map = new pointer[(map_size << 1)];
-        map_pointer p_new_map = new_map + (map_size >> 1);
-
-        for (map_pointer p_map = map; p_map < map + map_size; ++p_map) {
-            *p_new_map = *p_map;
-            if (p_map == start.node) {
-                start.set_node(p_new_map);
-            }
-            if (p_map == finish.node) {
-                finish.set_node(p_new_map);
-            }
-            ++p_new_map;
+    template <typename InputIterator>
+    void append_range(InputIterator first, InputIterator last,
+                      input_iterator_tag) {
+        for (; first != last; ++first)
+            push_back(*first);
+    }
+
+    template <typename ForwardIterator>
+    void append_range(ForwardIterator first, ForwardIterator last,
+                      forward_iterator_tag) {
+        size_type n = size_type(STLL_NAMESPACE::distance(first, last));
+        iterator new_finish = reserve_elements_at_back(n);
+        STLL_NAMESPACE::uninitialized_copy(first, last, finish);
+        finish = new_finish;
+    }
+
+    template <typename OutputIterator>
+    static OutputIterator move_block(pointer first, pointer last,
+                                     OutputIterator out, true_type) {
+        return STLL_NAMESPACE::copy(first, last, out);
+    }
+
+    template <typename OutputIterator>
+    static OutputIterator move_block(pointer first, pointer last,
+                                     OutputIterator out, false_type) {
+        for (; first != last; ++first, ++out)
+            *out = STLL_NAMESPACE::move(*first);
+        return out;
+    }
+
+    // Number of elements which can be popped from the front buffer at once.
+    size_type front_block_count(size_type n) const {
+        size_type block = size_type(start.finish - start.cur);
+        return n < block ? n : block;
+    }
+
+    // Destroy count elements of the front buffer, count must not cross it.
+    void pop_front_block(size_type count) {
+        STLL_NAMESPACE::destroy(start.cur, start.cur + count);
+        start.cur += count;
+        if (start.cur == start.finish) {
+            deallocate_node(*start.node);
+            start.set_node(start.node + 1);
+        }
+    }
+
+    // Number of elements which can be popped from the back buffer at once.
+    // If finish is at the beginning of its buffer, that empty buffer is
+    // released first.
+    size_type back_block_count(size_type n) {
+        if (finish.cur == finish.start) {
+            deallocate_node(*finish.node);
+            finish.set_node(finish.node - 1);
+            finish.cur = finish.finish;
+        }
+        size_type block = size_type(finish.cur - finish.start);
+        return n < block ? n : block;
+    }
+
+    // Destroy count elements of the back buffer, count must not cross it.
+    void pop_back_block(size_type count) {
+        STLL_NAMESPACE::destroy(finish.cur - count, finish.cur);
+        finish.cur -= count;
+    }
+
+    // Make room for n elements after finish and return the new finish.
+    iterator reserve_elements_at_back(size_type n) {
+        size_type vacancies = finish.finish - finish.cur - 1;
+        if (n > vacancies) {
+            size_type new_nodes = (n - vacancies + buffer_size() - 1)
+                                  / buffer_size();
+            reserve_map_at_back(new_nodes);
+            for (size_type i = 1; i <= new_nodes; ++i)
+                *(finish.node + i) = allocate_node();
+        }
+        return finish + difference_type(n);
+    }
+
+    // Make room for n elements before start and return the new start.
+    iterator reserve_elements_at_front(size_type n) {
+        size_type vacancies = start.cur - start.start;
+        if (n > vacancies) {
+            size_type new_nodes = (n - vacancies + buffer_size() - 1)
+                                  / buffer_size();
+            reserve_map_at_front(new_nodes);
+            for (size_type i = 1; i <= new_nodes; ++i)
+                *(start.node - i) = allocate_node();
+        }
+        return start - difference_type(n);
+    }
+
+    // Grow or recenter the map so that nodes_to_add more nodes fit at
+    // the front or at the back. Only the map is touched, not the buffers.
+    void reallocate_map(size_type nodes_to_add, bool add_at_front) {
+        size_type old_num_nodes = finish.node - start.node + 1;
+        size_type new_num_nodes = old_num_nodes + nodes_to_add;
+        size_type start_offset = start.cur - start.start;
+        size_type finish_offset = finish.cur - finish.start;
+
+        map_pointer new_start;
+        if (map_size > 2 * new_num_nodes) {
+            new_start = map + (map_size - new_num_nodes) / 2
+                        + (add_at_front ? nodes_to_add : 0);
+            std::memmove(new_start, start.node,
+                         old_num_nodes * sizeof(pointer));
+        } else {
+            size_type new_map_size = map_size
+                    + (map_size > nodes_to_add ? map_size : nodes_to_add) + 2;
+            map_pointer new_map = allocate_map(new_map_size);
+            new_start = new_map + (new_map_size - new_num_nodes) / 2
+                        + (add_at_front ? nodes_to_add : 0);
+            std::memcpy(new_start, start.node,
+                        old_num_nodes * sizeof(pointer));
+            deallocate_map(map, map_size);
+            map = new_map;
+            map_size = new_map_size;
         }
-        delete []map;
-        map = new_map;
+
+        start.set_node(new_start);
+        start.cur = start.start + start_offset;
+        finish.set_node(new_start + old_num_nodes - 1);
+        finish.cur = finish.start + finish_offset;
     }
 
-    void reserve_map_at_back() {
-        if (finish.node + 1 >= (map + map_size)) {
-            refill_map();
+    void reserve_map_at_back(size_type nodes_to_add=1) {
+        if (nodes_to_add + 1 > map_size - (finish.node - map)) {
+            reallocate_map(nodes_to_add, false);
         }
-        *(finish.node + 1) = allocate_node();
     }
 
-    void reserve_map_at_front() {
-        if (start.node - 1 <= map) {
-            refill_map();
+    void reserve_map_at_front(size_type nodes_to_add=1) {
+        if (nodes_to_add > size_type(start.node - map)) {
+            reallocate_map(nodes_to_add, true);
         }
-        *(start.node - 1) = allocate_node();
     }
 
     pointer allocate_node() {
-        return  alloc::allocate(buffer_size());
+        return data_allocator.allocate(buffer_size());
     }
 
     void deallocate_node(pointer node) {
-        alloc::deallocate(node, buffer_size());
+        data_allocator.deallocate(node, buffer_size());
+    }
+
+    map_pointer allocate_map(size_type size) {
+        return map_allocator(data_allocator).allocate(size);
+    }
+
+    void deallocate_map(map_pointer old_map, size_type size) {
+        map_allocator(data_allocator).deallocate(old_map, size);
     }
 
     void create_map(size_type size) {
@@ -457,7 +692,7 @@ protected:
         size_type max_node_number =
             (8 >  (node_num << 1) ? 8 : (node_num << 1));
 
-        map = new pointer[max_node_number];
+        map = allocate_map(max_node_number);
         map_size = max_node_number;
 
         map_pointer start_node = map + (map_size - node_num) / 2;
@@ -0,0 +1,847 @@
+#ifndef EXECUTION_HPP
+#define EXECUTION_HPP
+
+#include "thread_pool.hpp"
+#include "iterator.hpp"
+#include "functor.hpp"
+#include "move.hpp"
+#include "vector.hpp"
+#include "numeric.hpp"
+#include "heap.hpp"
+
+__STLL_NAMESPACE_START__
+
+/*
+ * Execution policies, passed as the first argument of an algorithm:
+ *     accumulate(seq, first, last, 0)         on the calling thread
+ *     accumulate(par, first, last, 0)         on thread_pool::default_pool()
+ *     accumulate(par_unseq, first, last, 0)   same as par, and each piece
+ *                                             may be vectorized
+ * This file has the parallel forms of the algorithms. Only random access
+ * ranges are split, other ranges and ranges too small to pay for a task run
+ * the sequential algorithm.
+ * A parallel reduction combines its pieces in order, so its operation must
+ * be associative but need not be commutative. The output of a parallel
+ * algorithm must not overlap its input, unless the algorithm says so.
+ */
+struct sequenced_policy {};
+struct parallel_policy {};
+struct parallel_unsequenced_policy : public parallel_policy {};
+
+constexpr sequenced_policy              seq{};
+constexpr parallel_policy               par{};
+constexpr parallel_unsequenced_policy   par_unseq{};
+
+// Below this many elements a piece costs more to schedule than to run.
+enum {PARALLEL_MIN_GRAIN = 4096};
+
+namespace
+{
+
+// About 8 pieces per worker, so that stealing evens out slow pieces, and
+// at least min_grain elements per piece.
+inline size_t __parallel_grain(size_t len,
+                               size_t min_grain=PARALLEL_MIN_GRAIN) {
+    size_t grain = len / (thread_pool::default_pool().size() * 8);
+    return grain < min_grain ? min_grain : grain;
+}
+
+template <typename Function>
+inline void __parallel_for(size_t len, size_t grain, Function body) {
+    thread_pool::default_pool().parallel_for(0, len, grain, body);
+}
+
+// Reduce the pieces of [0, len) with reduce_piece(begin, end) in parallel,
+// then fold their results into init, in order, with combine.
+template <typename Tp, typename ReducePiece, typename Combine>
+Tp __parallel_reduce(size_t len, Tp init, ReducePiece reduce_piece,
+                     Combine combine) {
+    size_t grain = __parallel_grain(len);
+    size_t pieces = (len + grain - 1) / grain;
+    if (pieces <= 1)
+        return len == 0 ? init : combine(init, reduce_piece(0, len));
+
+    vector<Tp> partial(pieces, init);
+    __parallel_for(pieces, 1, [&](size_t first, size_t last) {
+        for (size_t piece = first; piece < last; ++piece) {
+            size_t begin = piece * grain;
+            size_t end = begin + grain < len ? begin + grain : len;
+            partial[piece] = reduce_piece(begin, end);
+        }
+    });
+    for (size_t piece = 0; piece < pieces; ++piece)
+        init = combine(init, partial[piece]);
+    return init;
+}
+
+
+template <typename InputIterator, typename Tp, typename BinaryOperation>
+inline Tp __accumulate_par(InputIterator first, InputIterator last, Tp init,
+                           BinaryOperation binary_operation,
+                           input_iterator_tag) {
+    return STLL_NAMESPACE::accumulate(first, last, init, binary_operation);
+}
+
+template <typename RandomAcessIterator, typename Tp, typename BinaryOperation>
+Tp __accumulate_par(RandomAcessIterator first, RandomAcessIterator last,
+                    Tp init, BinaryOperation binary_operation,
+                    random_access_iterator_tag) {
+    return __parallel_reduce(size_t(last - first), init,
+        [&](size_t begin, size_t end) {
+            Tp value = *(first + begin);
+            return STLL_NAMESPACE::accumulate(first + (begin + 1),
+                                              first + end, value,
+                                              binary_operation);
+        }, binary_operation);
+}
+
+
+template <typename InputIterator1, typename InputIterator2, typename Tp,
+          typename BinaryOperation>
+inline Tp __inner_product_par(InputIterator1 first1, InputIterator1 last1,
+                              InputIterator2 first2, Tp init,
+                              BinaryOperation binary_operation,
+                              input_iterator_tag, input_iterator_tag) {
+    return STLL_NAMESPACE::inner_product(first1, last1, first2, init,
+                                         binary_operation);
+}
+
+template <typename RandomAcessIterator1, typename RandomAcessIterator2,
+          typename Tp, typename BinaryOperation>
+Tp __inner_product_par(RandomAcessIterator1 first1,
+                       RandomAcessIterator1 last1,
+                       RandomAcessIterator2 first2, Tp init,
+                       BinaryOperation binary_operation,
+                       random_access_iterator_tag,
+                       random_access_iterator_tag) {
+    return __parallel_reduce(size_t(last1 - first1), init,
+        [&](size_t begin, size_t end) {
+            Tp value = binary_operation(*(first1 + begin), *(first2 + begin));
+            return STLL_NAMESPACE::inner_product(first1 + (begin + 1),
+                                                 first1 + end,
+                                                 first2 + (begin + 1),
+                                                 value, binary_operation);
+        }, plus<Tp>());
+}
+
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation>
+inline OutputIterator __adjacent_difference_par(
+        InputIterator first, InputIterator last, OutputIterator result,
+        BinaryOperation binary_operation,
+        input_iterator_tag, output_iterator_tag) {
+    return STLL_NAMESPACE::adjacent_difference(first, last, result,
+                                               binary_operation);
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation>
+inline OutputIterator __adjacent_difference_par(
+        InputIterator first, InputIterator last, OutputIterator result,
+        BinaryOperation binary_operation,
+        input_iterator_tag, input_iterator_tag) {
+    return STLL_NAMESPACE::adjacent_difference(first, last, result,
+                                               binary_operation);
+}
+
+// result[i] only depends on first[i] and first[i - 1], so every element
+// is independent.
+template <typename RandomAcessIterator1, typename RandomAcessIterator2,
+          typename BinaryOperation>
+RandomAcessIterator2 __adjacent_difference_par(
+        RandomAcessIterator1 first, RandomAcessIterator1 last,
+        RandomAcessIterator2 result, BinaryOperation binary_operation,
+        random_access_iterator_tag, random_access_iterator_tag) {
+    size_t len = size_t(last - first);
+    if (len == 0)
+        return result;
+    *result = *first;
+    __parallel_for(len - 1, __parallel_grain(len),
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin + 1; i < end + 1; ++i)
+                *(result + i) = binary_operation(*(first + i),
+                                                 *(first + (i - 1)));
+        });
+    return result + len;
+}
+
+
+// Whether the input and the output ranges can both be split in pieces.
+inline false_type __splittable(input_iterator_tag, output_iterator_tag) {
+    return false_type();
+}
+
+inline false_type __splittable(input_iterator_tag, input_iterator_tag) {
+    return false_type();
+}
+
+inline true_type __splittable(random_access_iterator_tag,
+                              random_access_iterator_tag) {
+    return true_type();
+}
+
+// The sum of a piece, which takes the SIMD kernels for plus.
+template <typename RandomAcessIterator, typename Tp, typename BinaryOperation>
+inline Tp __reduce_piece(RandomAcessIterator first, RandomAcessIterator last,
+                         Tp init, BinaryOperation binary_operation) {
+    return STLL_NAMESPACE::accumulate(first, last, init, binary_operation);
+}
+
+template <typename RandomAcessIterator, typename Tp>
+inline Tp __reduce_piece(RandomAcessIterator first, RandomAcessIterator last,
+                         Tp init, plus<Tp>) {
+    return STLL_NAMESPACE::reduce(first, last, init);
+}
+
+/*
+ * Two pass scan of [0, len) from init. The pieces are reduced in parallel
+ * by reduce_piece(begin, end), a sequential scan of their sums gives the
+ * offset of every piece, then scan_piece(begin, end, offset) scans the
+ * pieces in parallel from their offsets. The range is streamed twice
+ * instead of once, but every thread streams it, so the scan is bound by
+ * the memory bandwidth and not by the dependency of an element on the one
+ * before it.
+ * A piece only reads and writes its own elements, so a scan may be done
+ * in place.
+ */
+template <typename Tp, typename ReducePiece, typename ScanPiece,
+          typename Combine>
+void __parallel_scan(size_t len, const Tp& init, ReducePiece reduce_piece,
+                     ScanPiece scan_piece, Combine combine) {
+    size_t grain = __parallel_grain(len);
+    size_t pieces = (len + grain - 1) / grain;
+    // The extra pass only pays off with a second thread.
+    if (thread_pool::default_pool().size() < 2)
+        pieces = 1;
+    if (pieces <= 1) {
+        if (len != 0)
+            scan_piece(size_t(0), len, init);
+        return;
+    }
+
+    vector<Tp> offsets(pieces, init);
+    __parallel_for(pieces - 1, 1, [&](size_t first, size_t last) {
+        for (size_t piece = first; piece < last; ++piece) {
+            offsets[piece + 1] = reduce_piece(piece * grain,
+                                              (piece + 1) * grain);
+        }
+    });
+    for (size_t piece = 1; piece < pieces; ++piece)
+        offsets[piece] = combine(offsets[piece - 1], offsets[piece]);
+
+    __parallel_for(pieces, 1, [&](size_t first, size_t last) {
+        for (size_t piece = first; piece < last; ++piece) {
+            size_t begin = piece * grain;
+            size_t end = begin + grain < len ? begin + grain : len;
+            scan_piece(begin, end, offsets[piece]);
+        }
+    });
+}
+
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation, typename Tp>
+inline OutputIterator __inclusive_scan_par(InputIterator first,
+                                           InputIterator last,
+                                           OutputIterator result,
+                                           BinaryOperation binary_operation,
+                                           Tp init, false_type) {
+    return STLL_NAMESPACE::inclusive_scan(first, last, result,
+                                          binary_operation, init);
+}
+
+template <typename RandomAcessIterator1, typename RandomAcessIterator2,
+          typename BinaryOperation, typename Tp>
+RandomAcessIterator2 __inclusive_scan_par(RandomAcessIterator1 first,
+                                          RandomAcessIterator1 last,
+                                          RandomAcessIterator2 result,
+                                          BinaryOperation binary_operation,
+                                          Tp init, true_type) {
+    size_t len = size_t(last - first);
+    __parallel_scan(len, init,
+        [&](size_t begin, size_t end) {
+            Tp value = *(first + begin);
+            return __reduce_piece(first + (begin + 1), first + end, value,
+                                  binary_operation);
+        },
+        [&](size_t begin, size_t end, const Tp& offset) {
+            STLL_NAMESPACE::inclusive_scan(first + begin, first + end,
+                                           result + begin, binary_operation,
+                                           offset);
+        }, binary_operation);
+    return result + len;
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation>
+inline OutputIterator __inclusive_scan_par(InputIterator first,
+                                           InputIterator last,
+                                           OutputIterator result,
+                                           BinaryOperation binary_operation,
+                                           false_type) {
+    return STLL_NAMESPACE::inclusive_scan(first, last, result,
+                                          binary_operation);
+}
+
+// Without init, the first element is the init of the others.
+template <typename RandomAcessIterator1, typename RandomAcessIterator2,
+          typename BinaryOperation>
+RandomAcessIterator2 __inclusive_scan_par(RandomAcessIterator1 first,
+                                          RandomAcessIterator1 last,
+                                          RandomAcessIterator2 result,
+                                          BinaryOperation binary_operation,
+                                          true_type) {
+    typedef typename iterator_traits<RandomAcessIterator1>::value_type Tp;
+    if (first == last)
+        return result;
+    Tp init = *first;
+    *result = init;
+    return __inclusive_scan_par(first + 1, last, result + 1,
+                                binary_operation, init, true_type());
+}
+
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation, typename Tp>
+inline OutputIterator __exclusive_scan_par(InputIterator first,
+                                           InputIterator last,
+                                           OutputIterator result,
+                                           BinaryOperation binary_operation,
+                                           Tp init, false_type) {
+    return STLL_NAMESPACE::exclusive_scan(first, last, result, init,
+                                          binary_operation);
+}
+
+template <typename RandomAcessIterator1, typename RandomAcessIterator2,
+          typename BinaryOperation, typename Tp>
+RandomAcessIterator2 __exclusive_scan_par(RandomAcessIterator1 first,
+                                          RandomAcessIterator1 last,
+                                          RandomAcessIterator2 result,
+                                          BinaryOperation binary_operation,
+                                          Tp init, true_type) {
+    size_t len = size_t(last - first);
+    __parallel_scan(len, init,
+        [&](size_t begin, size_t end) {
+            Tp value = *(first + begin);
+            return __reduce_piece(first + (begin + 1), first + end, value,
+                                  binary_operation);
+        },
+        [&](size_t begin, size_t end, const Tp& offset) {
+            STLL_NAMESPACE::exclusive_scan(first + begin, first + end,
+                                           result + begin, offset,
+                                           binary_operation);
+        }, binary_operation);
+    return result + len;
+}
+
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation, typename UnaryOperation, typename Tp>
+inline OutputIterator __transform_inclusive_scan_par(
+        InputIterator first, InputIterator last, OutputIterator result,
+        BinaryOperation binary_operation, UnaryOperation unary_operation,
+        Tp init, false_type) {
+    return STLL_NAMESPACE::transform_inclusive_scan(first, last, result,
+                                                    binary_operation,
+                                                    unary_operation, init);
+}
+
+template <typename RandomAcessIterator1, typename RandomAcessIterator2,
+          typename BinaryOperation, typename UnaryOperation, typename Tp>
+RandomAcessIterator2 __transform_inclusive_scan_par(
+        RandomAcessIterator1 first, RandomAcessIterator1 last,
+        RandomAcessIterator2 result, BinaryOperation binary_operation,
+        UnaryOperation unary_operation, Tp init, true_type) {
+    size_t len = size_t(last - first);
+    __parallel_scan(len, init,
+        [&](size_t begin, size_t end) {
+            Tp value = unary_operation(*(first + begin));
+            for (size_t i = begin + 1; i < end; ++i)
+                value = binary_operation(value, unary_operation(*(first + i)));
+            return value;
+        },
+        [&](size_t begin, size_t end, const Tp& offset) {
+            STLL_NAMESPACE::transform_inclusive_scan(
+                first + begin, first + end, result + begin,
+                binary_operation, unary_operation, offset);
+        }, binary_operation);
+    return result + len;
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation, typename UnaryOperation>
+inline OutputIterator __transform_inclusive_scan_par(
+        InputIterator first, InputIterator last, OutputIterator result,
+        BinaryOperation binary_operation, UnaryOperation unary_operation,
+        false_type) {
+    return STLL_NAMESPACE::transform_inclusive_scan(first, last, result,
+                                                    binary_operation,
+                                                    unary_operation);
+}
+
+template <typename RandomAcessIterator1, typename RandomAcessIterator2,
+          typename BinaryOperation, typename UnaryOperation>
+RandomAcessIterator2 __transform_inclusive_scan_par(
+        RandomAcessIterator1 first, RandomAcessIterator1 last,
+        RandomAcessIterator2 result, BinaryOperation binary_operation,
+        UnaryOperation unary_operation, true_type) {
+    if (first == last)
+        return result;
+    auto init = unary_operation(*first);
+    *result = init;
+    return __transform_inclusive_scan_par(first + 1, last, result + 1,
+                                          binary_operation, unary_operation,
+                                          init, true_type());
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation, typename UnaryOperation, typename Tp>
+inline OutputIterator __transform_exclusive_scan_par(
+        InputIterator first, InputIterator last, OutputIterator result,
+        Tp init, BinaryOperation binary_operation,
+        UnaryOperation unary_operation, false_type) {
+    return STLL_NAMESPACE::transform_exclusive_scan(first, last, result,
+                                                    init, binary_operation,
+                                                    unary_operation);
+}
+
+template <typename RandomAcessIterator1, typename RandomAcessIterator2,
+          typename BinaryOperation, typename UnaryOperation, typename Tp>
+RandomAcessIterator2 __transform_exclusive_scan_par(
+        RandomAcessIterator1 first, RandomAcessIterator1 last,
+        RandomAcessIterator2 result, Tp init,
+        BinaryOperation binary_operation, UnaryOperation unary_operation,
+        true_type) {
+    size_t len = size_t(last - first);
+    __parallel_scan(len, init,
+        [&](size_t begin, size_t end) {
+            Tp value = unary_operation(*(first + begin));
+            for (size_t i = begin + 1; i < end; ++i)
+                value = binary_operation(value, unary_operation(*(first + i)));
+            return value;
+        },
+        [&](size_t begin, size_t end, const Tp& offset) {
+            STLL_NAMESPACE::transform_exclusive_scan(
+                first + begin, first + end, result + begin, offset,
+                binary_operation, unary_operation);
+        }, binary_operation);
+    return result + len;
+}
+
+}
+
+
+template <typename InputIterator, typename Tp>
+inline Tp accumulate(const sequenced_policy&, InputIterator first,
+                     InputIterator last, Tp init) {
+    return STLL_NAMESPACE::accumulate(first, last, init);
+}
+
+template <typename InputIterator, typename Tp, typename BinaryOperation>
+inline Tp accumulate(const sequenced_policy&, InputIterator first,
+                     InputIterator last, Tp init,
+                     BinaryOperation binary_operation) {
+    return STLL_NAMESPACE::accumulate(first, last, init, binary_operation);
+}
+
+template <typename InputIterator, typename Tp>
+inline Tp accumulate(const parallel_policy&, InputIterator first,
+                     InputIterator last, Tp init) {
+    return __accumulate_par(first, last, init, plus<Tp>(),
+                            iterator_category(first));
+}
+
+template <typename InputIterator, typename Tp, typename BinaryOperation>
+inline Tp accumulate(const parallel_policy&, InputIterator first,
+                     InputIterator last, Tp init,
+                     BinaryOperation binary_operation) {
+    return __accumulate_par(first, last, init, binary_operation,
+                            iterator_category(first));
+}
+
+
+template <typename InputIterator1, typename InputIterator2, typename Tp>
+inline Tp inner_product(const sequenced_policy&, InputIterator1 first1,
+                        InputIterator1 last1, InputIterator2 first2,
+                        Tp init) {
+    return STLL_NAMESPACE::inner_product(first1, last1, first2, init);
+}
+
+template <typename InputIterator1, typename InputIterator2, typename Tp,
+          typename BinaryOperation>
+inline Tp inner_product(const sequenced_policy&, InputIterator1 first1,
+                        InputIterator1 last1, InputIterator2 first2,
+                        Tp init, BinaryOperation binary_operation) {
+    return STLL_NAMESPACE::inner_product(first1, last1, first2, init,
+                                         binary_operation);
+}
+
+template <typename InputIterator1, typename InputIterator2, typename Tp>
+inline Tp inner_product(const parallel_policy&, InputIterator1 first1,
+                        InputIterator1 last1, InputIterator2 first2,
+                        Tp init) {
+    return __inner_product_par(first1, last1, first2, init,
+                               multiplies<Tp>(),
+                               iterator_category(first1),
+                               iterator_category(first2));
+}
+
+template <typename InputIterator1, typename InputIterator2, typename Tp,
+          typename BinaryOperation>
+inline Tp inner_product(const parallel_policy&, InputIterator1 first1,
+                        InputIterator1 last1, InputIterator2 first2,
+                        Tp init, BinaryOperation binary_operation) {
+    return __inner_product_par(first1, last1, first2, init,
+                               binary_operation,
+                               iterator_category(first1),
+                               iterator_category(first2));
+}
+
+
+template <typename InputIterator, typename OutputIterator>
+inline OutputIterator adjacent_difference(const sequenced_policy&,
+                                          InputIterator first,
+                                          InputIterator last,
+                                          OutputIterator result) {
+    return STLL_NAMESPACE::adjacent_difference(first, last, result);
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation>
+inline OutputIterator adjacent_difference(const sequenced_policy&,
+                                          InputIterator first,
+                                          InputIterator last,
+                                          OutputIterator result,
+                                          BinaryOperation binary_operation) {
+    return STLL_NAMESPACE::adjacent_difference(first, last, result,
+                                               binary_operation);
+}
+
+template <typename InputIterator, typename OutputIterator>
+inline OutputIterator adjacent_difference(const parallel_policy&,
+                                          InputIterator first,
+                                          InputIterator last,
+                                          OutputIterator result) {
+    typedef typename iterator_traits<InputIterator>::value_type Tp;
+    return __adjacent_difference_par(first, last, result, minus<Tp>(),
+                                     iterator_category(first),
+                                     iterator_category(result));
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation>
+inline OutputIterator adjacent_difference(const parallel_policy&,
+                                          InputIterator first,
+                                          InputIterator last,
+                                          OutputIterator result,
+                                          BinaryOperation binary_operation) {
+    return __adjacent_difference_par(first, last, result, binary_operation,
+                                     iterator_category(first),
+                                     iterator_category(result));
+}
+
+
+template <typename InputIterator, typename OutputIterator>
+inline OutputIterator partial_sum(const sequenced_policy&,
+                                  InputIterator first, InputIterator last,
+                                  OutputIterator result) {
+    return STLL_NAMESPACE::partial_sum(first, last, result);
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation>
+inline OutputIterator partial_sum(const sequenced_policy&,
+                                  InputIterator first, InputIterator last,
+                                  OutputIterator result,
+                                  BinaryOperation binary_operation) {
+    return STLL_NAMESPACE::partial_sum(first, last, result,
+                                       binary_operation);
+}
+
+template <typename InputIterator, typename OutputIterator>
+inline OutputIterator partial_sum(const parallel_policy&,
+                                  InputIterator first, InputIterator last,
+                                  OutputIterator result) {
+    typedef typename iterator_traits<InputIterator>::value_type Tp;
+    return __inclusive_scan_par(first, last, result, plus<Tp>(),
+                                __splittable(iterator_category(first),
+                                             iterator_category(result)));
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation>
+inline OutputIterator partial_sum(const parallel_policy&,
+                                  InputIterator first, InputIterator last,
+                                  OutputIterator result,
+                                  BinaryOperation binary_operation) {
+    return __inclusive_scan_par(first, last, result, binary_operation,
+                                __splittable(iterator_category(first),
+                                             iterator_category(result)));
+}
+
+
+template <typename InputIterator, typename OutputIterator>
+inline OutputIterator inclusive_scan(const sequenced_policy&,
+                                     InputIterator first, InputIterator last,
+                                     OutputIterator result) {
+    return STLL_NAMESPACE::inclusive_scan(first, last, result);
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation>
+inline OutputIterator inclusive_scan(const sequenced_policy&,
+                                     InputIterator first, InputIterator last,
+                                     OutputIterator result,
+                                     BinaryOperation binary_operation) {
+    return STLL_NAMESPACE::inclusive_scan(first, last, result,
+                                          binary_operation);
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation, typename Tp>
+inline OutputIterator inclusive_scan(const sequenced_policy&,
+                                     InputIterator first, InputIterator last,
+                                     OutputIterator result,
+                                     BinaryOperation binary_operation,
+                                     Tp init) {
+    return STLL_NAMESPACE::inclusive_scan(first, last, result,
+                                          binary_operation, init);
+}
+
+template <typename InputIterator, typename OutputIterator>
+inline OutputIterator inclusive_scan(const parallel_policy&,
+                                     InputIterator first, InputIterator last,
+                                     OutputIterator result) {
+    typedef typename iterator_traits<InputIterator>::value_type Tp;
+    return __inclusive_scan_par(first, last, result, plus<Tp>(),
+                                __splittable(iterator_category(first),
+                                             iterator_category(result)));
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation>
+inline OutputIterator inclusive_scan(const parallel_policy&,
+                                     InputIterator first, InputIterator last,
+                                     OutputIterator result,
+                                     BinaryOperation binary_operation) {
+    return __inclusive_scan_par(first, last, result, binary_operation,
+                                __splittable(iterator_category(first),
+                                             iterator_category(result)));
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation, typename Tp>
+inline OutputIterator inclusive_scan(const parallel_policy&,
+                                     InputIterator first, InputIterator last,
+                                     OutputIterator result,
+                                     BinaryOperation binary_operation,
+                                     Tp init) {
+    return __inclusive_scan_par(first, last, result, binary_operation, init,
+                                __splittable(iterator_category(first),
+                                             iterator_category(result)));
+}
+
+
+template <typename InputIterator, typename OutputIterator, typename Tp>
+inline OutputIterator exclusive_scan(const sequenced_policy&,
+                                     InputIterator first, InputIterator last,
+                                     OutputIterator result, Tp init) {
+    return STLL_NAMESPACE::exclusive_scan(first, last, result, init);
+}
+
+template <typename InputIterator, typename OutputIterator, typename Tp,
+          typename BinaryOperation>
+inline OutputIterator exclusive_scan(const sequenced_policy&,
+                                     InputIterator first, InputIterator last,
+                                     OutputIterator result, Tp init,
+                                     BinaryOperation binary_operation) {
+    return STLL_NAMESPACE::exclusive_scan(first, last, result, init,
+                                          binary_operation);
+}
+
+template <typename InputIterator, typename OutputIterator, typename Tp>
+inline OutputIterator exclusive_scan(const parallel_policy&,
+                                     InputIterator first, InputIterator last,
+                                     OutputIterator result, Tp init) {
+    return __exclusive_scan_par(first, last, result, plus<Tp>(), init,
+                                __splittable(iterator_category(first),
+                                             iterator_category(result)));
+}
+
+template <typename InputIterator, typename OutputIterator, typename Tp,
+          typename BinaryOperation>
+inline OutputIterator exclusive_scan(const parallel_policy&,
+                                     InputIterator first, InputIterator last,
+                                     OutputIterator result, Tp init,
+                                     BinaryOperation binary_operation) {
+    return __exclusive_scan_par(first, last, result, binary_operation, init,
+                                __splittable(iterator_category(first),
+                                             iterator_category(result)));
+}
+
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation, typename UnaryOperation>
+inline OutputIterator transform_inclusive_scan(
+        const sequenced_policy&, InputIterator first, InputIterator last,
+        OutputIterator result, BinaryOperation binary_operation,
+        UnaryOperation unary_operation) {
+    return STLL_NAMESPACE::transform_inclusive_scan(first, last, result,
+                                                    binary_operation,
+                                                    unary_operation);
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation, typename UnaryOperation, typename Tp>
+inline OutputIterator transform_inclusive_scan(
+        const sequenced_policy&, InputIterator first, InputIterator last,
+        OutputIterator result, BinaryOperation binary_operation,
+        UnaryOperation unary_operation, Tp init) {
+    return STLL_NAMESPACE::transform_inclusive_scan(first, last, result,
+                                                    binary_operation,
+                                                    unary_operation, init);
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation, typename UnaryOperation>
+inline OutputIterator transform_inclusive_scan(
+        const parallel_policy&, InputIterator first, InputIterator last,
+        OutputIterator result, BinaryOperation binary_operation,
+        UnaryOperation unary_operation) {
+    return __transform_inclusive_scan_par(
+                first, last, result, binary_operation, unary_operation,
+                __splittable(iterator_category(first),
+                             iterator_category(result)));
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation, typename UnaryOperation, typename Tp>
+inline OutputIterator transform_inclusive_scan(
+        const parallel_policy&, InputIterator first, InputIterator last,
+        OutputIterator result, BinaryOperation binary_operation,
+        UnaryOperation unary_operation, Tp init) {
+    return __transform_inclusive_scan_par(
+                first, last, result, binary_operation, unary_operation, init,
+                __splittable(iterator_category(first),
+                             iterator_category(result)));
+}
+
+template <typename InputIterator, typename OutputIterator, typename Tp,
+          typename BinaryOperation, typename UnaryOperation>
+inline OutputIterator transform_exclusive_scan(
+        const sequenced_policy&, InputIterator first, InputIterator last,
+        OutputIterator result, Tp init, BinaryOperation binary_operation,
+        UnaryOperation unary_operation) {
+    return STLL_NAMESPACE::transform_exclusive_scan(first, last, result,
+                                                    init, binary_operation,
+                                                    unary_operation);
+}
+
+template <typename InputIterator, typename OutputIterator, typename Tp,
+          typename BinaryOperation, typename UnaryOperation>
+inline OutputIterator transform_exclusive_scan(
+        const parallel_policy&, InputIterator first, InputIterator last,
+        OutputIterator result, Tp init, BinaryOperation binary_operation,
+        UnaryOperation unary_operation) {
+    return __transform_exclusive_scan_par(
+                first, last, result, init, binary_operation, unary_operation,
+                __splittable(iterator_category(first),
+                             iterator_category(result)));
+}
+
+
+/*
+ * Parallel Floyd construction, one level of the tree at a time from the
+ * deepest one: the subtrees rooted at one level are disjoint, so their
+ * sift downs run in parallel. The top levels have few nodes and run on
+ * the calling thread.
+ */
+template <size_t Arity, typename RandomAcessIterator, typename Compare>
+void make_heap(const parallel_policy&, RandomAcessIterator first,
+               RandomAcessIterator last, const Compare& comp) {
+    typedef typename iterator_traits<RandomAcessIterator>::difference_type
+            Distance;
+    typedef typename iterator_traits<RandomAcessIterator>::value_type
+            Tp;
+    Distance len = last - first;
+    if (len < Distance(2 * PARALLEL_MIN_GRAIN)) {
+        STLL_NAMESPACE::make_heap<Arity>(first, last, comp);
+        return;
+    }
+
+    // level_first[k] is the index of the first node of depth k.
+    Distance last_parent = (len - 2) / Distance(Arity);
+    Distance level_first[64];
+    size_t levels = 0;
+    level_first[0] = 0;
+    while (level_first[levels] <= last_parent) {
+        level_first[levels + 1] = level_first[levels] * Distance(Arity) + 1;
+        ++levels;
+    }
+
+    for (size_t level = levels; level-- > 0;) {
+        Distance begin = level_first[level];
+        Distance end = level_first[level + 1] <= last_parent
+                       ? level_first[level + 1] : last_parent + 1;
+        // A node of a higher level sifts down more levels.
+        size_t grain = PARALLEL_MIN_GRAIN / (levels - level);
+        __parallel_for(size_t(end - begin), grain ? grain : 1,
+            [&](size_t piece_first, size_t piece_last) {
+                for (size_t i = piece_first; i < piece_last; ++i) {
+                    Distance hole = begin + Distance(i);
+                    Tp value = STLL_NAMESPACE::move(*(first + hole));
+                    __adjust_heap<Arity>(first, hole, len,
+                                         STLL_NAMESPACE::move(value), comp);
+                }
+            });
+    }
+}
+
+template <size_t Arity, typename RandomAcessIterator>
+inline void make_heap(const parallel_policy& policy,
+                      RandomAcessIterator first, RandomAcessIterator last) {
+    typedef typename iterator_traits<RandomAcessIterator>::value_type Tp;
+    STLL_NAMESPACE::make_heap<Arity>(policy, first, last, less<Tp>());
+}
+
+template <typename RandomAcessIterator, typename Compare>
+inline void make_heap(const parallel_policy& policy,
+                      RandomAcessIterator first, RandomAcessIterator last,
+                      const Compare& comp) {
+    STLL_NAMESPACE::make_heap<2>(policy, first, last, comp);
+}
+
+template <typename RandomAcessIterator>
+inline void make_heap(const parallel_policy& policy,
+                      RandomAcessIterator first, RandomAcessIterator last) {
+    STLL_NAMESPACE::make_heap<2>(policy, first, last);
+}
+
+template <size_t Arity, typename RandomAcessIterator, typename Compare>
+inline void make_heap(const sequenced_policy&, RandomAcessIterator first,
+                      RandomAcessIterator last, const Compare& comp) {
+    STLL_NAMESPACE::make_heap<Arity>(first, last, comp);
+}
+
+template <size_t Arity, typename RandomAcessIterator>
+inline void make_heap(const sequenced_policy&, RandomAcessIterator first,
+                      RandomAcessIterator last) {
+    STLL_NAMESPACE::make_heap<Arity>(first, last);
+}
+
+template <typename RandomAcessIterator, typename Compare>
+inline void make_heap(const sequenced_policy&, RandomAcessIterator first,
+                      RandomAcessIterator last, const Compare& comp) {
+    STLL_NAMESPACE::make_heap<2>(first, last, comp);
+}
+
+template <typename RandomAcessIterator>
+inline void make_heap(const sequenced_policy&, RandomAcessIterator first,
+                      RandomAcessIterator last) {
+    STLL_NAMESPACE::make_heap<2>(first, last);
+}
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // EXECUTION_HPP
@@ -1,6 +1,9 @@
 #ifndef HASH_HPP
 #define HASH_HPP
 
+#include <cstdint>
+#include <cstring>
+
 #include "base.hpp"
 
 __STLL_NAMESPACE_START__
@@ -73,6 +76,43 @@ struct hash<Tp*> {
 };
 
 
+/*
+ * hash_bytes: MurmurHash64A of [data, data + length).
+ * It reads 8 bytes per step and mixes them with two multiplications, so a
+ * key is hashed in one pass over its bytes, not one character at a time,
+ * and every input bit reaches every output bit.
+ */
+inline size_t hash_bytes(const void* data, size_t length, uint64_t seed=0) {
+    const uint64_t m = 0xc6a4a7935bd1e995ull;
+    const int r = 47;
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t h = seed ^ (length * m);
+
+    for (; length >= 8; length -= 8, bytes += 8) {
+        uint64_t k;
+        std::memcpy(&k, bytes, 8);
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+
+    if (length != 0) {
+        uint64_t tail = 0;
+        for (size_t i = 0; i < length; ++i)
+            tail |= uint64_t(bytes[i]) << (8 * i);
+        h ^= tail;
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return size_t(h);
+}
+
+
 template <typename char_t>
 inline size_t hash_string_wrapper(const char_t* s) {
     size_t hash_value = 0;
@@ -49,8 +49,9 @@ public:
         :table(n, hash_fn, key_equal())
     {}
 
-    hash_map(size_type n, const hasher& hash_fn, const key_equal& key_eq)
-        :table(n, hash_fn, key_eq)
+    hash_map(size_type n, const hasher& hash_fn, const key_equal& key_eq,
+             const Alloc& allocator=Alloc())
+        :table(n, hash_fn, key_eq, allocator)
     {}
 
     template <typename InputIterator>
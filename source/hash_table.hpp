@@ -226,18 +226,28 @@ protected:
     typedef hash_table<Value, Key, HashFun, ExtractKey, EqualKey, Alloc>
             self;
 
+public:
+    typedef Alloc                   allocator_type;
+
 protected:
+    // The bucket array comes from the same allocator as the nodes, so a
+    // huge page or arena allocator also backs the buckets.
+    typedef typename Alloc::template rebind<node_type*>::other
+            bucket_allocator;
+    typedef vector<node_type*, bucket_allocator>    bucket_vector;
 
+    Alloc               node_allocator;
     hasher              hash_fun;
     key_equal           equals; 
     ExtractKey          get_key;
-    vector<node_type*>  buckets;
+    bucket_vector       buckets;
 
     size_type           element_count;
 
 public:
     hash_table()
-        :hash_fun(hash<key_type>())
+        :node_allocator()
+        ,hash_fun(hash<key_type>())
         ,equals(equal_to<key_type>())
         ,get_key(identity<key_type>())
         ,element_count(0) {
@@ -245,34 +255,55 @@ public:
     }
 
     hash_table(size_type bucket_size, const HashFun& hash_fun,
-              const EqualKey& eql) 
-        :hash_fun(hash_fun)
+              const EqualKey& eql, const Alloc& allocator=Alloc())
+        :node_allocator(allocator)
+        ,hash_fun(hash_fun)
         ,equals(eql)
         ,get_key(ExtractKey())
+        ,buckets(bucket_allocator(allocator))
         ,element_count(0) {
         initialize_buckets(bucket_size);
     }
 
     hash_table(const self& another)
-        :hash_fun(another.hash_fun)
+        :node_allocator(another.node_allocator)
+        ,hash_fun(another.hash_fun)
         ,equals(another.equals)
-        ,get_key(another.get_key) {
+        ,get_key(another.get_key)
+        ,buckets(another.buckets.get_allocator())
+        ,element_count(0) {
         copy_buckets_from(another);
     }
 
-    hash_table(self&& another) {
+    hash_table(self&& another)
+        :node_allocator(another.node_allocator)
+        ,hash_fun(another.hash_fun)
+        ,equals(another.equals)
+        ,get_key(another.get_key)
+        ,buckets(STLL_NAMESPACE::move(another.buckets))
+        ,element_count(another.element_count) {
+        another.element_count = 0;
+    }
+
+    ~hash_table() {
+        clear();
+    }
+
+    self& operator=(const self& another) {
+        if (this == &another)
+            return *this;
         hash_fun = another.hash_fun;
         equals = another.equals;
         get_key = another.get_key;
-        element_count = another.element_count;
-
-        another.element_count = 0;
-        buckets = std::move(another.buckets);
+        copy_buckets_from(another);
+        return *this;
     }
 
-    self& operator=(const self& another) = default;
-
-    self& operator=(self&& another) = default;
+    self& operator=(self&& another) {
+        clear();
+        swap(another);
+        return *this;
+    }
 
     size_type bucket_count() const {
         return buckets.size();
@@ -330,11 +361,16 @@ public:
         return equals;
     }
 
+    Alloc get_allocator() const {
+        return node_allocator;
+    }
+
     void swap(self& another) {
-        swap(hash_fun, another.hash_fun);
-        swap(equals, another.equals);
-        swap(get_key, another.get_key);
-        swap(element_count, another.element_count);
+        STLL_NAMESPACE::swap(node_allocator, another.node_allocator);
+        STLL_NAMESPACE::swap(hash_fun, another.hash_fun);
+        STLL_NAMESPACE::swap(equals, another.equals);
+        STLL_NAMESPACE::swap(get_key, another.get_key);
+        STLL_NAMESPACE::swap(element_count, another.element_count);
 
         buckets.swap(another.buckets);
     }
@@ -354,7 +390,7 @@ public:
                     next = next->next;
             }
         }
-        copy(buckets.begin(), buckets.end(), nullptr);
+        STLL_NAMESPACE::fill(buckets.begin(), buckets.end(), nullptr);
         element_count = 0;
     }
 
@@ -409,7 +445,7 @@ public:
             return;
         size_type new_size = next_size(size_hint);
 
-        vector<node_type*> tmp (new_size, nullptr);
+        bucket_vector tmp(new_size, nullptr, buckets.get_allocator());
         size_type old_size = bucket_count();
         for (size_type i = 0; i < old_size; ++i) {
             node_type* node = buckets[i];
@@ -515,12 +551,10 @@ protected:
     }
 
     void copy_buckets_from(const self& another) {
-        if (!empty())
-            clear();
-        buckets.reserve(another.buckets.size());
-        copy(buckets.begin(), buckets.end(), nullptr);
+        clear();
+        buckets.clear();
+        initialize_buckets(another.buckets.size());
 
-        node_type* forward_node = nullptr;
         for (size_t i = 0; i < another.buckets.size(); ++i) {
             if (const node_type* node = another.buckets[i]; node != nullptr) {
                 node_type* copied = create_node(node->data);
@@ -547,19 +581,21 @@ protected:
     }
 
     void initialize_buckets(size_type size) {
-        buckets.insert(buckets.begin(), size, nullptr);
+        buckets.reserve(size);
+        while (buckets.size() < size)
+            buckets.push_back(nullptr);
     }
 
     node_type* create_node(const value_type& value) {
-        node_type* node = alloc::allocate(1);
+        node_type* node = node_allocator.allocate(1);
         node->next = nullptr;
         construct(&node->data, value);
         return node;
     }
 
     void destroy_node(node_type* node) {
-        destroy(&node->data);
-        alloc::deallocate(node);
+        STLL_NAMESPACE::destroy(&node->data);
+        node_allocator.deallocate(node, 1);
     }
 
 
@@ -2,125 +2,238 @@
 #define HEAP_HPP
 
 #include "type_traits.hpp"
-#include "vector.hpp"
+#include "iterator.hpp"
+#include "move.hpp"
 #include "functor.hpp"
 
 __STLL_NAMESPACE_START__
 
+/*
+ * Heap algorithms over [first, last) with a compile time arity.
+ * The children of index i are [Arity * i + 1, Arity * i + Arity], they are
+ * contiguous, so with Arity 4 or 8 a node's children usually share one
+ * cache line and the tree is log(Arity) times shallower than a binary heap.
+ *
+ * The functions without an arity use a binary heap, e.g.
+ *     push_heap(first, last)       binary heap
+ *     push_heap<4>(first, last)    4-ary heap
+ */
+
 namespace
 {
 
-template <typename RandomAcessIterator, typename Distance,
+// Sift value up from hole_index, never above top_index.
+template <size_t Arity, typename RandomAcessIterator, typename Distance,
           typename Tp, typename Compare>
 void __push_heap(RandomAcessIterator first, Distance top_index,
-                Distance hole_index, Tp value, const Compare& comp) {
-    if (hole_index == top_index) return;
-    Distance parent_index = (hole_index - 1) / 2;
+                 Distance hole_index, Tp value, const Compare& comp) {
+    Distance parent_index = (hole_index - 1) / Distance(Arity);
     while (hole_index > top_index && comp(*(first + parent_index), value)) {
-        *(first + hole_index) = *(first + parent_index);
+        *(first + hole_index) = STLL_NAMESPACE::move(*(first + parent_index));
         hole_index = parent_index;
-        parent_index = (hole_index - 1) / 2;
+        parent_index = (hole_index - 1) / Distance(Arity);
     }
-    *(first + hole_index) = value;
+    *(first + hole_index) = STLL_NAMESPACE::move(value);
 }
 
+// Index of the greatest child among [child_index, child_index + Arity).
+template <size_t Arity, typename RandomAcessIterator, typename Distance,
+          typename Compare>
+inline Distance __best_child(RandomAcessIterator first, Distance child_index,
+                             Distance len, const Compare& comp) {
+    Distance best = child_index;
+    Distance end = (len - child_index > Distance(Arity))
+                   ? child_index + Distance(Arity) : len;
+    for (Distance index = child_index + 1; index < end; ++index) {
+        if (comp(*(first + best), *(first + index)))
+            best = index;
+    }
+    return best;
 }
 
-template <typename RandomAcessIterator, typename Compare>
+/*
+ * Put value into the heap [first, first + len) at hole_index.
+ * Bottom-up: the hole first goes down to a leaf following the greatest
+ * child, which needs no comparison with value, then value is sifted up
+ * from there. value usually comes from the bottom of the heap and goes
+ * back close to a leaf, so this saves about one comparison per level.
+ */
+template <size_t Arity, typename RandomAcessIterator, typename Distance,
+          typename Tp, typename Compare>
+void __adjust_heap(RandomAcessIterator first, Distance hole_index,
+                   Distance len, Tp value, const Compare& comp) {
+    Distance top_index = hole_index;
+    Distance child_index = hole_index * Distance(Arity) + 1;
+    while (child_index < len) {
+        Distance best = __best_child<Arity>(first, child_index, len, comp);
+        *(first + hole_index) = STLL_NAMESPACE::move(*(first + best));
+        hole_index = best;
+        child_index = hole_index * Distance(Arity) + 1;
+    }
+    __push_heap<Arity>(first, top_index, hole_index,
+                       STLL_NAMESPACE::move(value), comp);
+}
+
+}
+
+template <size_t Arity, typename RandomAcessIterator, typename Compare>
 inline void push_heap(RandomAcessIterator first, RandomAcessIterator last,
                       const Compare& comp) {
     typedef typename iterator_traits<RandomAcessIterator>::difference_type
             Distance;
-
-    __push_heap(first, Distance(0), Distance(last-first-1), *(last-1), comp);
+    typedef typename iterator_traits<RandomAcessIterator>::value_type
+            Tp;
+    if (last - first < 2) return;
+    Tp value = STLL_NAMESPACE::move(*(last - 1));
+    __push_heap<Arity>(first, Distance(0), Distance(last - first - 1),
+                       STLL_NAMESPACE::move(value), comp);
 }
 
-
-template <typename RandomAcessIterator>
+template <size_t Arity, typename RandomAcessIterator>
 inline void push_heap(RandomAcessIterator first, RandomAcessIterator last) {
-    typedef typename iterator_traits<RandomAcessIterator>::difference_type
-            Distance;
     typedef typename iterator_traits<RandomAcessIterator>::value_type
             Tp;
-    __push_heap(first, Distance(0), Distance(last-first-1),
-               *(last-1), less<Tp>());
+    push_heap<Arity>(first, last, less<Tp>());
 }
 
-
 template <typename RandomAcessIterator, typename Compare>
-void pop_heap(RandomAcessIterator first, RandomAcessIterator last,
-                       const Compare& comp) {
-    if (last - first <= 1) return;
+inline void push_heap(RandomAcessIterator first, RandomAcessIterator last,
+                      const Compare& comp) {
+    push_heap<2>(first, last, comp);
+}
 
-    typedef typename type_identity<decltype(*last)>::raw_type Tp;
-    typedef typename type_identity<decltype(last - first)>::raw_type Distance;
+template <typename RandomAcessIterator>
+inline void push_heap(RandomAcessIterator first, RandomAcessIterator last) {
+    push_heap<2>(first, last);
+}
 
-    Tp value = *(last - 1);
-    *(last - 1) = *first;
 
-    Distance len = ((last - first) - 1);
+// Move the top to last - 1 and restore the heap on [first, last - 1).
+template <size_t Arity, typename RandomAcessIterator, typename Compare>
+void pop_heap(RandomAcessIterator first, RandomAcessIterator last,
+              const Compare& comp) {
+    typedef typename iterator_traits<RandomAcessIterator>::difference_type
+            Distance;
+    typedef typename iterator_traits<RandomAcessIterator>::value_type
+            Tp;
+    if (last - first <= 1) return;
 
-    // Precolate down.
-    Distance hole_index = 0;
-    Distance child_index = hole_index * 2 + 1;
-    while (child_index < len) {
-        if (child_index + 1 < len and
-            comp(*(first + child_index), *(first + child_index+1))) {
-            child_index += 1;
-        }
+    Tp value = STLL_NAMESPACE::move(*(last - 1));
+    *(last - 1) = STLL_NAMESPACE::move(*first);
+    __adjust_heap<Arity>(first, Distance(0), Distance((last - first) - 1),
+                         STLL_NAMESPACE::move(value), comp);
+}
 
-        if (!comp(value, *(first + child_index)))
-            break;
+template <size_t Arity, typename RandomAcessIterator>
+inline void pop_heap(RandomAcessIterator first, RandomAcessIterator last) {
+    typedef typename iterator_traits<RandomAcessIterator>::value_type Tp;
+    pop_heap<Arity>(first, last, less<Tp>());
+}
 
-        *(first + hole_index) = *(first + child_index);
-        hole_index = child_index;
-        child_index = hole_index * 2 + 1;
-    }
-    *(first + hole_index) = value;
+template <typename RandomAcessIterator, typename Compare>
+inline void pop_heap(RandomAcessIterator first, RandomAcessIterator last,
+                     const Compare& comp) {
+    pop_heap<2>(first, last, comp);
 }
 
 template <typename RandomAcessIterator>
 inline void pop_heap(RandomAcessIterator first, RandomAcessIterator last) {
-    typedef typename type_identity<decltype(*last)>::raw_type Tp;
-    pop_heap(first, last, less<Tp>());
+    pop_heap<2>(first, last);
 }
 
-template <typename RandomAcessIterator, typename Compare>
+
+template <size_t Arity, typename RandomAcessIterator, typename Compare>
 void sort_heap(RandomAcessIterator first, RandomAcessIterator last,
                const Compare& comp) {
     while (last - first > 1) {
-        pop_heap(first, last, comp);
+        pop_heap<Arity>(first, last, comp);
         --last;
     }
 }
 
-
-template <typename RandomAcessIterator>
-void sort_heap(RandomAcessIterator first, RandomAcessIterator last) {
+template <size_t Arity, typename RandomAcessIterator>
+inline void sort_heap(RandomAcessIterator first, RandomAcessIterator last) {
     typedef typename iterator_traits<RandomAcessIterator>::value_type Tp;
-    sort_heap(first, last, less<Tp>());
+    sort_heap<Arity>(first, last, less<Tp>());
 }
 
 template <typename RandomAcessIterator, typename Compare>
+inline void sort_heap(RandomAcessIterator first, RandomAcessIterator last,
+                      const Compare& comp) {
+    sort_heap<2>(first, last, comp);
+}
+
+template <typename RandomAcessIterator>
+inline void sort_heap(RandomAcessIterator first, RandomAcessIterator last) {
+    sort_heap<2>(first, last);
+}
+
+
+// Floyd's construction: sift down every inner node from the last one
+// to the root, O(n).
+template <size_t Arity, typename RandomAcessIterator, typename Compare>
 void make_heap(RandomAcessIterator first, RandomAcessIterator last,
                const Compare& comp) {
-    if (last - first < 2) return;
     typedef typename iterator_traits<RandomAcessIterator>::difference_type
             Distance;
-    Distance length = 0;
-    RandomAcessIterator iter = first;
-    do {
-        ++iter;
-        push_heap(first, iter, comp);
-    } while (iter != last);
+    typedef typename iterator_traits<RandomAcessIterator>::value_type
+            Tp;
+    Distance len = last - first;
+    if (len < 2) return;
+
+    Distance parent = (len - 2) / Distance(Arity);
+    for (;;) {
+        Tp value = STLL_NAMESPACE::move(*(first + parent));
+        __adjust_heap<Arity>(first, parent, len,
+                             STLL_NAMESPACE::move(value), comp);
+        if (parent == 0)
+            return;
+        --parent;
+    }
 }
 
-template <typename RandomAcessIterator>
-void make_heap(RandomAcessIterator first, RandomAcessIterator last) {
+template <size_t Arity, typename RandomAcessIterator>
+inline void make_heap(RandomAcessIterator first, RandomAcessIterator last) {
     typedef typename iterator_traits<RandomAcessIterator>::value_type Tp;
-    make_heap(first, last, less<Tp>());
+    make_heap<Arity>(first, last, less<Tp>());
 }
 
+template <typename RandomAcessIterator, typename Compare>
+inline void make_heap(RandomAcessIterator first, RandomAcessIterator last,
+                      const Compare& comp) {
+    make_heap<2>(first, last, comp);
+}
+
+template <typename RandomAcessIterator>
+inline void make_heap(RandomAcessIterator first, RandomAcessIterator last) {
+    make_heap<2>(first, last);
+}
+
+
+template <size_t Arity, typename RandomAcessIterator, typename Compare>
+bool is_heap(RandomAcessIterator first, RandomAcessIterator last,
+             const Compare& comp) {
+    typedef typename iterator_traits<RandomAcessIterator>::difference_type
+            Distance;
+    Distance len = last - first;
+    for (Distance child = 1; child < len; ++child) {
+        if (comp(*(first + (child - 1) / Distance(Arity)), *(first + child)))
+            return false;
+    }
+    return true;
+}
+
+template <typename RandomAcessIterator, typename Compare>
+inline bool is_heap(RandomAcessIterator first, RandomAcessIterator last,
+                    const Compare& comp) {
+    return is_heap<2>(first, last, comp);
+}
+
+template <typename RandomAcessIterator>
+inline bool is_heap(RandomAcessIterator first, RandomAcessIterator last) {
+    typedef typename iterator_traits<RandomAcessIterator>::value_type Tp;
+    return is_heap<2>(first, last, less<Tp>());
+}
 
 
 __STLL_NAMESPACE_FINISH__
@@ -0,0 +1,237 @@
+#ifndef HUGE_PAGE_ALLOCATOR_HPP
+#define HUGE_PAGE_ALLOCATOR_HPP
+
+#include <cstdio>
+#include <cstdint>
+#include <new>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#define __STLL_HUGE_PAGES__
+#endif
+
+#include "base.hpp"
+#include "allocator.hpp"
+
+__STLL_NAMESPACE_START__
+
+// Requests from this many bytes are backed by huge pages.
+#ifndef STLL_HUGE_PAGE_THRESHOLD
+#define STLL_HUGE_PAGE_THRESHOLD (2 << 20)
+#endif
+
+enum {HUGE_PAGE_SIZE = 2 << 20};
+
+/*
+ * How the large requests of huge_page_alloc were served, one count per
+ * mapping, and the bytes mapped now.
+ * hugetlb mappings come from the reserved huge page pool and are huge
+ * pages for sure. transparent mappings were only advised to the kernel,
+ * which may back them with huge pages, see resident_huge_bytes(). regular
+ * mappings got neither.
+ */
+struct huge_page_stats {
+    size_t      hugetlb_mappings;
+    size_t      transparent_mappings;
+    size_t      regular_mappings;
+    size_t      mapped_bytes;
+};
+
+/*
+ * huge_page_alloc_template: a request of STLL_HUGE_PAGE_THRESHOLD bytes or
+ * more is rounded up to HUGE_PAGE_SIZE and mapped on a huge page boundary.
+ * It tries, in order, explicit huge pages (MAP_HUGETLB), transparent huge
+ * pages (madvise MADV_HUGEPAGE) and regular pages. A 2 MB page covers what
+ * takes 512 TLB entries with 4 KB pages, which pays off for random access
+ * to a big array. Smaller requests go to operator new.
+ */
+template <int inst>
+class huge_page_alloc_template {
+private:
+    static huge_page_stats counters;
+
+    static size_t round_up_huge(size_t bytes) {
+        return (bytes + HUGE_PAGE_SIZE - 1) & ~size_t(HUGE_PAGE_SIZE - 1);
+    }
+
+#ifdef __STLL_HUGE_PAGES__
+    // bytes of regular pages aligned on a huge page, or nullptr.
+    static void* map_huge_aligned(size_t bytes) {
+        size_t total = bytes + HUGE_PAGE_SIZE;
+        void* memory = mmap(nullptr, total, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            return nullptr;
+        char* region = (char*)memory;
+        char* aligned = (char*)(
+            (uintptr_t(region) + HUGE_PAGE_SIZE - 1)
+            & ~uintptr_t(HUGE_PAGE_SIZE - 1)
+        );
+        if (aligned != region)
+            munmap(region, aligned - region);
+        if (region + total != aligned + bytes)
+            munmap(aligned + bytes, region + total - (aligned + bytes));
+        return aligned;
+    }
+#endif
+
+    static void* map(size_t bytes) {
+#ifdef __STLL_HUGE_PAGES__
+        void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED) {
+            ++counters.hugetlb_mappings;
+            return memory;
+        }
+
+        memory = map_huge_aligned(bytes);
+        if (memory == nullptr)
+            throw std::bad_alloc();
+        if (madvise(memory, bytes, MADV_HUGEPAGE) == 0)
+            ++counters.transparent_mappings;
+        else
+            ++counters.regular_mappings;
+        return memory;
+#else
+        ++counters.regular_mappings;
+        return __allocate_bytes(bytes, HUGE_PAGE_SIZE);
+#endif
+    }
+
+    static void unmap(void* p, size_t bytes) {
+#ifdef __STLL_HUGE_PAGES__
+        munmap(p, bytes);
+#else
+        __deallocate_bytes(p, bytes, HUGE_PAGE_SIZE);
+#endif
+    }
+
+public:
+    // bytes aligned on align, the same bytes and align must be given back
+    // to deallocate.
+    static void* allocate(size_t bytes, size_t align) {
+        if (bytes < STLL_HUGE_PAGE_THRESHOLD or align > HUGE_PAGE_SIZE)
+            return __allocate_bytes(bytes, align);
+        bytes = round_up_huge(bytes);
+        void* memory = map(bytes);
+        counters.mapped_bytes += bytes;
+        return memory;
+    }
+
+    static void deallocate(void* p, size_t bytes, size_t align) {
+        if (bytes < STLL_HUGE_PAGE_THRESHOLD or align > HUGE_PAGE_SIZE) {
+            __deallocate_bytes(p, bytes, align);
+            return;
+        }
+        bytes = round_up_huge(bytes);
+        counters.mapped_bytes -= bytes;
+        unmap(p, bytes);
+    }
+
+    static huge_page_stats stats() {
+        return counters;
+    }
+
+    /*
+     * Bytes of [p, p + bytes) which the kernel backs with huge pages right
+     * now, read from /proc/self/smaps. Transparent huge pages are only
+     * given when the memory is touched, and only if the system enables
+     * them, so this tells whether the advice was followed. 0 where smaps
+     * is not available.
+     */
+    static size_t resident_huge_bytes(const void* p, size_t bytes) {
+        size_t total = 0;
+#ifdef __STLL_HUGE_PAGES__
+        FILE* smaps = fopen("/proc/self/smaps", "r");
+        if (smaps == nullptr)
+            return 0;
+        uintptr_t first = uintptr_t(p);
+        uintptr_t last = first + bytes;
+        bool inside = false;
+        char line[256];
+        while (fgets(line, sizeof(line), smaps)) {
+            unsigned long start = 0;
+            unsigned long finish = 0;
+            size_t kilobytes = 0;
+            if (line[0] >= 'a' or (line[0] >= '0' and line[0] <= '9')) {
+                // Header of a mapping: "start-finish perms ...".
+                if (sscanf(line, "%lx-%lx", &start, &finish) == 2)
+                    inside = start < last and finish > first;
+            } else if (inside
+                       and (sscanf(line, "AnonHugePages: %zu kB",
+                                   &kilobytes) == 1
+                            or sscanf(line, "Private_Hugetlb: %zu kB",
+                                      &kilobytes) == 1)) {
+                total += kilobytes * 1024;
+            }
+        }
+        fclose(smaps);
+#endif
+        return total;
+    }
+};
+
+template <int inst>
+huge_page_stats huge_page_alloc_template<inst>::counters = huge_page_stats();
+
+using huge_page_alloc = huge_page_alloc_template<0>;
+
+
+/*
+ * huge_page_allocator: the allocator form of huge_page_alloc, e.g.
+ *     vector<double, huge_page_allocator<double>> samples;
+ *     hash_set<long, hash<long>, equal_to<long>,
+ *              huge_page_allocator<hashtable_node<long>>> index;
+ * the hash table rebinds it for its bucket array, which is the part that
+ * takes the random accesses.
+ */
+template <class Tp>
+class huge_page_allocator {
+public:
+    typedef Tp           value_type;
+    typedef Tp*          pointer;
+    typedef const Tp*    const_pointer;
+    typedef Tp&          reference;
+    typedef const Tp&    const_reference;
+    typedef size_t       size_type;
+    typedef ptrdiff_t    difference_type;
+
+    template <class Up>
+    struct rebind {
+        typedef huge_page_allocator<Up> other;
+    };
+
+public:
+    huge_page_allocator() {}
+
+    template <class Up>
+    huge_page_allocator(const huge_page_allocator<Up>&) {}
+
+    static pointer allocate(size_type size,
+                     const void* =static_cast<const void*>(nullptr)) {
+        return static_cast<pointer>(
+                    huge_page_alloc::allocate(size * sizeof(Tp), alignof(Tp)));
+    }
+
+    static void deallocate(pointer ptr, size_type size) {
+        huge_page_alloc::deallocate(ptr, size * sizeof(Tp), alignof(Tp));
+    }
+
+    static size_type max_size() {
+        return max(size_type(1), size_type(~size_t(0) / sizeof (Tp)));
+    }
+
+    template <class Up>
+    bool operator==(const huge_page_allocator<Up>&) const {
+        return true;
+    }
+
+    template <class Up>
+    bool operator!=(const huge_page_allocator<Up>&) const {
+        return false;
+    }
+};
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // HUGE_PAGE_ALLOCATOR_HPP
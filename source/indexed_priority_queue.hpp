@@ -0,0 +1,229 @@
+#ifndef INDEXED_PRIORITY_QUEUE_HPP
+#define INDEXED_PRIORITY_QUEUE_HPP
+
+#include "vector.hpp"
+#include "heap.hpp"
+#include "functor.hpp"
+#include "move.hpp"
+
+__STLL_NAMESPACE_START__
+
+/*
+ * indexed_priority_queue: a d-ary heap which returns a handle from push.
+ * The handle reaches its element in O(1), so the priority of a queued
+ * element can be changed, or the element erased, in O(log n) instead of
+ * pushing a duplicate and skipping the stale entry when it is popped.
+ *
+ * positions[handle] is the index of the element in the heap, every sift
+ * routine updates it when it moves an element.
+ * A handle is valid until its element is popped or erased, after that it
+ * may be returned again by a later push.
+ */
+template <typename Tp, typename Compare=less<Tp>, size_t Arity=2>
+class indexed_priority_queue {
+public:
+    typedef Tp              value_type;
+    typedef const Tp&       const_reference;
+    typedef size_t          size_type;
+    typedef size_t          handle_type;
+    typedef Compare         value_compare;
+
+    typedef indexed_priority_queue<Tp, Compare, Arity>  self;
+
+    enum {arity = Arity};
+
+protected:
+    struct entry_type {
+        value_type      value;
+        handle_type     handle;
+    };
+
+    struct entry_compare {
+        Compare comp;
+
+        entry_compare(const Compare& comp)
+            :comp(comp)
+        {}
+
+        bool operator()(const entry_type& lhs, const entry_type& rhs) const {
+            return comp(lhs.value, rhs.value);
+        }
+    };
+
+    static size_type npos() {
+        return size_type(-1);
+    }
+
+    vector<entry_type>      heap;
+    vector<size_type>       positions;
+    vector<handle_type>     free_handles;
+    entry_compare           comp;
+
+public:
+    explicit indexed_priority_queue(const Compare& comp=Compare())
+        :heap(), positions(), free_handles(), comp(comp)
+    {}
+
+    bool empty() const {
+        return heap.empty();
+    }
+
+    size_type size() const {
+        return heap.size();
+    }
+
+    const_reference top() const {
+        return heap.front().value;
+    }
+
+    handle_type top_handle() const {
+        return heap.front().handle;
+    }
+
+    // Whether handle refers to an element which is still queued.
+    bool contains(handle_type handle) const {
+        return handle < positions.size() and positions[handle] != npos();
+    }
+
+    const_reference operator[](handle_type handle) const {
+        return heap[positions[handle]].value;
+    }
+
+    handle_type push(const value_type& value) {
+        handle_type handle = new_handle();
+        heap.emplace_back(entry_type{value, handle});
+        sift_up(heap.size() - 1);
+        return handle;
+    }
+
+    handle_type push(value_type&& value) {
+        handle_type handle = new_handle();
+        heap.emplace_back(entry_type{STLL_NAMESPACE::move(value), handle});
+        sift_up(heap.size() - 1);
+        return handle;
+    }
+
+    // Remove the top. The last element goes to the root with a bottom-up
+    // sift, like pop_heap.
+    void pop() {
+        release_handle(heap[0].handle);
+        entry_type last = STLL_NAMESPACE::move(heap[heap.size() - 1]);
+        heap.pop_back();
+        if (heap.empty())
+            return;
+
+        size_type len = heap.size();
+        size_type hole = 0;
+        size_type child = 1;
+        while (child < len) {
+            size_type best = __best_child<Arity>(heap.begin(), child, len,
+                                                 comp);
+            place(hole, STLL_NAMESPACE::move(heap[best]));
+            hole = best;
+            child = hole * Arity + 1;
+        }
+        place(hole, STLL_NAMESPACE::move(last));
+        sift_up(hole);
+    }
+
+    // Give the element of handle a new priority, it moves up or down.
+    void update(handle_type handle, const value_type& value) {
+        size_type index = positions[handle];
+        heap[index].value = value;
+        restore(index);
+    }
+
+    void update(handle_type handle, value_type&& value) {
+        size_type index = positions[handle];
+        heap[index].value = STLL_NAMESPACE::move(value);
+        restore(index);
+    }
+
+    // Remove the element of handle, which must be queued.
+    void erase(handle_type handle) {
+        size_type index = positions[handle];
+        size_type last = heap.size() - 1;
+        release_handle(handle);
+        if (index != last)
+            place(index, STLL_NAMESPACE::move(heap[last]));
+        heap.pop_back();
+        if (index != last)
+            restore(index);
+    }
+
+    void reserve(size_type n) {
+        heap.reserve(n);
+        positions.reserve(n);
+    }
+
+    // Remove every element, all the handles become invalid.
+    void clear() {
+        heap.clear();
+        positions.clear();
+        free_handles.clear();
+    }
+
+protected:
+    handle_type new_handle() {
+        if (!free_handles.empty()) {
+            handle_type handle = free_handles.back();
+            free_handles.pop_back();
+            return handle;
+        }
+        positions.push_back(npos());
+        return positions.size() - 1;
+    }
+
+    void release_handle(handle_type handle) {
+        positions[handle] = npos();
+        free_handles.push_back(handle);
+    }
+
+    void place(size_type index, entry_type&& entry) {
+        heap[index] = STLL_NAMESPACE::move(entry);
+        positions[heap[index].handle] = index;
+    }
+
+    // The element at index changed, move it to where it belongs.
+    void restore(size_type index) {
+        if (index > 0 and comp(heap[(index - 1) / Arity], heap[index]))
+            sift_up(index);
+        else
+            sift_down(index);
+    }
+
+    // Same as __push_heap, but keeps positions up to date.
+    void sift_up(size_type hole) {
+        entry_type entry = STLL_NAMESPACE::move(heap[hole]);
+        while (hole > 0) {
+            size_type parent = (hole - 1) / Arity;
+            if (!comp(heap[parent], entry))
+                break;
+            place(hole, STLL_NAMESPACE::move(heap[parent]));
+            hole = parent;
+        }
+        place(hole, STLL_NAMESPACE::move(entry));
+    }
+
+    // Top-down sift which stops as soon as the element is in place: an
+    // updated element usually moves only a few levels.
+    void sift_down(size_type hole) {
+        entry_type entry = STLL_NAMESPACE::move(heap[hole]);
+        size_type len = heap.size();
+        size_type child = hole * Arity + 1;
+        while (child < len) {
+            size_type best = __best_child<Arity>(heap.begin(), child, len,
+                                                 comp);
+            if (!comp(entry, heap[best]))
+                break;
+            place(hole, STLL_NAMESPACE::move(heap[best]));
+            hole = best;
+            child = hole * Arity + 1;
+        }
+        place(hole, STLL_NAMESPACE::move(entry));
+    }
+};
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // INDEXED_PRIORITY_QUEUE_HPP
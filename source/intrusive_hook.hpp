@@ -0,0 +1,83 @@
+#ifndef INTRUSIVE_HOOK_HPP
+#define INTRUSIVE_HOOK_HPP
+
+#include "base.hpp"
+
+__STLL_NAMESPACE_START__
+
+/*
+ * Intrusive containers do not own their elements: the links live in a hook
+ * which is a part of the element itself, so linking an object never
+ * allocates or copies it.
+ *
+ * A value traits type tells an intrusive container how to go from a value
+ * to its hook and back:
+ *   value_type, hook_type
+ *   to_hook(value_type*), to_value(hook_type*)
+ *
+ * base_hook:   the value derives from the hook.
+ * member_hook: the value holds the hook as a data member.
+ *
+ * An object can be in several containers at the same time, as long as it
+ * uses a different hook for each one (different tags or different members).
+ */
+
+struct default_hook_tag {};
+
+template <typename Value, typename Hook>
+struct base_hook {
+    typedef Value       value_type;
+    typedef Hook        hook_type;
+
+    static hook_type* to_hook(value_type* value) {
+        return static_cast<hook_type*>(value);
+    }
+
+    static const hook_type* to_hook(const value_type* value) {
+        return static_cast<const hook_type*>(value);
+    }
+
+    static value_type* to_value(hook_type* hook) {
+        return static_cast<value_type*>(hook);
+    }
+
+    static const value_type* to_value(const hook_type* hook) {
+        return static_cast<const value_type*>(hook);
+    }
+};
+
+template <typename Value, typename Hook, Hook Value::*Member>
+struct member_hook {
+    typedef Value       value_type;
+    typedef Hook        hook_type;
+
+    static hook_type* to_hook(value_type* value) {
+        return &(value->*Member);
+    }
+
+    static const hook_type* to_hook(const value_type* value) {
+        return &(value->*Member);
+    }
+
+    static value_type* to_value(hook_type* hook) {
+        return reinterpret_cast<value_type*>(
+                    reinterpret_cast<char*>(hook) - offset());
+    }
+
+    static const value_type* to_value(const hook_type* hook) {
+        return reinterpret_cast<const value_type*>(
+                    reinterpret_cast<const char*>(hook) - offset());
+    }
+
+    // Offset of the hook member inside value_type.
+    static ptrdiff_t offset() {
+        const value_type* value = reinterpret_cast<const value_type*>(
+                                      alignof(value_type) * 64);
+        return reinterpret_cast<const char*>(&(value->*Member))
+               - reinterpret_cast<const char*>(value);
+    }
+};
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // INTRUSIVE_HOOK_HPP
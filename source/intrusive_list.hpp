@@ -0,0 +1,383 @@
+#ifndef INTRUSIVE_LIST_HPP
+#define INTRUSIVE_LIST_HPP
+
+#include "iterator.hpp"
+#include "utility.hpp"
+#include "intrusive_hook.hpp"
+
+__STLL_NAMESPACE_START__
+
+/*
+ * Hook of intrusive_list. The list is circular around its head, so a
+ * linked hook always has non null prev and next, and can be unlinked in
+ * O(1) without knowing which list it belongs to.
+ * An object deriving from several list_base_hook must give each of them
+ * a different Tag.
+ */
+template <typename Tag=default_hook_tag>
+struct list_base_hook {
+    typedef list_base_hook<Tag>     hook_type;
+
+    hook_type*  prev;
+    hook_type*  next;
+
+    list_base_hook()
+        :prev(nullptr), next(nullptr)
+    {}
+
+    // Copying an object does not copy its links.
+    list_base_hook(const hook_type&)
+        :prev(nullptr), next(nullptr)
+    {}
+
+    hook_type& operator=(const hook_type&) {
+        return *this;
+    }
+
+    bool is_linked() const {
+        return next != nullptr;
+    }
+
+    // Unlink the hook from whatever list it is in.
+    // The list's cached size is not updated, use intrusive_list::erase
+    // when the list is known.
+    void unlink() {
+        prev->next = next;
+        next->prev = prev;
+        prev = next = nullptr;
+    }
+};
+
+struct list_member_hook_tag {};
+typedef list_base_hook<list_member_hook_tag>    list_member_hook;
+
+
+template <typename Value, typename ValueTraits, typename Ref, typename Ptr>
+struct intrusive_list_iterator {
+    typedef bidirectional_iterator_tag  iterator_category;
+    typedef Value                       value_type;
+    typedef Ref                         reference;
+    typedef Ptr                         pointer;
+    typedef ptrdiff_t                   difference_type;
+    typedef size_t                      size_type;
+
+    typedef typename ValueTraits::hook_type     node_type;
+
+    typedef intrusive_list_iterator<Value, ValueTraits, Ref, Ptr>    self;
+    typedef intrusive_list_iterator<Value, ValueTraits, Value&, Value*>
+            iterator;
+    typedef intrusive_list_iterator<Value, ValueTraits,
+                                    const Value&, const Value*>
+            const_iterator;
+
+    node_type* node;
+
+    intrusive_list_iterator(node_type* node=nullptr)
+        :node(node)
+    {}
+
+    intrusive_list_iterator(const iterator& iter)
+        :node(iter.node)
+    {}
+
+    self& operator++() {
+        node = node->next;
+        return *this;
+    }
+
+    self operator++(int) {
+        self tmp = *this;
+        node = node->next;
+        return tmp;
+    }
+
+    self& operator--() {
+        node = node->prev;
+        return *this;
+    }
+
+    self operator--(int) {
+        self tmp = *this;
+        node = node->prev;
+        return tmp;
+    }
+
+    reference operator*() const {
+        return *ValueTraits::to_value(node);
+    }
+
+    pointer operator->() const {
+        return &(operator*());
+    }
+
+    bool operator==(const self& other) const {
+        return node == other.node;
+    }
+
+    bool operator!=(const self& other) const {
+        return node != other.node;
+    }
+};
+
+
+/*
+ * intrusive_list: a circular doubly linked list of objects which embed
+ * their own list hook. It never allocates, the size is cached, and any
+ * element can be unlinked or spliced in O(1).
+ * The list does not own the elements: destroying the list only unlinks them.
+ */
+template <typename Value,
+          typename ValueTraits=base_hook<Value, list_base_hook<>>>
+class intrusive_list {
+public:
+    typedef Value           value_type;
+    typedef Value&          reference;
+    typedef const Value&    const_reference;
+    typedef Value*          pointer;
+    typedef const Value*    const_pointer;
+    typedef size_t          size_type;
+    typedef ptrdiff_t       difference_type;
+
+    typedef ValueTraits                         value_traits;
+    typedef typename ValueTraits::hook_type     node_type;
+
+    typedef intrusive_list<Value, ValueTraits>      self;
+
+    typedef intrusive_list_iterator<Value, ValueTraits, Value&, Value*>
+            iterator;
+    typedef intrusive_list_iterator<Value, ValueTraits,
+                                    const Value&, const Value*>
+            const_iterator;
+
+protected:
+    node_type       head;
+    size_type       length;
+
+public:
+    intrusive_list() {
+        init();
+    }
+
+    intrusive_list(const self&) = delete;
+
+    intrusive_list(self&& other) {
+        init();
+        splice(end(), other);
+    }
+
+    ~intrusive_list() {
+        clear();
+    }
+
+    self& operator=(const self&) = delete;
+
+    self& operator=(self&& other) {
+        clear();
+        splice(end(), other);
+        return *this;
+    }
+
+    iterator begin() {
+        return iterator(head.next);
+    }
+
+    iterator end() {
+        return iterator(&head);
+    }
+
+    const_iterator begin() const {
+        return const_iterator(head.next);
+    }
+
+    const_iterator end() const {
+        return const_iterator(const_cast<node_type*>(&head));
+    }
+
+    size_type size() const {
+        return length;
+    }
+
+    bool empty() const {
+        return length == 0;
+    }
+
+    reference front() {
+        return *value_traits::to_value(head.next);
+    }
+
+    const_reference front() const {
+        return *value_traits::to_value(head.next);
+    }
+
+    reference back() {
+        return *value_traits::to_value(head.prev);
+    }
+
+    const_reference back() const {
+        return *value_traits::to_value(head.prev);
+    }
+
+    void push_front(reference value) {
+        link_before(head.next, value_traits::to_hook(&value));
+    }
+
+    void push_back(reference value) {
+        link_before(&head, value_traits::to_hook(&value));
+    }
+
+    void pop_front() {
+        unlink(head.next);
+    }
+
+    void pop_back() {
+        unlink(head.prev);
+    }
+
+    // Link value before pos and return an iterator to it.
+    iterator insert(iterator pos, reference value) {
+        node_type* node = value_traits::to_hook(&value);
+        link_before(pos.node, node);
+        return iterator(node);
+    }
+
+    // Unlink the element at pos and return an iterator to the next one.
+    iterator erase(iterator pos) {
+        node_type* next = pos.node->next;
+        unlink(pos.node);
+        return iterator(next);
+    }
+
+    iterator erase(iterator first, iterator last) {
+        while (first != last)
+            first = erase(first);
+        return last;
+    }
+
+    // Unlink value, which must be linked in this list, in O(1).
+    void erase(reference value) {
+        unlink(value_traits::to_hook(&value));
+    }
+
+    // Move all the elements of other before pos in O(1).
+    void splice(iterator pos, self& other) {
+        if (other.empty() or &other == this)
+            return;
+        transfer(pos.node, other.head.next, &other.head);
+        length += other.length;
+        other.init();
+    }
+
+    // Move the element at iter of other before pos in O(1).
+    void splice(iterator pos, self& other, iterator iter) {
+        node_type* node = iter.node;
+        if (node == pos.node or node->next == pos.node)
+            return;
+        other.unlink(node);
+        link_before(pos.node, node);
+    }
+
+    // Move [first, last) of other before pos. It is O(1) within one list
+    // and O(last - first) between two lists, to keep both sizes cached.
+    void splice(iterator pos, self& other, iterator first, iterator last) {
+        if (first == last)
+            return;
+        if (&other != this) {
+            size_type n = size_type(distance(first, last));
+            other.length -= n;
+            length += n;
+        }
+        transfer(pos.node, first.node, last.node);
+    }
+
+    // The iterator pointing to value, which must be linked in this list.
+    iterator iterator_to(reference value) {
+        return iterator(value_traits::to_hook(&value));
+    }
+
+    const_iterator iterator_to(const_reference value) const {
+        return const_iterator(
+                const_cast<node_type*>(value_traits::to_hook(&value)));
+    }
+
+    void swap(self& other) {
+        self tmp;
+        tmp.splice(tmp.end(), other);
+        other.splice(other.end(), *this);
+        splice(end(), tmp);
+    }
+
+    // Unlink every element.
+    void clear() {
+        clear_and_dispose(null_disposer());
+    }
+
+    // Unlink every element and call disposer(pointer) on it, for example
+    // to give the objects back to their pool.
+    template <typename Disposer>
+    void clear_and_dispose(Disposer disposer) {
+        node_type* node = head.next;
+        while (node != &head) {
+            node_type* next = node->next;
+            node->prev = node->next = nullptr;
+            disposer(value_traits::to_value(node));
+            node = next;
+        }
+        init();
+    }
+
+    template <typename Pred>
+    size_type remove_if(Pred pred) {
+        size_type removed = 0;
+        node_type* node = head.next;
+        while (node != &head) {
+            node_type* next = node->next;
+            if (pred(*value_traits::to_value(node))) {
+                unlink(node);
+                ++removed;
+            }
+            node = next;
+        }
+        return removed;
+    }
+
+protected:
+    struct null_disposer {
+        void operator()(pointer) const {}
+    };
+
+    void init() {
+        head.prev = head.next = &head;
+        length = 0;
+    }
+
+    void link_before(node_type* pos, node_type* node) {
+        node->next = pos;
+        node->prev = pos->prev;
+        pos->prev->next = node;
+        pos->prev = node;
+        ++length;
+    }
+
+    void unlink(node_type* node) {
+        node->unlink();
+        --length;
+    }
+
+    // Move [first, last) before pos, the sizes are not touched.
+    static void transfer(node_type* pos, node_type* first, node_type* last) {
+        if (pos == last)
+            return;
+        node_type* before_last = last->prev;
+        first->prev->next = last;
+        last->prev = first->prev;
+
+        before_last->next = pos;
+        first->prev = pos->prev;
+        pos->prev->next = first;
+        pos->prev = before_last;
+    }
+};
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // INTRUSIVE_LIST_HPP
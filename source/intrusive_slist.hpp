@@ -0,0 +1,335 @@
+#ifndef INTRUSIVE_SLIST_HPP
+#define INTRUSIVE_SLIST_HPP
+
+#include "iterator.hpp"
+#include "utility.hpp"
+#include "intrusive_hook.hpp"
+
+__STLL_NAMESPACE_START__
+
+/*
+ * Hook of intrusive_slist. A linked hook always has a non null next,
+ * the last hook of a list points back to the head of the list.
+ * An object deriving from several slist_base_hook must give each of them
+ * a different Tag.
+ */
+template <typename Tag=default_hook_tag>
+struct slist_base_hook {
+    typedef slist_base_hook<Tag>    hook_type;
+
+    hook_type*  next;
+
+    slist_base_hook()
+        :next(nullptr)
+    {}
+
+    // Copying an object does not copy its links.
+    slist_base_hook(const hook_type&)
+        :next(nullptr)
+    {}
+
+    hook_type& operator=(const hook_type&) {
+        return *this;
+    }
+
+    bool is_linked() const {
+        return next != nullptr;
+    }
+};
+
+struct slist_member_hook_tag {};
+typedef slist_base_hook<slist_member_hook_tag>  slist_member_hook;
+
+
+template <typename Value, typename ValueTraits, typename Ref, typename Ptr>
+struct intrusive_slist_iterator {
+    typedef forward_iterator_tag    iterator_category;
+    typedef Value                   value_type;
+    typedef Ref                     reference;
+    typedef Ptr                     pointer;
+    typedef ptrdiff_t               difference_type;
+    typedef size_t                  size_type;
+
+    typedef typename ValueTraits::hook_type     node_type;
+
+    typedef intrusive_slist_iterator<Value, ValueTraits, Ref, Ptr>   self;
+    typedef intrusive_slist_iterator<Value, ValueTraits, Value&, Value*>
+            iterator;
+    typedef intrusive_slist_iterator<Value, ValueTraits,
+                                     const Value&, const Value*>
+            const_iterator;
+
+    node_type* node;
+
+    intrusive_slist_iterator(node_type* node=nullptr)
+        :node(node)
+    {}
+
+    intrusive_slist_iterator(const iterator& iter)
+        :node(iter.node)
+    {}
+
+    self& operator++() {
+        node = node->next;
+        return *this;
+    }
+
+    self operator++(int) {
+        self tmp = *this;
+        node = node->next;
+        return tmp;
+    }
+
+    reference operator*() const {
+        return *ValueTraits::to_value(node);
+    }
+
+    pointer operator->() const {
+        return &(operator*());
+    }
+
+    bool operator==(const self& other) const {
+        return node == other.node;
+    }
+
+    bool operator!=(const self& other) const {
+        return node != other.node;
+    }
+};
+
+
+/*
+ * intrusive_slist: a singly linked list of objects which embed their own
+ * slist hook. It never allocates, the size is cached and the last node is
+ * remembered, so push_back and splicing a whole list are O(1).
+ * The list does not own the elements: destroying the list only unlinks them.
+ */
+template <typename Value,
+          typename ValueTraits=base_hook<Value, slist_base_hook<>>>
+class intrusive_slist {
+public:
+    typedef Value           value_type;
+    typedef Value&          reference;
+    typedef const Value&    const_reference;
+    typedef Value*          pointer;
+    typedef const Value*    const_pointer;
+    typedef size_t          size_type;
+    typedef ptrdiff_t       difference_type;
+
+    typedef ValueTraits                         value_traits;
+    typedef typename ValueTraits::hook_type     node_type;
+
+    typedef intrusive_slist<Value, ValueTraits>     self;
+
+    typedef intrusive_slist_iterator<Value, ValueTraits, Value&, Value*>
+            iterator;
+    typedef intrusive_slist_iterator<Value, ValueTraits,
+                                     const Value&, const Value*>
+            const_iterator;
+
+protected:
+    node_type       head;
+    node_type*      tail;
+    size_type       length;
+
+public:
+    intrusive_slist() {
+        init();
+    }
+
+    intrusive_slist(const self&) = delete;
+
+    intrusive_slist(self&& other) {
+        init();
+        splice_after(before_begin(), other);
+    }
+
+    ~intrusive_slist() {
+        clear();
+    }
+
+    self& operator=(const self&) = delete;
+
+    self& operator=(self&& other) {
+        clear();
+        splice_after(before_begin(), other);
+        return *this;
+    }
+
+    iterator before_begin() {
+        return iterator(&head);
+    }
+
+    iterator begin() {
+        return iterator(head.next);
+    }
+
+    iterator end() {
+        return iterator(&head);
+    }
+
+    const_iterator begin() const {
+        return const_iterator(head.next);
+    }
+
+    const_iterator end() const {
+        return const_iterator(const_cast<node_type*>(&head));
+    }
+
+    // Iterator to the last element, or before_begin() if empty.
+    iterator last() {
+        return iterator(tail);
+    }
+
+    size_type size() const {
+        return length;
+    }
+
+    bool empty() const {
+        return length == 0;
+    }
+
+    reference front() {
+        return *value_traits::to_value(head.next);
+    }
+
+    const_reference front() const {
+        return *value_traits::to_value(head.next);
+    }
+
+    reference back() {
+        return *value_traits::to_value(tail);
+    }
+
+    const_reference back() const {
+        return *value_traits::to_value(tail);
+    }
+
+    void push_front(reference value) {
+        link_after(&head, value_traits::to_hook(&value));
+    }
+
+    void push_back(reference value) {
+        link_after(tail, value_traits::to_hook(&value));
+    }
+
+    void pop_front() {
+        unlink_after(&head);
+    }
+
+    // Link value after pos and return an iterator to it.
+    iterator insert_after(iterator pos, reference value) {
+        node_type* node = value_traits::to_hook(&value);
+        link_after(pos.node, node);
+        return iterator(node);
+    }
+
+    // Unlink the element after pos and return an iterator to the next one.
+    iterator erase_after(iterator pos) {
+        unlink_after(pos.node);
+        return iterator(pos.node->next);
+    }
+
+    // Move all the elements of other after pos in O(1).
+    void splice_after(iterator pos, self& other) {
+        if (other.empty() or &other == this)
+            return;
+        node_type* first = other.head.next;
+        node_type* last = other.tail;
+        node_type* next = pos.node->next;
+
+        last->next = next;
+        pos.node->next = first;
+        if (pos.node == tail)
+            tail = last;
+        length += other.length;
+        other.init();
+    }
+
+    // Move the element after before of other after pos.
+    void splice_after(iterator pos, self& other, iterator before) {
+        node_type* node = before.node->next;
+        if (node == pos.node or pos.node == before.node)
+            return;
+        other.unlink_after(before.node);
+        link_after(pos.node, node);
+    }
+
+    // The iterator pointing to value, which must be linked in this list.
+    iterator iterator_to(reference value) {
+        return iterator(value_traits::to_hook(&value));
+    }
+
+    void swap(self& other) {
+        self tmp;
+        tmp.splice_after(tmp.before_begin(), other);
+        other.splice_after(other.before_begin(), *this);
+        splice_after(before_begin(), tmp);
+    }
+
+    // Unlink every element.
+    void clear() {
+        clear_and_dispose(null_disposer());
+    }
+
+    // Unlink every element and call disposer(pointer) on it, for example
+    // to give the objects back to their pool.
+    template <typename Disposer>
+    void clear_and_dispose(Disposer disposer) {
+        node_type* node = head.next;
+        while (node != &head) {
+            node_type* next = node->next;
+            node->next = nullptr;
+            disposer(value_traits::to_value(node));
+            node = next;
+        }
+        init();
+    }
+
+    template <typename Pred>
+    size_type remove_if(Pred pred) {
+        size_type removed = 0;
+        node_type* prev = &head;
+        while (prev->next != &head) {
+            if (pred(*value_traits::to_value(prev->next))) {
+                unlink_after(prev);
+                ++removed;
+            } else {
+                prev = prev->next;
+            }
+        }
+        return removed;
+    }
+
+protected:
+    struct null_disposer {
+        void operator()(pointer) const {}
+    };
+
+    void init() {
+        head.next = &head;
+        tail = &head;
+        length = 0;
+    }
+
+    void link_after(node_type* prev, node_type* node) {
+        node->next = prev->next;
+        prev->next = node;
+        if (prev == tail)
+            tail = node;
+        ++length;
+    }
+
+    void unlink_after(node_type* prev) {
+        node_type* node = prev->next;
+        prev->next = node->next;
+        if (node == tail)
+            tail = prev;
+        node->next = nullptr;
+        --length;
+    }
+};
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // INTRUSIVE_SLIST_HPP
@@ -3,6 +3,7 @@
 
 #include "pair.hpp"
 #include "type_traits.hpp"
+#include "move.hpp"
 
 
 __STLL_NAMESPACE_START__
@@ -67,6 +68,24 @@ struct iterator_traits<const Tp*> {
 };
 
 
+/*
+ * Segmented iterator traits.
+ * A segmented iterator walks a sequence stored as a list of contiguous
+ * segments (e.g. the buffers of a deque). Algorithms use these traits to
+ * process the range segment by segment with plain pointer loops, instead of
+ * checking the segment boundary on every increment.
+ *
+ * A segmented iterator specializes this template with:
+ *   is_segmented_iterator:  true_type
+ *   segment_iterator:       iterates over the segments
+ *   local_iterator:         iterates inside one segment
+ *   segment(iter), local(iter), begin(seg), end(seg), compose(seg, local)
+ */
+template <typename Iterator>
+struct segmented_iterator_traits {
+    typedef false_type      is_segmented_iterator;
+};
+
 template <typename Iterator>
 inline typename iterator_traits<Iterator>::iterator_category
 iterator_category(const Iterator&) {
@@ -89,9 +108,9 @@ distance_type(const Iterator&) {
 template <typename Iterator1, typename Iterator2>
 void iter_swap(Iterator1 iter1, Iterator2 iter2) {
     typedef typename iterator_traits<Iterator1>::value_type Tp;
-    Tp tmp = *iter1;
-    *iter1 = *iter2;
-    *iter2 = tmp;
+    Tp tmp = STLL_NAMESPACE::move(*iter1);
+    *iter1 = STLL_NAMESPACE::move(*iter2);
+    *iter2 = STLL_NAMESPACE::move(tmp);
 }
 
 namespace
@@ -112,8 +131,10 @@ inline typename iterator_traits<InputIterator>::difference_type __distance(
            input_iterator_tag) {
     typename iterator_traits<InputIterator>::difference_type distance_value = 0;
 
-    while (first != last)
+    while (first != last) {
         ++first;
+        ++distance_value;
+    }
 
     return distance_value;
 }
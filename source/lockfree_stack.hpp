@@ -0,0 +1,409 @@
+#ifndef LOCKFREE_STACK_HPP
+#define LOCKFREE_STACK_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "allocator.hpp"
+#include "construct.hpp"
+#include "slist.hpp"
+
+__STLL_NAMESPACE_START__
+
+namespace
+{
+
+/*
+ * Tagged pointer: a node pointer and a version tag packed in one word, so
+ * it can be swapped with a single word compare and exchange.
+ * On 64 bits platforms user space addresses fit in the low 48 bits, the
+ * high 16 bits hold the tag. The tag is bumped on every successful CAS,
+ * which defeats the ABA problem of the Treiber stack.
+ */
+struct tagged_pointer {
+    typedef uint64_t    word_type;
+
+    enum {POINTER_BITS = (sizeof(void*) == 8 ? 48 : 32)};
+
+    static word_type pack(const void* ptr, word_type tag) {
+        return (word_type(uintptr_t(ptr)) & pointer_mask())
+               | (tag << POINTER_BITS);
+    }
+
+    template <typename Tp>
+    static Tp* pointer(word_type word) {
+        return reinterpret_cast<Tp*>(uintptr_t(word & pointer_mask()));
+    }
+
+    static word_type tag(word_type word) {
+        return word >> POINTER_BITS;
+    }
+
+    static word_type pointer_mask() {
+        return (word_type(1) << POINTER_BITS) - 1;
+    }
+};
+
+inline void lockfree_cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// The next field of a node may be read by a popper while the node is being
+// recycled by another thread, so it is always accessed atomically.
+template <typename Tp>
+inline slist_node<Tp>* lockfree_load_next(slist_node<Tp>* node) {
+    return __atomic_load_n(&node->next, __ATOMIC_RELAXED);
+}
+
+template <typename Tp>
+inline void lockfree_store_next(slist_node<Tp>* node, slist_node<Tp>* next) {
+    __atomic_store_n(&node->next, next, __ATOMIC_RELAXED);
+}
+
+/*
+ * Treiber stack of raw nodes, the building block of lockfree_stack.
+ * It never frees a node, so reading top->next of a node which was popped
+ * concurrently is always a valid memory access, and the tag of top
+ * detects that it changed meanwhile.
+ */
+template <typename Tp>
+class lockfree_node_stack {
+public:
+    typedef slist_node<Tp>                  node_type;
+    typedef tagged_pointer::word_type       word_type;
+
+protected:
+    std::atomic<word_type>  top;
+
+public:
+    lockfree_node_stack()
+        :top(0)
+    {}
+
+    bool empty() const {
+        return tagged_pointer::pointer<node_type>(
+                    top.load(std::memory_order_acquire)) == nullptr;
+    }
+
+    // Push the chain [first, ..., last], last->next is overwritten.
+    void push_chain(node_type* first, node_type* last) {
+        word_type old_top = top.load(std::memory_order_relaxed);
+        for (;;) {
+            lockfree_store_next(last,
+                                tagged_pointer::pointer<node_type>(old_top));
+            word_type new_top = tagged_pointer::pack(
+                        first, tagged_pointer::tag(old_top) + 1);
+            if (top.compare_exchange_weak(old_top, new_top,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed))
+                return;
+        }
+    }
+
+    void push(node_type* node) {
+        push_chain(node, node);
+    }
+
+    // A single attempt, used by the elimination backoff.
+    bool try_push(node_type* node) {
+        word_type old_top = top.load(std::memory_order_relaxed);
+        lockfree_store_next(node, tagged_pointer::pointer<node_type>(old_top));
+        word_type new_top = tagged_pointer::pack(
+                    node, tagged_pointer::tag(old_top) + 1);
+        return top.compare_exchange_strong(old_top, new_top,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed);
+    }
+
+    node_type* pop() {
+        word_type old_top = top.load(std::memory_order_acquire);
+        for (;;) {
+            node_type* node = tagged_pointer::pointer<node_type>(old_top);
+            if (node == nullptr)
+                return nullptr;
+            word_type new_top = tagged_pointer::pack(
+                        lockfree_load_next(node),
+                        tagged_pointer::tag(old_top) + 1);
+            if (top.compare_exchange_weak(old_top, new_top,
+                                          std::memory_order_acquire,
+                                          std::memory_order_acquire))
+                return node;
+        }
+    }
+
+    // A single attempt, used by the elimination backoff.
+    // Return false if the CAS failed, node is nullptr if the stack is empty.
+    bool try_pop(node_type*& node) {
+        word_type old_top = top.load(std::memory_order_acquire);
+        node = tagged_pointer::pointer<node_type>(old_top);
+        if (node == nullptr)
+            return true;
+        word_type new_top = tagged_pointer::pack(
+                    lockfree_load_next(node), tagged_pointer::tag(old_top) + 1);
+        return top.compare_exchange_strong(old_top, new_top,
+                                           std::memory_order_acquire,
+                                           std::memory_order_relaxed);
+    }
+
+    // Detach the whole chain at once, the result is terminated by nullptr.
+    node_type* pop_all() {
+        word_type old_top = top.load(std::memory_order_relaxed);
+        for (;;) {
+            if (tagged_pointer::pointer<node_type>(old_top) == nullptr)
+                return nullptr;
+            word_type new_top = tagged_pointer::pack(
+                        nullptr, tagged_pointer::tag(old_top) + 1);
+            if (top.compare_exchange_weak(old_top, new_top,
+                                          std::memory_order_acquire,
+                                          std::memory_order_relaxed))
+                return tagged_pointer::pointer<node_type>(old_top);
+        }
+    }
+};
+
+/*
+ * Elimination array: a push and a pop which collide on the stack top can
+ * meet in a random slot and cancel each other out without touching the
+ * top at all, which spreads the contention over several cache lines.
+ *
+ * A slot is EMPTY, holds the node of a waiting pusher, or is TAKEN after a
+ * popper grabbed that node. Only the pusher moves it from TAKEN back to
+ * EMPTY, so a node can never be handed out twice.
+ */
+template <typename Tp>
+class lockfree_elimination_array {
+public:
+    typedef slist_node<Tp>      node_type;
+
+protected:
+    enum {SLOT_NUMBER = 8};
+    enum {SPIN_COUNT = 128};
+
+    struct alignas(CACHE_LINE_SIZE) slot_type {
+        std::atomic<uintptr_t> value;
+    };
+
+    static uintptr_t empty_slot() { return 0; }
+    static uintptr_t taken_slot() { return 1; }
+
+    slot_type slots[SLOT_NUMBER];
+
+public:
+    lockfree_elimination_array() {
+        for (size_t i = 0; i < SLOT_NUMBER; ++i)
+            slots[i].value.store(empty_slot(), std::memory_order_relaxed);
+    }
+
+    // Offer node to a popper, return true if one took it.
+    bool exchange_push(node_type* node) {
+        slot_type& slot = slots[random_index()];
+        uintptr_t expected = empty_slot();
+        if (!slot.value.compare_exchange_strong(expected, uintptr_t(node),
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed))
+            return false;
+
+        for (size_t i = 0; i < SPIN_COUNT; ++i) {
+            if (slot.value.load(std::memory_order_acquire) == taken_slot())
+                break;
+            lockfree_cpu_relax();
+        }
+
+        expected = uintptr_t(node);
+        if (slot.value.compare_exchange_strong(expected, empty_slot(),
+                                               std::memory_order_relaxed))
+            return false;
+        // A popper took the node.
+        slot.value.store(empty_slot(), std::memory_order_release);
+        return true;
+    }
+
+    // Take the node of a waiting pusher, or return nullptr.
+    node_type* exchange_pop() {
+        slot_type& slot = slots[random_index()];
+        uintptr_t value = slot.value.load(std::memory_order_acquire);
+        if (value == empty_slot() or value == taken_slot())
+            return nullptr;
+        if (slot.value.compare_exchange_strong(value, taken_slot(),
+                                               std::memory_order_acquire,
+                                               std::memory_order_relaxed))
+            return reinterpret_cast<node_type*>(value);
+        return nullptr;
+    }
+
+protected:
+    static size_t random_index() {
+        // xorshift, one state per thread.
+        static thread_local uint32_t state =
+                uint32_t(uintptr_t(&state) >> 4) | 1;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state % SLOT_NUMBER;
+    }
+};
+
+}
+
+
+/*
+ * lockfree_stack: a Treiber stack of slist_node<Tp>.
+ * ABA is prevented with a tag packed next to the top pointer, and nodes are
+ * never returned to Alloc while the stack lives: popped nodes are recycled
+ * through a second, node only, lock free stack.
+ *
+ * pop_all() drains the whole stack with one CAS.
+ * With EliminationBackoff, a push and a pop which fail their CAS try to
+ * meet in an elimination array before retrying on the top.
+ */
+template <typename Tp, bool EliminationBackoff=false,
+          typename Alloc=allocator<slist_node<Tp>>>
+class lockfree_stack {
+public:
+    typedef Tp           value_type;
+    typedef Tp&          reference;
+    typedef const Tp&    const_reference;
+    typedef size_t       size_type;
+
+    typedef slist_node<Tp>                      node_type;
+    typedef Alloc                               node_alloc;
+    typedef lockfree_stack<Tp, EliminationBackoff, Alloc>  self;
+
+protected:
+    lockfree_node_stack<Tp>         nodes;
+    lockfree_node_stack<Tp>         free_nodes;
+    lockfree_elimination_array<Tp>  elimination;
+
+public:
+    lockfree_stack() = default;
+
+    lockfree_stack(const self&) = delete;
+
+    self& operator=(const self&) = delete;
+
+    ~lockfree_stack() {
+        release_chain(nodes.pop_all(), true);
+        release_chain(free_nodes.pop_all(), false);
+    }
+
+    // It is only a snapshot when other threads use the stack.
+    bool empty() const {
+        return nodes.empty();
+    }
+
+    void push(const value_type& value) {
+        node_type* node = get_node();
+        construct(&node->data, value);
+        push_node(node);
+    }
+
+    void push(value_type&& value) {
+        node_type* node = get_node();
+        construct(&node->data, STLL_NAMESPACE::move(value));
+        push_node(node);
+    }
+
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        node_type* node = get_node();
+        construct(&node->data, STLL_NAMESPACE::forward<Args>(args)...);
+        push_node(node);
+    }
+
+    // Push [first, last) with a single CAS on the top,
+    // the last element ends up on the top.
+    template <typename InputIterator>
+    void push_range(InputIterator first, InputIterator last) {
+        if (first == last)
+            return;
+        node_type* top = nullptr;
+        node_type* bottom = nullptr;
+        for (; first != last; ++first) {
+            node_type* node = get_node();
+            construct(&node->data, *first);
+            lockfree_store_next(node, top);
+            top = node;
+            if (bottom == nullptr)
+                bottom = node;
+        }
+        nodes.push_chain(top, bottom);
+    }
+
+    // Pop the top into value, return false if the stack was empty.
+    bool pop(value_type& value) {
+        node_type* node = pop_node();
+        if (node == nullptr)
+            return false;
+        value = STLL_NAMESPACE::move(node->data);
+        destroy(&node->data);
+        free_nodes.push(node);
+        return true;
+    }
+
+    // Drain the whole stack with one CAS, write the values to out from the
+    // top to the bottom and return the end of out.
+    template <typename OutputIterator>
+    OutputIterator pop_all(OutputIterator out) {
+        node_type* first = nodes.pop_all();
+        if (first == nullptr)
+            return out;
+        node_type* last = first;
+        for (node_type* node = first; node; node = node->next) {
+            *out = STLL_NAMESPACE::move(node->data);
+            ++out;
+            destroy(&node->data);
+            last = node;
+        }
+        free_nodes.push_chain(first, last);
+        return out;
+    }
+
+protected:
+    void push_node(node_type* node) {
+        if (!EliminationBackoff) {
+            nodes.push(node);
+            return;
+        }
+        while (!nodes.try_push(node)) {
+            if (elimination.exchange_push(node))
+                return;
+        }
+    }
+
+    node_type* pop_node() {
+        if (!EliminationBackoff)
+            return nodes.pop();
+        node_type* node = nullptr;
+        while (!nodes.try_pop(node)) {
+            if ((node = elimination.exchange_pop()) != nullptr)
+                return node;
+        }
+        return node;
+    }
+
+    node_type* get_node() {
+        node_type* node = free_nodes.pop();
+        if (node == nullptr)
+            node = node_alloc::allocate(1);
+        return node;
+    }
+
+    static void release_chain(node_type* node, bool constructed) {
+        while (node) {
+            node_type* next = node->next;
+            if (constructed)
+                destroy(&node->data);
+            node_alloc::deallocate(node, 1);
+            node = next;
+        }
+    }
+};
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // LOCKFREE_STACK_HPP
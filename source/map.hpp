@@ -51,8 +51,8 @@ public:
         :tree(value_compare(key_compare()))
     {}
 
-    map(const Compare& comp)
-        :tree(value_comppare(comp))
+    map(const Compare& comp, const Alloc& allocator=Alloc())
+        :tree(value_compare(comp), allocator)
     {}
 
     map(const self&) = default;
@@ -62,6 +62,218 @@ inline ForwardIterator __uninitialized_fill_n_aux(ForwardIterator first,
 
 }
 
+namespace
+{
+
+/* copy of plain ranges */
+template <typename InputIterator, typename OutputIterator>
+inline OutputIterator __copy(InputIterator first, InputIterator last,
+                             OutputIterator result) {
+    while (first != last) {
+        *result = *first;
+        ++first;
+        ++result;
+    }
+    return result;
+}
+
+template <typename Tp>
+inline Tp* __copy_trivial(const Tp* first, const Tp* last, Tp* result,
+                          true_type) {
+    if (first != last)
+        std::memmove(result, first, sizeof(Tp) * size_t(last - first));
+    return result + (last - first);
+}
+
+template <typename Tp>
+inline Tp* __copy_trivial(const Tp* first, const Tp* last, Tp* result,
+                          false_type) {
+    for (; first != last; ++first, ++result)
+        *result = *first;
+    return result;
+}
+
+template <typename Tp>
+inline Tp* __copy(const Tp* first, const Tp* last, Tp* result) {
+    typedef typename type_traits<Tp>::has_trivial_assignment_operator trivial;
+    return __copy_trivial(first, last, result, trivial());
+}
+
+template <typename Tp>
+inline Tp* __copy(Tp* first, Tp* last, Tp* result) {
+    return __copy(static_cast<const Tp*>(first), static_cast<const Tp*>(last),
+                  result);
+}
+
+/* fill of plain ranges */
+template <typename ForwardIterator, typename Tp>
+inline void __fill(ForwardIterator first, ForwardIterator last,
+                   const Tp& value) {
+    for (; first != last; ++first)
+        *first = value;
+}
+
+inline void __fill(char* first, char* last, const char& value) {
+    std::memset(first, static_cast<unsigned char>(value), last - first);
+}
+
+inline void __fill(signed char* first, signed char* last,
+                   const signed char& value) {
+    std::memset(first, static_cast<unsigned char>(value), last - first);
+}
+
+inline void __fill(unsigned char* first, unsigned char* last,
+                   const unsigned char& value) {
+    std::memset(first, value, last - first);
+}
+
+/*
+ * Segmented copy.
+ * op(first, last, result) copies a range whose input is not segmented and
+ * returns the end of the output. __segmented_copy splits [first, last) and
+ * the output range into their segments so that op mostly sees pointers.
+ */
+template <typename InputIterator, typename OutputIterator, typename Op>
+inline OutputIterator __segmented_copy_out(InputIterator first,
+                                           InputIterator last,
+                                           OutputIterator result,
+                                           Op op, input_iterator_tag) {
+    return op(first, last, result);
+}
+
+template <typename RandomAcessIterator, typename OutputIterator, typename Op>
+OutputIterator __segmented_copy_out(RandomAcessIterator first,
+                                    RandomAcessIterator last,
+                                    OutputIterator result,
+                                    Op op, random_access_iterator_tag) {
+    typedef segmented_iterator_traits<OutputIterator> traits;
+    typedef typename iterator_traits<RandomAcessIterator>::difference_type
+            Distance;
+
+    typename traits::segment_iterator seg = traits::segment(result);
+    typename traits::local_iterator local = traits::local(result);
+    while (first != last) {
+        Distance room = Distance(traits::end(seg) - local);
+        Distance left = last - first;
+        Distance n = left < room ? left : room;
+        local = op(first, first + n, local);
+        first += n;
+        if (first != last) {
+            ++seg;
+            local = traits::begin(seg);
+        }
+    }
+    return traits::compose(seg, local);
+}
+
+template <typename InputIterator, typename OutputIterator, typename Op>
+inline OutputIterator __segmented_copy_out(InputIterator first,
+                                           InputIterator last,
+                                           OutputIterator result,
+                                           Op op, false_type) {
+    return op(first, last, result);
+}
+
+template <typename InputIterator, typename OutputIterator, typename Op>
+inline OutputIterator __segmented_copy_out(InputIterator first,
+                                           InputIterator last,
+                                           OutputIterator result,
+                                           Op op, true_type) {
+    return __segmented_copy_out(first, last, result, op,
+                                iterator_category(first));
+}
+
+template <typename InputIterator, typename OutputIterator, typename Op>
+inline OutputIterator __segmented_copy_in(InputIterator first,
+                                          InputIterator last,
+                                          OutputIterator result,
+                                          Op op, false_type) {
+    typedef typename segmented_iterator_traits<OutputIterator>
+            ::is_segmented_iterator segmented;
+    return __segmented_copy_out(first, last, result, op, segmented());
+}
+
+template <typename InputIterator, typename OutputIterator, typename Op>
+OutputIterator __segmented_copy_in(InputIterator first,
+                                   InputIterator last,
+                                   OutputIterator result,
+                                   Op op, true_type) {
+    typedef segmented_iterator_traits<InputIterator> traits;
+    typedef typename segmented_iterator_traits<OutputIterator>
+            ::is_segmented_iterator segmented;
+
+    typename traits::segment_iterator seg_first = traits::segment(first);
+    typename traits::segment_iterator seg_last = traits::segment(last);
+    if (seg_first == seg_last) {
+        return __segmented_copy_out(traits::local(first), traits::local(last),
+                                    result, op, segmented());
+    }
+
+    result = __segmented_copy_out(traits::local(first), traits::end(seg_first),
+                                  result, op, segmented());
+    for (++seg_first; seg_first != seg_last; ++seg_first) {
+        result = __segmented_copy_out(traits::begin(seg_first),
+                                      traits::end(seg_first),
+                                      result, op, segmented());
+    }
+    return __segmented_copy_out(traits::begin(seg_last), traits::local(last),
+                                result, op, segmented());
+}
+
+template <typename InputIterator, typename OutputIterator, typename Op>
+inline OutputIterator __segmented_copy(InputIterator first,
+                                       InputIterator last,
+                                       OutputIterator result, Op op) {
+    typedef typename segmented_iterator_traits<InputIterator>
+            ::is_segmented_iterator segmented;
+    return __segmented_copy_in(first, last, result, op, segmented());
+}
+
+struct __copy_op {
+    template <typename InputIterator, typename OutputIterator>
+    OutputIterator operator()(InputIterator first, InputIterator last,
+                              OutputIterator result) const {
+        return __copy(first, last, result);
+    }
+};
+
+struct __uninitialized_copy_op {
+    template <typename InputIterator, typename ForwardIterator>
+    ForwardIterator operator()(InputIterator first, InputIterator last,
+                               ForwardIterator result) const {
+        for (; first != last; ++first, ++result)
+            construct(&*result, *first);
+        return result;
+    }
+};
+
+/* Segmented fill */
+template <typename ForwardIterator, typename Tp>
+inline void __segmented_fill(ForwardIterator first, ForwardIterator last,
+                             const Tp& value, false_type) {
+    __fill(first, last, value);
+}
+
+template <typename ForwardIterator, typename Tp>
+void __segmented_fill(ForwardIterator first, ForwardIterator last,
+                      const Tp& value, true_type) {
+    typedef segmented_iterator_traits<ForwardIterator> traits;
+
+    typename traits::segment_iterator seg_first = traits::segment(first);
+    typename traits::segment_iterator seg_last = traits::segment(last);
+    if (seg_first == seg_last) {
+        __fill(traits::local(first), traits::local(last), value);
+        return;
+    }
+
+    __fill(traits::local(first), traits::end(seg_first), value);
+    for (++seg_first; seg_first != seg_last; ++seg_first)
+        __fill(traits::begin(seg_first), traits::end(seg_first), value);
+    __fill(traits::begin(seg_last), traits::local(last), value);
+}
+
+}
+
 /*
  Copy the range [first, last) into [result, result + (last-first)).
 */
@@ -72,20 +284,6 @@ ForwardIterator uninitialized_copy(InputIterator first,
     return __uninitialized_copy(first, last, result, value_type(result));
 }
 
-template <char*, char*>
-char* uninitialized_copy(const char* first, const char* last, char* result) {
-    std::memmove(result, first, size_t(last - first));
-    return result + (last - first);
-}
-
-template <wchar_t*, wchar_t*>
-wchar_t* uninitialized_copy(const wchar_t* first, const wchar_t* last,
-                            wchar_t* result) {
-    std::memmove(result, first, size_t(last - first));
-    return result + (last - first);
-}
-
-
 template <typename InputIterator, typename Tp>
 InputIterator uninitialized_fill(InputIterator first, InputIterator last,
                                  const Tp& value) {
@@ -99,15 +297,19 @@ ForwardIterator uninitialized_fill_n(ForwardIterator first, Distance n,
 }
 
 
+// Trivially assignable pointer ranges are copied with memmove, segmented
+// ranges (deque) are copied segment by segment.
 template <typename InputIterator, typename ForwardIterator>
 ForwardIterator copy(InputIterator first, InputIterator last,
                      ForwardIterator result) {
-    while (first != last) {
-        *result = *first;
-        ++first;
-        ++result;
-    }
-    return result;
+    return __segmented_copy(first, last, result, __copy_op());
+}
+
+template <typename ForwardIterator, typename Tp>
+void fill(ForwardIterator first, ForwardIterator last, const Tp& value) {
+    typedef typename segmented_iterator_traits<ForwardIterator>
+            ::is_segmented_iterator segmented;
+    __segmented_fill(first, last, value, segmented());
 }
 
 template <typename InputIterator, typename ForwardIterator>
@@ -160,12 +362,7 @@ inline ForwardIterator __uninitialized_copy_aux(InputIterator first,
                                                InputIterator last,
                                                ForwardIterator result,
                                                false_type) {
-    while (first != last) {
-        construct(&*result, *first);
-        ++first;
-        ++result;
-    }
-    return result;
+    return __segmented_copy(first, last, result, __uninitialized_copy_op());
 }
 
 
@@ -190,10 +387,8 @@ template <typename InputIterator, typename Tp>
 inline InputIterator __uninitialized_fill_aux(InputIterator first,
                                               InputIterator last,
                                               const Tp& value, true_type) {
-    while (first != last) {
-        *first = value;
-        ++first;
-    }
+    fill(first, last, value);
+    return last;
 }
 
 template <typename InputIterator, typename Tp>
@@ -204,6 +399,7 @@ inline InputIterator __uninitialized_fill_aux(InputIterator first,
         construct(&*first, value);
         ++first;
     }
+    return last;
 }
 
 /* uninitialized_fill_n */
@@ -4,39 +4,124 @@
 #include "type_traits.hpp"
 #include "iterator.hpp"
 #include "functor.hpp"
+#include "move.hpp"
+#include "simd.hpp"
 
 __STLL_NAMESPACE_START__
 
-template <typename InputIterator, typename Tp>
-Tp accumulate(InputIterator first, InputIterator last, Tp init) {
-    while (first != last) {
-        init = (init + *(first));
+namespace
+{
+
+// The operation of accumulate without one, init + *first: unlike
+// plus<Tp>, the element is not converted to a Tp before the addition.
+struct __accumulate_plus {
+    template <typename Tp, typename Value>
+    Tp operator()(const Tp& init, const Value& value) const {
+        return init + value;
     }
+};
+
+template <typename InputIterator, typename Tp, typename BinaryOperation>
+inline Tp __accumulate(InputIterator first, InputIterator last, Tp init,
+                       BinaryOperation binary_operation, false_type) {
+    for (; first != last; ++first)
+        init = binary_operation(init, *first);
     return init;
 }
 
+template <typename Value, typename Tp, typename BinaryOperation>
+inline Tp __accumulate_contiguous(Value* first, Value* last, Tp init,
+                                  BinaryOperation binary_operation,
+                                  false_type) {
+    for (; first != last; ++first)
+        init = binary_operation(init, *first);
+    return init;
+}
+
+#ifdef __STLL_SIMD__
+template <typename Value, typename Tp, typename BinaryOperation>
+inline Tp __accumulate_contiguous(Value* first, Value* last, Tp init,
+                                  BinaryOperation, true_type) {
+    return __simd_sum<Tp>(first, last, init);
+}
+#endif
+
+// A contiguous sum of integers is done with SIMD and several accumulators,
+// which only changes the order of the additions. Only ranges of Tp itself
+// are vectorized, where both additions give the same.
+template <typename Value, typename Tp>
+inline Tp __accumulate(Value* first, Value* last, Tp init,
+                       __accumulate_plus binary_operation, false_type) {
+    typedef typename simd_reduce_traits<Value, Tp>::associative associative;
+    return __accumulate_contiguous(first, last, init, binary_operation,
+                                   associative());
+}
+
+template <typename Value, typename Tp>
+inline Tp __accumulate(Value* first, Value* last, Tp init,
+                       plus<Tp> binary_operation, false_type) {
+    typedef typename simd_reduce_traits<Value, Tp>::associative associative;
+    return __accumulate_contiguous(first, last, init, binary_operation,
+                                   associative());
+}
+
+// Segmented ranges (deque) are accumulated one segment at a time,
+// so the inner loop runs over plain pointers.
+template <typename InputIterator, typename Tp, typename BinaryOperation>
+Tp __accumulate(InputIterator first, InputIterator last, Tp init,
+                BinaryOperation binary_operation, true_type) {
+    typedef segmented_iterator_traits<InputIterator> traits;
+
+    typename traits::segment_iterator seg_first = traits::segment(first);
+    typename traits::segment_iterator seg_last = traits::segment(last);
+    if (seg_first == seg_last) {
+        return __accumulate(traits::local(first), traits::local(last), init,
+                            binary_operation, false_type());
+    }
+
+    init = __accumulate(traits::local(first), traits::end(seg_first), init,
+                        binary_operation, false_type());
+    for (++seg_first; seg_first != seg_last; ++seg_first) {
+        init = __accumulate(traits::begin(seg_first), traits::end(seg_first),
+                            init, binary_operation, false_type());
+    }
+    return __accumulate(traits::begin(seg_last), traits::local(last), init,
+                        binary_operation, false_type());
+}
+
+}
+
+template <typename InputIterator, typename Tp>
+Tp accumulate(InputIterator first, InputIterator last, Tp init) {
+    typedef typename segmented_iterator_traits<InputIterator>
+            ::is_segmented_iterator segmented;
+    return __accumulate(first, last, init, __accumulate_plus(),
+                        segmented());
+}
+
 template <typename InputIterator, typename Tp, typename BinaryOperation>
 Tp accumulate(InputIterator first, InputIterator last, Tp init,
               BinaryOperation binary_operation) {
-    while (first != last) {
-        init = binary_operation(init, *(first));
-    }
-    return init;
+    typedef typename segmented_iterator_traits<InputIterator>
+            ::is_segmented_iterator segmented;
+    return __accumulate(first, last, init, binary_operation, segmented());
 }
 
+// The value is read before the result is written, so result may be first.
 template <typename InputIterator, typename OutputIterator>
 OutputIterator adjacent_difference(InputIterator first, InputIterator last,
                                    OutputIterator result) {
     typedef typename iterator_traits<InputIterator>::value_type Tp;
     if (first == last)
-        return;
-    *result = *first;
+        return result;
     Tp prev_value = *first;
+    *result = prev_value;
     while (++first != last) {
-        *(++result) = *(first) - prev_value;
-        prev_value = *first;
+        Tp value = *first;
+        *(++result) = value - prev_value;
+        prev_value = STLL_NAMESPACE::move(value);
     }
-    return result;
+    return ++result;
 }
 
 template <typename InputIterator, typename OutputIterator,
@@ -44,20 +129,25 @@ template <typename InputIterator, typename OutputIterator,
 OutputIterator adjacent_difference(InputIterator first, InputIterator last,
                                    OutputIterator result, 
                                    BinaryOperation binary_operation) {
-    if (first == last) return;
-    *result = *first;
     typedef typename iterator_traits<InputIterator>::value_type Tp; 
+    if (first == last)
+        return result;
     Tp prev_value = *first;
+    *result = prev_value;
     while (++first != last) {
-        *(++result) = binary_operation((first) - prev_value);
-        prev_value = *first;
+        Tp value = *first;
+        *(++result) = binary_operation(value, prev_value);
+        prev_value = STLL_NAMESPACE::move(value);
     }
-    return result;
+    return ++result;
 }
 
+namespace
+{
+
 template <typename InputIterator1, typename InputIterator2, typename Tp>
-Tp inner_product(InputIterator1 first1, InputIterator1 last1,
-                 InputIterator2 first2, Tp init) {
+inline Tp __inner_product(InputIterator1 first1, InputIterator1 last1,
+                          InputIterator2 first2, Tp init, false_type) {
     while (first1 != last1) {
         init = init + (*first1 * *first2);
         ++first1;
@@ -66,6 +156,36 @@ Tp inner_product(InputIterator1 first1, InputIterator1 last1,
     return init;
 }
 
+#ifdef __STLL_SIMD__
+template <typename Value1, typename Value2, typename Tp>
+inline Tp __inner_product(Value1* first1, Value1* last1, Value2* first2,
+                          Tp init, true_type) {
+    return __simd_dot<Tp>(first1, last1, first2, init);
+}
+#endif
+
+template <typename InputIterator1, typename InputIterator2, typename Tp>
+inline Tp __inner_product(InputIterator1 first1, InputIterator1 last1,
+                          InputIterator2 first2, Tp init) {
+    return __inner_product(first1, last1, first2, init, false_type());
+}
+
+template <typename Value1, typename Value2, typename Tp>
+inline Tp __inner_product(Value1* first1, Value1* last1, Value2* first2,
+                          Tp init) {
+    typedef typename simd_reduce_traits<Value1, Tp, Value2>::associative
+            associative;
+    return __inner_product(first1, last1, first2, init, associative());
+}
+
+}
+
+template <typename InputIterator1, typename InputIterator2, typename Tp>
+Tp inner_product(InputIterator1 first1, InputIterator1 last1,
+                 InputIterator2 first2, Tp init) {
+    return __inner_product(first1, last1, first2, init);
+}
+
 template <typename InputIterator1, typename InputIterator2,
           typename Tp, typename BinaryOperation>
 Tp inner_product(InputIterator1 first1, InputIterator1 last1,
@@ -79,19 +199,173 @@ Tp inner_product(InputIterator1 first1, InputIterator1 last1,
     return init;
 }
 
+
+/*
+ * reduce, transform_reduce: accumulate and inner_product, except that the
+ * terms may be added in any order. So the contiguous ranges of float and
+ * double are vectorized too, with results which may differ from those of
+ * accumulate in the last bits.
+ */
+namespace
+{
+
+template <typename InputIterator, typename Tp>
+inline Tp __reduce(InputIterator first, InputIterator last, Tp init) {
+    return STLL_NAMESPACE::accumulate(first, last, init);
+}
+
+template <typename Value, typename Tp>
+inline Tp __reduce(Value* first, Value* last, Tp init) {
+    typedef typename simd_reduce_traits<Value, Tp>::vectorizable
+            vectorizable;
+    return __accumulate_contiguous(first, last, init, vectorizable());
+}
+
+template <typename InputIterator1, typename InputIterator2, typename Tp>
+inline Tp __transform_reduce(InputIterator1 first1, InputIterator1 last1,
+                             InputIterator2 first2, Tp init) {
+    return __inner_product(first1, last1, first2, init);
+}
+
+template <typename Value1, typename Value2, typename Tp>
+inline Tp __transform_reduce(Value1* first1, Value1* last1, Value2* first2,
+                             Tp init) {
+    typedef typename simd_reduce_traits<Value1, Tp, Value2>::vectorizable
+            vectorizable;
+    return __inner_product(first1, last1, first2, init, vectorizable());
+}
+
+}
+
+template <typename InputIterator, typename Tp>
+Tp reduce(InputIterator first, InputIterator last, Tp init) {
+    return __reduce(first, last, init);
+}
+
+template <typename InputIterator, typename Tp, typename BinaryOperation>
+Tp reduce(InputIterator first, InputIterator last, Tp init,
+          BinaryOperation binary_operation) {
+    return STLL_NAMESPACE::accumulate(first, last, init, binary_operation);
+}
+
+template <typename InputIterator1, typename InputIterator2, typename Tp>
+Tp transform_reduce(InputIterator1 first1, InputIterator1 last1,
+                    InputIterator2 first2, Tp init) {
+    return __transform_reduce(first1, last1, first2, init);
+}
+
+namespace
+{
+
+// Scans of [first, last) into result from init, result may be first.
+template <typename InputIterator, typename OutputIterator, typename Tp,
+          typename BinaryOperation>
+OutputIterator __inclusive_scan(InputIterator first, InputIterator last,
+                                OutputIterator result,
+                                BinaryOperation binary_operation, Tp init,
+                                false_type) {
+    for (; first != last; ++first, ++result) {
+        init = binary_operation(init, *first);
+        *result = init;
+    }
+    return result;
+}
+
+template <typename InputIterator, typename OutputIterator, typename Tp,
+          typename BinaryOperation>
+OutputIterator __exclusive_scan(InputIterator first, InputIterator last,
+                                OutputIterator result,
+                                BinaryOperation binary_operation, Tp init,
+                                false_type) {
+    for (; first != last; ++first, ++result) {
+        Tp value = binary_operation(init, *first);
+        *result = init;
+        init = STLL_NAMESPACE::move(value);
+    }
+    return result;
+}
+
+#ifdef __STLL_SIMD__
+template <typename Value, typename Tp>
+inline Tp* __inclusive_scan(Value* first, Value* last, Tp* result,
+                            plus<Tp>, Tp init, true_type) {
+    return __simd_inclusive_scan<Tp>(first, last, result, init);
+}
+
+template <typename Value, typename Tp>
+inline Tp* __exclusive_scan(Value* first, Value* last, Tp* result,
+                            plus<Tp>, Tp init, true_type) {
+    return __simd_exclusive_scan<Tp>(first, last, result, init);
+}
+#endif
+
+template <typename InputIterator, typename OutputIterator, typename Tp,
+          typename BinaryOperation>
+inline OutputIterator __inclusive_scan(InputIterator first,
+                                       InputIterator last,
+                                       OutputIterator result,
+                                       BinaryOperation binary_operation,
+                                       Tp init) {
+    return __inclusive_scan(first, last, result, binary_operation, init,
+                            false_type());
+}
+
+template <typename Value, typename Tp>
+inline Tp* __inclusive_scan(Value* first, Value* last, Tp* result,
+                            plus<Tp> binary_operation, Tp init) {
+    typedef typename simd_reduce_traits<Value, Tp>::vectorizable
+            vectorizable;
+    return __inclusive_scan(first, last, result, binary_operation, init,
+                            vectorizable());
+}
+
+template <typename InputIterator, typename OutputIterator, typename Tp,
+          typename BinaryOperation>
+inline OutputIterator __exclusive_scan(InputIterator first,
+                                       InputIterator last,
+                                       OutputIterator result,
+                                       BinaryOperation binary_operation,
+                                       Tp init) {
+    return __exclusive_scan(first, last, result, binary_operation, init,
+                            false_type());
+}
+
+template <typename Value, typename Tp>
+inline Tp* __exclusive_scan(Value* first, Value* last, Tp* result,
+                            plus<Tp> binary_operation, Tp init) {
+    typedef typename simd_reduce_traits<Value, Tp>::vectorizable
+            vectorizable;
+    return __exclusive_scan(first, last, result, binary_operation, init,
+                            vectorizable());
+}
+
+// partial_sum keeps the order of the additions, so it only takes the SIMD
+// scan for the integers.
+template <typename InputIterator, typename OutputIterator, typename Tp>
+inline OutputIterator __partial_sum(InputIterator first, InputIterator last,
+                                    OutputIterator result, Tp init) {
+    return __inclusive_scan(first, last, result, plus<Tp>(), init,
+                            false_type());
+}
+
+template <typename Value, typename Tp>
+inline Tp* __partial_sum(Value* first, Value* last, Tp* result, Tp init) {
+    typedef typename simd_reduce_traits<Value, Tp>::associative associative;
+    return __inclusive_scan(first, last, result, plus<Tp>(), init,
+                            associative());
+}
+
+}
+
 template <typename InputIterator, typename OutputIterator>
 OutputIterator partial_sum(InputIterator first, InputIterator last,
                            OutputIterator result) {
     typedef typename iterator_traits<InputIterator>::value_type Tp;
-    if (first == last) return;
+    if (first == last) return result;
 
-    Tp value = *first; 
+    Tp value = *first;
     *result = value;
-    while (++first != last) {
-        value = value + *first;
-        *++result = value;
-    }
-    return ++result;
+    return __partial_sum(++first, last, ++result, value);
 }
 
 template <typename InputIterator, typename OutputIterator,
@@ -101,17 +375,116 @@ OutputIterator partial_sum(InputIterator first, InputIterator last,
                            BinaryOperation binary_operation
                            ) {
     typedef typename iterator_traits<InputIterator>::value_type Tp;
-    if (first == last) return;
+    if (first == last) return result;
 
     Tp value = *first; 
     *result = value;
     while (++first != last) {
-        value = binary_opeartion(value + *first);
+        value = binary_operation(value, *first);
         *++result = value;
     }
     return ++result;
 }
 
+
+/*
+ * inclusive_scan, exclusive_scan: partial_sum, except that the terms may be
+ * added in any order, like in reduce. So the contiguous ranges of float and
+ * double are scanned with SIMD too.
+ * inclusive_scan writes first[0] + ... + first[i] at result[i], after init
+ * if there is one, exclusive_scan writes init + first[0] + ... + first[i -
+ * 1]. transform_inclusive_scan and transform_exclusive_scan scan the
+ * unary_operation of the elements. result may be first.
+ */
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation, typename Tp>
+OutputIterator inclusive_scan(InputIterator first, InputIterator last,
+                              OutputIterator result,
+                              BinaryOperation binary_operation, Tp init) {
+    return __inclusive_scan(first, last, result, binary_operation, init);
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation>
+OutputIterator inclusive_scan(InputIterator first, InputIterator last,
+                              OutputIterator result,
+                              BinaryOperation binary_operation) {
+    typedef typename iterator_traits<InputIterator>::value_type Tp;
+    if (first == last) return result;
+
+    Tp value = *first;
+    *result = value;
+    return __inclusive_scan(++first, last, ++result, binary_operation,
+                            value);
+}
+
+template <typename InputIterator, typename OutputIterator>
+OutputIterator inclusive_scan(InputIterator first, InputIterator last,
+                              OutputIterator result) {
+    typedef typename iterator_traits<InputIterator>::value_type Tp;
+    return STLL_NAMESPACE::inclusive_scan(first, last, result, plus<Tp>());
+}
+
+template <typename InputIterator, typename OutputIterator, typename Tp,
+          typename BinaryOperation>
+OutputIterator exclusive_scan(InputIterator first, InputIterator last,
+                              OutputIterator result, Tp init,
+                              BinaryOperation binary_operation) {
+    return __exclusive_scan(first, last, result, binary_operation, init);
+}
+
+template <typename InputIterator, typename OutputIterator, typename Tp>
+OutputIterator exclusive_scan(InputIterator first, InputIterator last,
+                              OutputIterator result, Tp init) {
+    return __exclusive_scan(first, last, result, plus<Tp>(), init);
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation, typename UnaryOperation, typename Tp>
+OutputIterator transform_inclusive_scan(InputIterator first,
+                                        InputIterator last,
+                                        OutputIterator result,
+                                        BinaryOperation binary_operation,
+                                        UnaryOperation unary_operation,
+                                        Tp init) {
+    for (; first != last; ++first, ++result) {
+        init = binary_operation(init, unary_operation(*first));
+        *result = init;
+    }
+    return result;
+}
+
+template <typename InputIterator, typename OutputIterator,
+          typename BinaryOperation, typename UnaryOperation>
+OutputIterator transform_inclusive_scan(InputIterator first,
+                                        InputIterator last,
+                                        OutputIterator result,
+                                        BinaryOperation binary_operation,
+                                        UnaryOperation unary_operation) {
+    if (first == last) return result;
+
+    auto value = unary_operation(*first);
+    *result = value;
+    return STLL_NAMESPACE::transform_inclusive_scan(++first, last, ++result,
+                                                    binary_operation,
+                                                    unary_operation, value);
+}
+
+template <typename InputIterator, typename OutputIterator, typename Tp,
+          typename BinaryOperation, typename UnaryOperation>
+OutputIterator transform_exclusive_scan(InputIterator first,
+                                        InputIterator last,
+                                        OutputIterator result, Tp init,
+                                        BinaryOperation binary_operation,
+                                        UnaryOperation unary_operation) {
+    for (; first != last; ++first, ++result) {
+        Tp value = binary_operation(init, unary_operation(*first));
+        *result = init;
+        init = STLL_NAMESPACE::move(value);
+    }
+    return result;
+}
+
 template <typename Tp, typename Integer, typename MonoidOperation>
 Tp power(Tp x, Integer n, MonoidOperation op) {
     if (n == 0)
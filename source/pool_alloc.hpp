@@ -3,8 +3,19 @@
 #include <exception>
 #include <cstdlib>
 #include <climits>
+#include <cstring>
+#include <cstdint>
+#include <ostream>
+#include <iomanip>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define __STLL_POOL_MMAP__
+#endif
 
 #include "base.hpp"
+#include "allocator.hpp"
 
 __STLL_NAMESPACE_START__
 
@@ -18,6 +29,7 @@ private:
                 NO_MEMORY_HANDLE
             }
             malloc_alloc_template_oom_handler();
+            ++oom_calls;
             void* result = malloc(n);
             if (result)
                 return result;
@@ -30,6 +42,7 @@ private:
                 NO_MEMORY_HANDLE
             }
             malloc_alloc_template_oom_handler();
+            ++oom_calls;
             void* result = realloc(p, n);
             if (result)
                 return result;
@@ -37,6 +50,7 @@ private:
     }
 
     static void (*malloc_alloc_template_oom_handler)();
+    static size_t oom_calls;
 
 public:
     static void* allocate(size_t n) {
@@ -54,207 +68,870 @@ public:
     }
 
     static void deallocate(void* p, size_t n) {
+        (void)n;
+        free(p);
+    }
+
+    // n bytes aligned on align, a power of two.
+    static void* allocate(size_t n, size_t align) {
+        if (align <= alignof(max_align_t))
+            return allocate(n);
+        size_t bytes = (n + align - 1) & ~(align - 1);
+        for (;;) {
+            void* result = aligned_alloc(align, bytes);
+            if (result)
+                return result;
+            if (malloc_alloc_template_oom_handler == nullptr) {
+                NO_MEMORY_HANDLE
+            }
+            malloc_alloc_template_oom_handler();
+            ++oom_calls;
+        }
+    }
+
+    static void deallocate(void* p, size_t n, size_t align) {
+        (void)n;
+        (void)align;
         free(p);
     }
 
     static void set_malloc_hanlder(void(*malloc_hanlder)()) {
         malloc_alloc_template_oom_handler = malloc_hanlder;
     }
+
+    // How many times the out of memory handler was called.
+    static size_t oom_handler_calls() {
+        return oom_calls;
+    }
 };
 
 template<int inst>
 void (*malloc_alloc_template<inst>::malloc_alloc_template_oom_handler)()
                                                               = nullptr;
 
+template<int inst>
+size_t malloc_alloc_template<inst>::oom_calls = 0;
+
+
+/*
+ * Size classes of alloc_template.
+ * Up to SMALL_BYTES the classes are ALIGN bytes apart. Above, every power
+ * of two interval (2^p, 2^(p+1)] is split into CLASSES_PER_DOUBLING classes
+ * of equal width, so a block wastes less than 1 / CLASSES_PER_DOUBLING of
+ * its size to rounding. Both bounds can be set before including this file.
+ * Requests above MAX_BYTES go to the large object tier.
+ */
+#ifndef STLL_POOL_MAX_BYTES
+#define STLL_POOL_MAX_BYTES 32768
+#endif
+
+#ifndef STLL_POOL_CLASSES_PER_DOUBLING
+#define STLL_POOL_CLASSES_PER_DOUBLING 4
+#endif
+
+// Smallest chunk the small classes are carved from, a power of two.
+#ifndef STLL_POOL_CHUNK_BYTES
+#define STLL_POOL_CHUNK_BYTES 65536
+#endif
+
+// Bytes of empty chunks kept for reuse before they are given back.
+#ifndef STLL_POOL_RETAIN_BYTES
+#define STLL_POOL_RETAIN_BYTES (1 << 20)
+#endif
+
+// Bytes of freed large spans kept for reuse instead of being unmapped.
+#ifndef STLL_POOL_SPAN_CACHE_BYTES
+#define STLL_POOL_SPAN_CACHE_BYTES (64 << 20)
+#endif
 
-// Use implementation of SGI STpL for out of memory handle.
-// #define SGI_OOM_IMPLEMENTp
+namespace
+{
 
+constexpr size_t __pool_log2(size_t n) {
+    return n <= 1 ? 0 : 1 + __pool_log2(n >> 1);
+}
+
+}
 
 enum {ALIGN = 8};
-enum {MAX_BYTpES = 128};
-enum {NFREELISTPS = MAX_BYTpES / ALIGN};
+enum {SMALL_BYTES = 128};
+enum {MAX_BYTES = STLL_POOL_MAX_BYTES};
+enum {CLASSES_PER_DOUBLING = STLL_POOL_CLASSES_PER_DOUBLING};
+enum {NFREELISTS = SMALL_BYTES / ALIGN
+                   + (__pool_log2(MAX_BYTES) - __pool_log2(SMALL_BYTES))
+                     * CLASSES_PER_DOUBLING};
 
 union obj {
     union obj* next;
     char client_data[0];
 };
 
+/*
+ * alloc_stats: a snapshot of the allocators, taken by alloc::stats().
+ * The gauges (bytes, chunks, peak heap) are always right. The counters of
+ * the allocation paths (allocations, deallocations, peak live bytes, span
+ * cache hits, allocator) stay zero unless STLL_ALLOC_STATS is defined,
+ * counters_enabled tells which.
+ */
+struct alloc_class_stats {
+    size_t      block_size;
+    size_t      chunks;
+    size_t      allocations;
+    size_t      deallocations;
+    size_t      live_blocks;
+    // Freed blocks waiting for reuse, and never used chunk tails.
+    size_t      free_bytes;
+    size_t      untouched_bytes;
+};
+
+struct alloc_stats {
+    bool                counters_enabled;
+
+    // Small classes of alloc.
+    alloc_class_stats   classes[NFREELISTS];
+    size_t              heap_bytes;
+    size_t              peak_heap_bytes;
+    size_t              live_bytes;
+    size_t              peak_live_bytes;
+    size_t              requested_bytes;
+    size_t              free_bytes;
+    size_t              untouched_bytes;
+    size_t              empty_bytes;
+    size_t              chunks;
+    size_t              chunk_allocs;
+    size_t              chunk_releases;
+    size_t              trims;
+    size_t              map_failures;
+
+    // Large object tier of alloc.
+    size_t              large_allocations;
+    size_t              large_deallocations;
+    size_t              large_bytes;
+    size_t              peak_large_bytes;
+    size_t              cached_large_bytes;
+    size_t              span_cache_hits;
+
+    // allocator, on top of operator new.
+    size_t              new_allocations;
+    size_t              new_deallocations;
+    size_t              new_live_bytes;
+    size_t              peak_new_live_bytes;
+
+    // malloc_alloc.
+    size_t              oom_handler_calls;
+
+    // One "name value" line per figure, then a table of the used classes.
+    void dump_text(std::ostream& out) const {
+        for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+            out << std::left << std::setw(24) << fields[i].name
+                << std::right << this->*fields[i].member << '\n';
+        }
+        out << std::left << std::setw(24) << "counters_enabled"
+            << std::right << (counters_enabled ? "true" : "false") << '\n';
+
+        out << "\n" << std::setw(10) << "block_size";
+        for (size_t j = 1; j < sizeof(class_fields) / sizeof(class_fields[0]);
+             ++j)
+            out << ' ' << std::setw(15) << class_fields[j].name;
+        out << '\n';
+        for (size_t index = 0; index < NFREELISTS; ++index) {
+            const alloc_class_stats& stats = classes[index];
+            if (stats.chunks == 0 and stats.allocations == 0)
+                continue;
+            out << std::setw(10) << stats.block_size;
+            for (size_t j = 1;
+                 j < sizeof(class_fields) / sizeof(class_fields[0]); ++j)
+                out << ' ' << std::setw(15) << stats.*class_fields[j].member;
+            out << '\n';
+        }
+    }
+
+    // One JSON object, the classes which were never used are left out.
+    void dump_json(std::ostream& out) const {
+        out << "{\"counters_enabled\":"
+            << (counters_enabled ? "true" : "false");
+        for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i)
+            out << ",\"" << fields[i].name << "\":" << this->*fields[i].member;
+
+        out << ",\"classes\":[";
+        bool first = true;
+        for (size_t index = 0; index < NFREELISTS; ++index) {
+            const alloc_class_stats& stats = classes[index];
+            if (stats.chunks == 0 and stats.allocations == 0)
+                continue;
+            out << (first ? "{" : ",{");
+            first = false;
+            for (size_t j = 0;
+                 j < sizeof(class_fields) / sizeof(class_fields[0]); ++j) {
+                out << (j ? ",\"" : "\"") << class_fields[j].name << "\":"
+                    << stats.*class_fields[j].member;
+            }
+            out << '}';
+        }
+        out << "]}";
+    }
+
+private:
+    struct field {
+        const char*     name;
+        size_t alloc_stats::*   member;
+    };
+
+    struct class_field {
+        const char*     name;
+        size_t alloc_class_stats::*     member;
+    };
+
+    static constexpr field fields[] = {
+        {"heap_bytes", &alloc_stats::heap_bytes},
+        {"peak_heap_bytes", &alloc_stats::peak_heap_bytes},
+        {"live_bytes", &alloc_stats::live_bytes},
+        {"peak_live_bytes", &alloc_stats::peak_live_bytes},
+        {"requested_bytes", &alloc_stats::requested_bytes},
+        {"free_bytes", &alloc_stats::free_bytes},
+        {"untouched_bytes", &alloc_stats::untouched_bytes},
+        {"empty_bytes", &alloc_stats::empty_bytes},
+        {"chunks", &alloc_stats::chunks},
+        {"chunk_allocs", &alloc_stats::chunk_allocs},
+        {"chunk_releases", &alloc_stats::chunk_releases},
+        {"trims", &alloc_stats::trims},
+        {"map_failures", &alloc_stats::map_failures},
+        {"large_allocations", &alloc_stats::large_allocations},
+        {"large_deallocations", &alloc_stats::large_deallocations},
+        {"large_bytes", &alloc_stats::large_bytes},
+        {"peak_large_bytes", &alloc_stats::peak_large_bytes},
+        {"cached_large_bytes", &alloc_stats::cached_large_bytes},
+        {"span_cache_hits", &alloc_stats::span_cache_hits},
+        {"new_allocations", &alloc_stats::new_allocations},
+        {"new_deallocations", &alloc_stats::new_deallocations},
+        {"new_live_bytes", &alloc_stats::new_live_bytes},
+        {"peak_new_live_bytes", &alloc_stats::peak_new_live_bytes},
+        {"oom_handler_calls", &alloc_stats::oom_handler_calls},
+    };
+
+    static constexpr class_field class_fields[] = {
+        {"block_size", &alloc_class_stats::block_size},
+        {"chunks", &alloc_class_stats::chunks},
+        {"allocations", &alloc_class_stats::allocations},
+        {"deallocations", &alloc_class_stats::deallocations},
+        {"live_blocks", &alloc_class_stats::live_blocks},
+        {"free_bytes", &alloc_class_stats::free_bytes},
+        {"untouched_bytes", &alloc_class_stats::untouched_bytes},
+    };
+};
+
+/*
+ * alloc_template: a pool of size classes.
+ * Every class carves its blocks from its own chunks. A chunk is a power of
+ * two of bytes aligned on its size, so the chunk of a block is found by
+ * masking the address, and it counts its live blocks. The chunks of a class
+ * which have a free block are linked in partial[index]; a chunk whose
+ * blocks are all freed is kept while the empty chunks stay under
+ * RETAIN_BYTES, and given back to the system beyond, or by trim(). After a
+ * burst, the memory held goes back close to the live set.
+ */
 template <int inst>
 class alloc_template {
 private:
+    static_assert((MAX_BYTES & (MAX_BYTES - 1)) == 0
+                  and size_t(MAX_BYTES) >= size_t(SMALL_BYTES),
+                  "MAX_BYTES must be a power of two, at least SMALL_BYTES");
+    static_assert((CLASSES_PER_DOUBLING & (CLASSES_PER_DOUBLING - 1)) == 0
+                  and CLASSES_PER_DOUBLING >= 1
+                  and CLASSES_PER_DOUBLING <= SMALL_BYTES / ALIGN,
+                  "CLASSES_PER_DOUBLING must be a power of two, "
+                  "at most SMALL_BYTES / ALIGN");
+    static_assert((STLL_POOL_CHUNK_BYTES & (STLL_POOL_CHUNK_BYTES - 1)) == 0,
+                  "STLL_POOL_CHUNK_BYTES must be a power of two");
+
+    enum {CHUNK_BYTES = STLL_POOL_CHUNK_BYTES};
+    // A chunk of a big class holds at least this many blocks.
+    enum {CHUNK_MIN_BLOCKS = 8};
+    // The first block of a chunk starts on a cache line, so a class whose
+    // size is a multiple of an alignment up to BLOCK_ALIGN has all its
+    // blocks aligned on it.
+    enum {BLOCK_ALIGN = 64};
+    enum {RETAIN_BYTES = STLL_POOL_RETAIN_BYTES};
+
+    enum {SPAN_CACHE_SLOTS = 16};
+    enum {SPAN_CACHE_BYTES = STLL_POOL_SPAN_CACHE_BYTES};
+
+    // Head of a chunk, the blocks follow it. Blocks never used yet are
+    // taken from [bump, limit), so a fresh chunk is not touched, and does
+    // not count in the resident memory, until it is used.
+    struct chunk_header {
+        chunk_header*   prev;
+        chunk_header*   next;
+        union obj*      free_blocks;
+        char*           bump;
+        char*           limit;
+        size_t          live;
+        size_t          index;
+    };
+
     inline static size_t round_up(size_t bytes) {
         return ((bytes + (ALIGN - 1)) & (~(ALIGN-1)));
     }
 
 private:
-
-private:
-    static union obj* free_list[NFREELISTPS];
-    static void* free_segment_start;
-    static void* free_segment_finish;
+    static chunk_header* partial[NFREELISTS];
     static size_t heap_size;
+    static size_t live_size;
+    static size_t requested_size;
+    static size_t empty_size;
 
-private:
+    // Freed large spans, oldest first.
+    static void* span_cache[SPAN_CACHE_SLOTS];
+    static size_t span_cache_size[SPAN_CACHE_SLOTS];
+    static size_t span_cache_count;
+    static size_t large_live_size;
+    static size_t large_cached_size;
+
+    // Counters of stats(), the gauges are filled when it is called.
+    static alloc_stats counters;
+
+public:
+    // Index of the smallest class holding bytes, 0 < bytes <= MAX_BYTES.
+    static size_t class_index(size_t bytes) {
+        if (bytes <= SMALL_BYTES)
+            return (bytes + ALIGN - 1) / ALIGN - 1;
+        // 2^power < bytes <= 2^(power+1)
+        size_t power = __pool_log2(bytes - 1);
+        size_t width = (size_t(1) << power) / CLASSES_PER_DOUBLING;
+        size_t step = (bytes - (size_t(1) << power) + width - 1) / width;
+        return SMALL_BYTES / ALIGN
+               + (power - __pool_log2(SMALL_BYTES)) * CLASSES_PER_DOUBLING
+               + step - 1;
+    }
 
-    static size_t FREELISTp_INDEX(size_t bytes) {
-        return (bytes + ALIGN - 1) / ALIGN - 1;
+    // Block size of the class index.
+    static size_t class_size(size_t index) {
+        if (index < SMALL_BYTES / ALIGN)
+            return (index + 1) * ALIGN;
+        index -= SMALL_BYTES / ALIGN;
+        size_t power = __pool_log2(SMALL_BYTES)
+                       + index / CLASSES_PER_DOUBLING;
+        size_t width = (size_t(1) << power) / CLASSES_PER_DOUBLING;
+        return (size_t(1) << power)
+               + (index % CLASSES_PER_DOUBLING + 1) * width;
     }
 
-    // n % 8 == 0
-    // Get more memory and insert them into free_list.
-    static void* refill(size_t size) {
-        size_t nobjs = 20;
-        void* result = chunk_alloc(size, &nobjs);
+    // Bytes of the chunks of the class index.
+    static size_t chunk_bytes(size_t index) {
+        size_t bytes = CHUNK_BYTES;
+        while (bytes < class_size(index) * CHUNK_MIN_BLOCKS)
+            bytes <<= 1;
+        return bytes;
+    }
 
-        if (nobjs == 1)
-            return result;
+private:
+    static chunk_header* chunk_of(void* p, size_t index) {
+        return (chunk_header*)(
+            uintptr_t(p) & ~uintptr_t(chunk_bytes(index) - 1)
+        );
+    }
 
-        size_t index = FREELISTp_INDEX(size);
+    static char* first_block(chunk_header* chunk) {
+        return (char*)chunk
+               + ((sizeof(chunk_header) + BLOCK_ALIGN - 1)
+                  & ~size_t(BLOCK_ALIGN - 1));
+    }
 
-        union obj* current_block = (union obj*)((char*)result + size);
-        union obj* next_block = nullptr;
-        free_list[index] = current_block;
+    static bool chunk_full(chunk_header* chunk, size_t size) {
+        return chunk->free_blocks == nullptr
+               and size_t(chunk->limit - chunk->bump) < size;
+    }
 
-        for (size_t i = 1; i < nobjs; ++i) {
-            if (i == nobjs -1)
-                next_block = nullptr;
-            else
-                next_block = (union obj*)((char*)current_block + size);
-            current_block->next = next_block;
-        }
+    static void link_chunk(chunk_header* chunk) {
+        chunk_header*& head = partial[chunk->index];
+        chunk->prev = nullptr;
+        chunk->next = head;
+        if (head)
+            head->prev = chunk;
+        head = chunk;
+    }
 
-        return result;
+    static void unlink_chunk(chunk_header* chunk) {
+        if (chunk->prev)
+            chunk->prev->next = chunk->next;
+        else
+            partial[chunk->index] = chunk->next;
+        if (chunk->next)
+            chunk->next->prev = chunk->prev;
+        chunk->prev = chunk->next = nullptr;
     }
 
-    // size % 8 == 0
-    // Only alloc memory and do not construct free_list.
-    static void* chunk_alloc(size_t size, size_t* p_nobjs) {
-        size_t bytes_left = size_t(free_segment_finish)
-                            - size_t(free_segment_start);
-        size_t bytes_wanted = size * (*p_nobjs);
-
-        if (bytes_left >= bytes_wanted) {
-            void* result = free_segment_start;
-            free_segment_start = (void*)(
-                        size_t(free_segment_start)
-                        + bytes_wanted
-                    );
-
-            return result;
-        } else if (bytes_left >= size) {
-            (*p_nobjs) = bytes_left / size;
-            void* result = free_segment_start;
-            free_segment_start = (void*)(
-                        size_t(free_segment_start) +
-                        size * (*p_nobjs)
-                    );
-            return result;
-        } else {
-            if (bytes_left > 0) {
-                // bytes_left still is a multiple of 8.
-                size_t index = FREELISTp_INDEX(bytes_left);
-                ((union obj*)free_segment_start)->next = free_list[index];
-                free_list[index] = (union obj*)free_segment_start;
+    // bytes of memory, a multiple of the page size, aligned on align, a
+    // power of two, or nullptr.
+    static void* map_aligned(size_t bytes, size_t align) {
+#ifdef __STLL_POOL_MMAP__
+        // Map align more and unmap what sticks out of the aligned part.
+        size_t total = bytes + align;
+        void* memory = mmap(nullptr, total, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            return nullptr;
+        char* region = (char*)memory;
+        char* aligned = (char*)(
+            (uintptr_t(region) + align - 1) & ~uintptr_t(align - 1)
+        );
+        if (aligned != region)
+            munmap(region, aligned - region);
+        if (region + total != aligned + bytes)
+            munmap(aligned + bytes, region + total - (aligned + bytes));
+        return aligned;
+#else
+        return aligned_alloc(align, (bytes + align - 1) & ~(align - 1));
+#endif
+    }
 
-                bytes_left = 0;
+    // Map a new chunk for the class index and put it in partial[index].
+    static chunk_header* chunk_alloc(size_t index) {
+        size_t bytes = chunk_bytes(index);
+        void* memory = map_aligned(bytes, bytes);
+        if (memory == nullptr) {
+            ++counters.map_failures;
+            trim();
+            memory = map_aligned(bytes, bytes);
+            if (memory == nullptr) {
+                NO_MEMORY_HANDLE
             }
+        }
 
-            size_t bytes_total_alloc = (
-                        (bytes_wanted << 1) + (heap_size >> 4)
-                   );
+        chunk_header* chunk = (chunk_header*)memory;
+        chunk->free_blocks = nullptr;
+        chunk->bump = first_block(chunk);
+        chunk->limit = (char*)memory + bytes;
+        chunk->live = 0;
+        chunk->index = index;
+        link_chunk(chunk);
+        heap_size += bytes;
+        empty_size += bytes;
+        ++counters.chunk_allocs;
+        ++counters.classes[index].chunks;
+        if (heap_size > counters.peak_heap_bytes)
+            counters.peak_heap_bytes = heap_size;
+        return chunk;
+    }
 
-            free_segment_start = malloc(bytes_total_alloc);
-            if (nullptr == free_segment_start) {
-                for (size_t i = size; i < MAX_BYTpES; size += ALIGN) {
-                    size_t index = FREELISTp_INDEX(i);
-                    union obj* block = free_list[index];
-                    free_list[index] = free_list[index]->next;
+    static void release_chunk(chunk_header* chunk) {
+        size_t bytes = chunk_bytes(chunk->index);
+        unlink_chunk(chunk);
+        heap_size -= bytes;
+        empty_size -= bytes;
+        ++counters.chunk_releases;
+        --counters.classes[chunk->index].chunks;
+        unmap_span(chunk, bytes);
+    }
 
-                    free_segment_start = (void*)block;
-                    free_segment_finish = (void*)free_list[index];
-                    return chunk_alloc(size, p_nobjs);
-                }
+    // A chunk with a single live block cannot be released, but the whole
+    // pages inside its free blocks can be dropped with madvise: they read
+    // back as zeros when the block is reused. The page holding the link of
+    // a block stays.
+    static size_t purge_free_blocks(chunk_header* chunk) {
+        size_t purged = 0;
+#ifdef __STLL_POOL_MMAP__
+        size_t size = class_size(chunk->index);
+        if (size < 2 * page_size())
+            return 0;
+        for (union obj* block = chunk->free_blocks; block;
+             block = block->next) {
+            char* first = (char*)round_up_pages(size_t(block + 1));
+            char* last = (char*)(
+                size_t((char*)block + size) & ~(page_size() - 1)
+            );
+            if (first < last) {
+                madvise(first, last - first, MADV_DONTNEED);
+                purged += last - first;
+            }
+        }
+#endif
+        return purged;
+    }
 
-                free_segment_finish = nullptr;
+    /*
+     * Large object tier: a request above MAX_BYTES is rounded up to whole
+     * pages and mapped on its own, so freeing it really gives the memory
+     * back. Recently freed spans are kept in a small cache and reused by a
+     * request of the same page count, which saves the mmap and munmap
+     * calls and the page faults of a buffer freed and allocated again.
+     */
+    static size_t page_size() {
+#ifdef __STLL_POOL_MMAP__
+        static const size_t size = size_t(sysconf(_SC_PAGESIZE));
+        return size;
+#else
+        return 4096;
+#endif
+    }
 
-#ifdef SGI_OOM_IMPLEMENT
+    static size_t round_up_pages(size_t bytes) {
+        size_t page = page_size();
+        return (bytes + page - 1) & ~(page - 1);
+    }
 
-                free_segment_start = malloc_alloc_template<0>::allocate(
-                    bytes_total_alloc
-                );
+    // bytes of memory, or nullptr.
+    static void* map_span(size_t bytes) {
+#ifdef __STLL_POOL_MMAP__
+        void* span = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return span == MAP_FAILED ? nullptr : span;
+#else
+        return malloc(bytes);
+#endif
+    }
 
+    static void unmap_span(void* span, size_t bytes) {
+#ifdef __STLL_POOL_MMAP__
+        munmap(span, bytes);
 #else
-                void* one_obj = malloc(size);
-                if (nullptr == one_obj) {
-                    one_obj = malloc_alloc_template<0>::allocate(size);
-                }
-                *p_nobjs = 1;
-                return one_obj;
+        malloc_alloc_template<0>::deallocate(span, bytes);
 #endif
+    }
+
+    static void remove_cached_span(size_t slot) {
+        large_cached_size -= span_cache_size[slot];
+        for (; slot + 1 < span_cache_count; ++slot) {
+            span_cache[slot] = span_cache[slot + 1];
+            span_cache_size[slot] = span_cache_size[slot + 1];
+        }
+        --span_cache_count;
+    }
+
+    // The most recent span of exactly bytes aligned on align, the size
+    // given back to deallocate must match the mapping.
+    static void* take_cached_span(size_t bytes, size_t align) {
+        for (size_t slot = span_cache_count; slot-- > 0;) {
+            if (span_cache_size[slot] == bytes
+                and (uintptr_t(span_cache[slot]) & (align - 1)) == 0) {
+                void* span = span_cache[slot];
+                remove_cached_span(slot);
+                __STLL_ALLOC_STAT(++counters.span_cache_hits;)
+                return span;
             }
-            heap_size += bytes_total_alloc;
+        }
+        return nullptr;
+    }
 
-            free_segment_finish = (void*)(
-                (char*)free_segment_start + bytes_total_alloc
-            );
-            return chunk_alloc(size, p_nobjs);
+    // Keep span for reuse, the oldest spans are unmapped to make room.
+    static void cache_span(void* span, size_t bytes) {
+        if (bytes > SPAN_CACHE_BYTES) {
+            unmap_span(span, bytes);
+            return;
         }
+        while (span_cache_count == SPAN_CACHE_SLOTS
+               or large_cached_size + bytes > SPAN_CACHE_BYTES) {
+            unmap_span(span_cache[0], span_cache_size[0]);
+            remove_cached_span(0);
+        }
+        span_cache[span_cache_count] = span;
+        span_cache_size[span_cache_count] = bytes;
+        ++span_cache_count;
+        large_cached_size += bytes;
     }
 
-public:
-    static void* allocate(size_t size) {
-        if (size > MAX_BYTpES) {
-            return malloc_alloc_template<0>::allocate(size);
+    static void release_span_cache() {
+        while (span_cache_count > 0) {
+            unmap_span(span_cache[0], span_cache_size[0]);
+            remove_cached_span(0);
+        }
+    }
+
+    // A span is aligned on a page, or on align if it is bigger.
+    static void* large_allocate(size_t size, size_t align) {
+        size_t bytes = round_up_pages(size);
+        if (align < page_size())
+            align = page_size();
+        void* span = take_cached_span(bytes, align);
+        if (span == nullptr)
+            span = map_large_span(bytes, align);
+        if (span == nullptr) {
+            ++counters.map_failures;
+            trim();
+            span = map_large_span(bytes, align);
+            if (span == nullptr) {
+                NO_MEMORY_HANDLE
+            }
+        }
+        large_live_size += bytes;
+        if (large_live_size > counters.peak_large_bytes)
+            counters.peak_large_bytes = large_live_size;
+        __STLL_ALLOC_STAT(++counters.large_allocations;)
+        return span;
+    }
+
+    static void* map_large_span(size_t bytes, size_t align) {
+        return align == page_size() ? map_span(bytes)
+                                    : map_aligned(bytes, align);
+    }
+
+    static void large_deallocate(void* p, size_t size) {
+        size_t bytes = round_up_pages(size);
+        large_live_size -= bytes;
+        __STLL_ALLOC_STAT(++counters.large_deallocations;)
+        cache_span(p, bytes);
+    }
+
+    // Smallest class whose blocks are aligned on align: its size is a
+    // multiple of align, up to BLOCK_ALIGN. NFREELISTS if there is none.
+    static size_t aligned_class_index(size_t size, size_t align) {
+        if (align > BLOCK_ALIGN or size > MAX_BYTES)
+            return NFREELISTS;
+        for (size_t index = class_index(size); index < NFREELISTS; ++index) {
+            if (class_size(index) % align == 0)
+                return index;
         }
+        return NFREELISTS;
+    }
+
+    static void* allocate_block(size_t index, size_t size) {
+        size_t block_size = class_size(index);
+        chunk_header* chunk = partial[index];
+        if (chunk == nullptr)
+            chunk = chunk_alloc(index);
 
-        size = round_up(size);
-        size_t index = FREELISTp_INDEX(size);
-        union obj* list = free_list[index];
-        union obj* result = nullptr;
-        if (list == nullptr) {
-            result = (union obj*)refill(size);
+        void* result = nullptr;
+        if (chunk->free_blocks) {
+            result = chunk->free_blocks;
+            chunk->free_blocks = chunk->free_blocks->next;
         } else {
-            result = list;
-            free_list[index] = list->next;
+            result = chunk->bump;
+            chunk->bump += block_size;
         }
+        if (chunk->live++ == 0)
+            empty_size -= chunk_bytes(index);
+        if (chunk_full(chunk, block_size))
+            unlink_chunk(chunk);
+        live_size += block_size;
+        requested_size += size;
+        __STLL_ALLOC_STAT(
+            ++counters.classes[index].allocations;
+            if (live_size > counters.peak_live_bytes)
+                counters.peak_live_bytes = live_size;
+        )
 
         return result;
     }
 
+    static void deallocate_block(void* p, size_t index, size_t size) {
+        size_t block_size = class_size(index);
+        chunk_header* chunk = chunk_of(p, index);
+        if (chunk_full(chunk, block_size))
+            link_chunk(chunk);
+        ((union obj*)p)->next = chunk->free_blocks;
+        chunk->free_blocks = (union obj*)p;
+        live_size -= block_size;
+        requested_size -= size;
+        __STLL_ALLOC_STAT(++counters.classes[index].deallocations;)
+
+        if (--chunk->live == 0) {
+            empty_size += chunk_bytes(index);
+            if (empty_size > RETAIN_BYTES)
+                release_chunk(chunk);
+        }
+    }
+
+public:
+    // size bytes aligned on ALIGN.
+    static void* allocate(size_t size) {
+        if (size > MAX_BYTES) {
+            return large_allocate(size, ALIGN);
+        }
+        if (size == 0)
+            size = 1;
+        return allocate_block(class_index(size), size);
+    }
+
+    // size bytes aligned on align, a power of two. The same align must be
+    // given back to deallocate.
+    static void* allocate(size_t size, size_t align) {
+        if (align <= ALIGN)
+            return allocate(size);
+        if (size == 0)
+            size = 1;
+        size_t index = aligned_class_index(size, align);
+        if (index == NFREELISTS)
+            return large_allocate(size, align);
+        return allocate_block(index, size);
+    }
+
     static void* reallocate(void* p, size_t old_size, size_t new_size) {
+        if (old_size == new_size)
+            return p;
+        if (old_size != 0 and new_size != 0
+            and old_size <= MAX_BYTES and new_size <= MAX_BYTES
+            and class_index(old_size) == class_index(new_size)) {
+            requested_size += new_size;
+            requested_size -= old_size;
+            return p;
+        }
+
+        void* result = allocate(new_size);
+        memcpy(result, p, old_size < new_size ? old_size : new_size);
         deallocate(p, old_size);
-        return allocate(new_size);
+        return result;
     }
 
     static void deallocate(void* p, size_t size) {
-        if (size > MAX_BYTpES) {
-            malloc_alloc_template<0>::deallocate(p, size);
+        if (size > MAX_BYTES) {
+            large_deallocate(p, size);
+            return;
+        }
+        if (size == 0)
+            size = 1;
+        deallocate_block(p, class_index(size), size);
+    }
+
+    static void deallocate(void* p, size_t size, size_t align) {
+        if (align <= ALIGN) {
+            deallocate(p, size);
+            return;
         }
+        if (size == 0)
+            size = 1;
+        size_t index = aligned_class_index(size, align);
+        if (index == NFREELISTS)
+            large_deallocate(p, size);
+        else
+            deallocate_block(p, index, size);
+    }
 
-        size = round_up(size);
-        size_t index = FREELISTp_INDEX(size);
-        ((union obj*)p)->next = free_list[index];
-        free_list[index] = (union obj*)p;
+    // Give every empty chunk and every cached large span back to the
+    // system, and purge the free blocks of the other chunks. Return how
+    // many bytes were released or purged.
+    static size_t trim() {
+        size_t released = empty_size + large_cached_size;
+        ++counters.trims;
+        release_span_cache();
+        for (size_t index = 0; index < NFREELISTS; ++index) {
+            chunk_header* chunk = partial[index];
+            while (chunk) {
+                chunk_header* next = chunk->next;
+                if (chunk->live == 0)
+                    release_chunk(chunk);
+                else
+                    released += purge_free_blocks(chunk);
+                chunk = next;
+            }
+        }
+        return released;
+    }
+
+    /*
+     * Fragmentation accounting of the small classes.
+     * heap_bytes() are held in chunks, live_bytes() of them are in blocks
+     * held by the program, of which requested_bytes() were asked for. The
+     * rest are free blocks, unused chunk tails and chunk headers;
+     * empty_bytes() are in chunks without a live block, which trim() gives
+     * back.
+     */
+    static size_t heap_bytes() {
+        return heap_size;
+    }
+
+    static size_t live_bytes() {
+        return live_size;
+    }
+
+    static size_t requested_bytes() {
+        return requested_size;
+    }
+
+    static size_t empty_bytes() {
+        return empty_size;
+    }
+
+    // Part of heap_bytes() which does not hold requested bytes, from 0 to 1.
+    static double fragmentation() {
+        return heap_size == 0 ? 0.0
+               : double(heap_size - requested_size) / double(heap_size);
+    }
+
+    // Bytes of the large spans held by the program, and kept in the cache.
+    static size_t large_bytes() {
+        return large_live_size;
+    }
+
+    static size_t cached_large_bytes() {
+        return large_cached_size;
+    }
+
+    // Snapshot of the pool, of allocator and of malloc_alloc. It walks the
+    // chunks which have a free block, so it is meant for a periodic dump,
+    // not for a hot path.
+    static alloc_stats stats() {
+        alloc_stats result = counters;
+#ifdef STLL_ALLOC_STATS
+        result.counters_enabled = true;
+        result.new_allocations = allocator_counters::allocations;
+        result.new_deallocations = allocator_counters::deallocations;
+        result.new_live_bytes = allocator_counters::live_bytes;
+        result.peak_new_live_bytes = allocator_counters::peak_live_bytes;
+#endif
+        result.heap_bytes = heap_size;
+        result.live_bytes = live_size;
+        result.requested_bytes = requested_size;
+        result.empty_bytes = empty_size;
+        result.large_bytes = large_live_size;
+        result.cached_large_bytes = large_cached_size;
+        result.oom_handler_calls =
+            malloc_alloc_template<0>::oom_handler_calls();
+
+        for (size_t index = 0; index < NFREELISTS; ++index) {
+            alloc_class_stats& stats = result.classes[index];
+            size_t size = class_size(index);
+            stats.block_size = size;
+            stats.live_blocks = stats.allocations - stats.deallocations;
+            // A chunk out of partial has neither free block nor room.
+            for (chunk_header* chunk = partial[index]; chunk;
+                 chunk = chunk->next) {
+                size_t carved = size_t(chunk->bump - first_block(chunk))
+                                / size;
+                stats.free_bytes += (carved - chunk->live) * size;
+                stats.untouched_bytes += chunk->limit - chunk->bump;
+            }
+            result.free_bytes += stats.free_bytes;
+            result.untouched_bytes += stats.untouched_bytes;
+            result.chunks += stats.chunks;
+        }
+        return result;
     }
 };
 
 
 template <int inst>
-void* alloc_template<inst>::free_segment_start = nullptr;
+typename alloc_template<inst>::chunk_header*
+alloc_template<inst>::partial[NFREELISTS] = {};
 
 template <int inst>
-void* alloc_template<inst>::free_segment_finish = nullptr;
+size_t alloc_template<inst>::heap_size = 0;
 
 template <int inst>
-size_t alloc_template<inst>::heap_size = 0;
+size_t alloc_template<inst>::live_size = 0;
 
 template <int inst>
-union obj* alloc_template<inst>::free_list[NFREELISTPS] = {
-    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
-    nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
-    nullptr, nullptr, nullptr, nullptr
-};
+size_t alloc_template<inst>::requested_size = 0;
+
+template <int inst>
+size_t alloc_template<inst>::empty_size = 0;
+
+template <int inst>
+void* alloc_template<inst>::span_cache[SPAN_CACHE_SLOTS] = {};
+
+template <int inst>
+size_t alloc_template<inst>::span_cache_size[SPAN_CACHE_SLOTS] = {};
+
+template <int inst>
+size_t alloc_template<inst>::span_cache_count = 0;
+
+template <int inst>
+size_t alloc_template<inst>::large_live_size = 0;
+
+template <int inst>
+size_t alloc_template<inst>::large_cached_size = 0;
+
+template <int inst>
+alloc_stats alloc_template<inst>::counters = alloc_stats();
 
 using alloc = alloc_template<0>;
 using malloc_alloc = malloc_alloc_template<0>;
@@ -271,24 +948,35 @@ public:
     typedef size_t      size_type;
     typedef ptrdiff_t   difference_type;
 
+    template <typename Up>
+    struct rebind {
+        typedef pool_alloc<Up, Alloc> other;
+    };
+
 public:
+    pool_alloc() {}
+
+    template <typename Up>
+    pool_alloc(const pool_alloc<Up, Alloc>&) {}
+
     static Tp* allocate(size_t n) {
         return (0 == n ? pointer(nullptr) :
-                         pointer(Alloc::allocate(n * sizeof(Tp))));
+                         pointer(Alloc::allocate(n * sizeof(Tp),
+                                                 alignof(Tp))));
     }
 
     static Tp* allocate(void) {
-        return pointer(Alloc::allocate(sizeof(Tp)));
+        return pointer(Alloc::allocate(sizeof(Tp), alignof(Tp)));
     }
 
     static void deallocate(Tp* p, size_t n) {
         if (p && n)
-            Alloc::deallocate(p, sizeof(n * sizeof(Tp)));
+            Alloc::deallocate(p, n * sizeof(Tp), alignof(Tp));
     }
 
     static void deallocate(Tp* p) {
         if (p)
-            Alloc::deallocate(p, sizeof(Tp));
+            Alloc::deallocate(p, sizeof(Tp), alignof(Tp));
     }
 };
 
@@ -7,8 +7,14 @@
 
 __STLL_NAMESPACE_START__
 
+/*
+ * Arity is the number of children of a heap node, see heap.hpp.
+ * A 4-ary heap is half as deep as a binary one, so a pop touches fewer
+ * cache lines, which usually pays off for large queues.
+ */
 template <typename Tp, typename Sequence=vector<Tp>,
-          typename Compare=less<typename Sequence::value_type>>
+          typename Compare=less<typename Sequence::value_type>,
+          size_t Arity=2>
 class priority_queue {
 public:
     typedef typename Sequence::value_type       value_type;
@@ -19,7 +25,9 @@ public:
     typedef typename Sequence::size_type        size_type;
     typedef typename Sequence::difference_type  difference_type;
 
-    typedef priority_queue<Tp, Sequence, Compare> self;
+    typedef priority_queue<Tp, Sequence, Compare, Arity> self;
+
+    enum {arity = Arity};
 
 protected:
     Sequence sequence;
@@ -34,11 +42,10 @@ public:
 
     template <typename InputIterator>
     priority_queue(InputIterator first, InputIterator last,
-                   const Compare& comp=
-                   less<typename iterator_traits<InputIterator>::value_type>())
+                   const Compare& comp=Compare())
         :sequence(first, last), comp(comp)
     {
-        make_heap(sequence.begin(), sequence.end(), comp);
+        make_heap<Arity>(sequence.begin(), sequence.end(), comp);
     }
 
     priority_queue(const self&) = default;
@@ -61,14 +68,128 @@ public:
 
     void push(const value_type& value) {
         sequence.push_back(value);
-        push_heap(sequence.begin(), sequence.end(), comp);
+        push_heap<Arity>(sequence.begin(), sequence.end(), comp);
     }
 
     void pop() {
-        pop_heap(sequence.begin(), sequence.end(), comp);
+        pop_heap<Arity>(sequence.begin(), sequence.end(), comp);
         sequence.pop_back();
     }
 
+    // Push [first, last). Sifting up every new element costs O(k log n),
+    // appending them all and rebuilding the heap costs O(n + k), the
+    // cheaper one is picked once k is known.
+    template <typename InputIterator>
+    void push_range(InputIterator first, InputIterator last) {
+        size_type old_size = size();
+        for (; first != last; ++first)
+            sequence.push_back(*first);
+        size_type added = size() - old_size;
+        if (added == 0)
+            return;
+
+        if (added * heap_depth(size()) > size()) {
+            make_heap<Arity>(sequence.begin(), sequence.end(), comp);
+            return;
+        }
+        for (size_type n = old_size + 1; n <= size(); ++n)
+            push_heap<Arity>(sequence.begin(), sequence.begin() + n, comp);
+    }
+
+    // Pop the top n elements into out, greatest first, return the end of
+    // out. For a small n they are popped one by one. Otherwise the n
+    // greatest are selected by walking the heap from the root, which does
+    // not move the other elements, then the rest is rebuilt in O(size()).
+    template <typename OutputIterator>
+    OutputIterator pop_n(size_type n, OutputIterator out) {
+        if (n > size())
+            n = size();
+        if (n == 0)
+            return out;
+
+        if (n * heap_depth(size()) > size())
+            return select_top(n, out);
+
+        for (; n > 0; --n) {
+            pop_heap<Arity>(sequence.begin(), sequence.end(), comp);
+            *out = STLL_NAMESPACE::move(*(sequence.end() - 1));
+            ++out;
+            sequence.pop_back();
+        }
+        return out;
+    }
+
+protected:
+    typedef typename Sequence::iterator     iterator;
+
+    // Compare two heap elements given by their indices.
+    struct index_compare {
+        iterator    base;
+        Compare     comp;
+
+        index_compare(iterator base, const Compare& comp)
+            :base(base), comp(comp)
+        {}
+
+        bool operator()(size_type lhs, size_type rhs) const {
+            return comp(*(base + lhs), *(base + rhs));
+        }
+    };
+
+    // Number of levels of a heap of n elements.
+    static size_type heap_depth(size_type n) {
+        size_type depth = 1;
+        size_type width = 1;
+        for (size_type total = 1; total < n; total += width) {
+            width *= Arity;
+            ++depth;
+        }
+        return depth;
+    }
+
+    // The n greatest elements form a subtree at the root, the next
+    // greatest is always a child of an already selected one: keep the
+    // candidates in a small heap of indices, the frontier.
+    template <typename OutputIterator>
+    OutputIterator select_top(size_type n, OutputIterator out) {
+        iterator base = sequence.begin();
+        size_type len = size();
+        vector<size_type> frontier;
+        vector<char> taken(len, char(0));
+        index_compare frontier_comp(base, comp);
+
+        frontier.push_back(0);
+        for (; n > 0; --n) {
+            STLL_NAMESPACE::pop_heap(frontier.begin(), frontier.end(),
+                                     frontier_comp);
+            size_type index = *(frontier.end() - 1);
+            frontier.pop_back();
+
+            *out = STLL_NAMESPACE::move(*(base + index));
+            ++out;
+            taken[index] = 1;
+
+            size_type child = index * Arity + 1;
+            for (size_type i = 0; i < Arity and child + i < len; ++i) {
+                frontier.push_back(child + i);
+                STLL_NAMESPACE::push_heap(frontier.begin(), frontier.end(),
+                                          frontier_comp);
+            }
+        }
+
+        size_type kept = 0;
+        for (size_type index = 0; index < len; ++index) {
+            if (taken[index])
+                continue;
+            if (kept != index)
+                *(base + kept) = STLL_NAMESPACE::move(*(base + index));
+            ++kept;
+        }
+        while (size() > kept)
+            sequence.pop_back();
+        make_heap<Arity>(sequence.begin(), sequence.end(), comp);
+        return out;
+    }
 };
 
 __STLL_NAMESPACE_FINISH__
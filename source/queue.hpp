@@ -70,8 +70,24 @@ public:
         sequence.emplace_back(args...);
     }
 
+    // Push every element of [first, last) at the back in one batch.
+    template <typename InputIterator>
+    void push_range(InputIterator first, InputIterator last) {
+        sequence.append(first, last);
+    }
+
+    // Pop n elements in one batch, writing them to out in pop() order.
+    template <typename OutputIterator>
+    OutputIterator pop_n(size_type n, OutputIterator out) {
+        return sequence.pop_front_n(n, out);
+    }
+
+    void pop_n(size_type n) {
+        sequence.pop_front_n(n);
+    }
+
     void swap(self& another) {
-        sequence.swap(another);
+        sequence.swap(another.sequence);
     }
 
 };
@@ -195,29 +195,39 @@ public:
 
     typedef rb_tree_iterator<value_type, const_reference, const_pointer>
                                 const_iterator;
+    typedef Alloc               allocator_type;
+
 protected:
+    Alloc       node_allocator;
     size_type   node_count;
     link_type   tree_root;
     Compare     compare;
 
 public:
     rb_tree()
-        : node_count(0)
+        : node_allocator()
+        , node_count(0)
         , tree_root(link_type(NIL))
         , compare(Compare())
     {}
 
-    rb_tree(const Compare& compare)
-        : node_count(0)
+    rb_tree(const Compare& compare, const Alloc& allocator=Alloc())
+        : node_allocator(allocator)
+        , node_count(0)
         , tree_root(link_type(NIL))
         , compare(compare)
     {}
 
-    rb_tree(const self& other) {
+    rb_tree(const self& other)
+        : node_allocator(other.node_allocator)
+        , node_count(other.node_count)
+        , tree_root(link_type(NIL))
+        , compare(other.compare) {
         reflect_copy(other.root(), tree_root);
     }
 
-    rb_tree(self&& other) {
+    rb_tree(self&& other)
+        : node_allocator(other.node_allocator) {
         tree_root = other.tree_root;
         node_count = other.node_count;
         compare = other.compare;
@@ -231,8 +241,12 @@ public:
     }
 
     self& operator=(const self& other) {
+        if (this == &other)
+            return *this;
         clear();
         reflect_copy(other.root(), tree_root);
+        node_count = other.node_count;
+        compare = other.compare;
         return *this;
     }
 
@@ -307,7 +321,8 @@ public:
 
 
     void clear() {
-         vector<link_type> nodes(node_count);
+         vector<link_type> nodes;
+         nodes.reserve(node_count);
          for (iterator iter = begin(); iter != end(); ++iter)
              nodes.push_back(link_type(iter.node));
          for (auto node: nodes)
@@ -317,9 +332,14 @@ public:
     }
 
     void swap(self& other) {
-        swap(tree_root, other.tree_root);
-        swap(compare, other.compare);
-        swap(node_count, other.node_count);
+        STLL_NAMESPACE::swap(node_allocator, other.node_allocator);
+        STLL_NAMESPACE::swap(tree_root, other.tree_root);
+        STLL_NAMESPACE::swap(compare, other.compare);
+        STLL_NAMESPACE::swap(node_count, other.node_count);
+    }
+
+    Alloc get_allocator() const {
+        return node_allocator;
     }
 
     pair<iterator, bool> insert(const value_type& value) {
@@ -398,7 +418,7 @@ protected:
     }
 
     link_type get_node() {
-        return alloc::allocate(1);
+        return node_allocator.allocate(1);
     }
 
     link_type clone_node(link_type x) {
@@ -409,7 +429,7 @@ protected:
     }
 
     void put_node(link_type ptr) {
-        alloc::deallocate(ptr, 1);
+        node_allocator.deallocate(ptr, 1);
     }
 
     link_type create_node(const value_type& x) {
@@ -420,24 +440,28 @@ protected:
         return tmp;
     }
 
-    void reflect_copy(const link_type& from, link_type& to) {
+    // Clone the subtree from into to, which must be NIL.
+    void reflect_copy(link_type from, link_type& to) {
         if (from == NIL)
             return;
-        if (to == NIL)
-            to = clone_node(from);
+        to = clone_node(from);
+        link_type child = link_type(NIL);
         if (from->left != NIL) {
-            copy(from->left, to->left);
-            to->left->parent = to;
+            reflect_copy(link_type(from->left), child);
+            to->left = child;
+            child->parent = to;
         }
+        child = link_type(NIL);
         if (from->right != NIL) {
-            copy(from->right, to->right);
-            to->right->parent = to;
+            reflect_copy(link_type(from->right), child);
+            to->right = child;
+            child->parent = to;
         }
     }
 
 
     void destroy_node(link_type ptr) {
-        destroy(&ptr->value_field);
+        STLL_NAMESPACE::destroy(&ptr->value_field);
         put_node(ptr);
     }
 
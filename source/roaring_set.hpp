@@ -0,0 +1,1133 @@
+#ifndef ROARING_SET_HPP
+#define ROARING_SET_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+
+#include "base.hpp"
+#include "bit_ops.hpp"
+#include "iterator.hpp"
+#include "move.hpp"
+#include "vector.hpp"
+
+__STLL_NAMESPACE_START__
+
+/*
+ * __roaring_container: the values of a roaring_set whose high 16 bits are
+ * key, kept as their low 16 bits in one of three forms:
+ *   ARRAY:  values holds them sorted, for at most ARRAY_MAX of them.
+ *   BITMAP: bitmap holds 65536 bits, for more than ARRAY_MAX.
+ *   RUN:    values holds a (start, length - 1) pair per run of
+ *           consecutive values, see roaring_set::run_optimize().
+ * An array takes 2 bytes a value and a bitmap 8KB, so the array is the
+ * smaller one up to 4096 values. A container is never empty.
+ */
+struct __roaring_container {
+    enum {ARRAY = 0, BITMAP = 1, RUN = 2};
+    enum {ARRAY_MAX = 4096};
+    enum {BITMAP_WORDS = 65536 / BIT_WORD_BITS};
+
+    vector<uint16_t>    values;
+    vector<uint64_t>    bitmap;
+    uint32_t            cardinality;
+    uint16_t            key;
+    unsigned char       type;
+
+    explicit __roaring_container(uint16_t key=0)
+        :values(), bitmap(), cardinality(0), key(key), type(ARRAY)
+    {}
+};
+
+namespace
+{
+
+typedef __roaring_container __roaring_rc;
+
+// The index of the first of the count sorted values not less than value.
+inline size_t __roaring_lower_bound(const uint16_t* values, size_t count,
+                                    uint16_t value) {
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (values[middle] < value)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+inline bool __roaring_test(const uint64_t* words, uint32_t low) {
+    return (words[low / BIT_WORD_BITS] >> (low % BIT_WORD_BITS)) & 1;
+}
+
+// Set the bits of [first, last) of a bitmap.
+inline void __roaring_set_range(uint64_t* words, uint32_t first,
+                                uint32_t last) {
+    for (; first < last and first % BIT_WORD_BITS != 0; ++first)
+        words[first / BIT_WORD_BITS] |= uint64_t(1) << (first % BIT_WORD_BITS);
+    for (; first + BIT_WORD_BITS <= last; first += BIT_WORD_BITS)
+        words[first / BIT_WORD_BITS] = ~uint64_t(0);
+    for (; first < last; ++first)
+        words[first / BIT_WORD_BITS] |= uint64_t(1) << (first % BIT_WORD_BITS);
+}
+
+// Call f(low) on the values of c in order.
+template <typename Function>
+inline void __roaring_for_each(const __roaring_rc& c, Function& f) {
+    const uint16_t* values = c.values.data();
+    switch (c.type) {
+    case __roaring_rc::ARRAY:
+        for (size_t i = 0; i < c.values.size(); ++i)
+            f(uint32_t(values[i]));
+        break;
+    case __roaring_rc::BITMAP:
+        for (size_t i = 0; i < __roaring_rc::BITMAP_WORDS; ++i) {
+            for (uint64_t word = c.bitmap[i]; word != 0; word &= word - 1)
+                f(uint32_t(i * BIT_WORD_BITS + __bit_ctz(word)));
+        }
+        break;
+    default:
+        for (size_t i = 0; i < c.values.size(); i += 2) {
+            uint32_t last = uint32_t(values[i]) + values[i + 1];
+            for (uint32_t low = values[i]; low <= last; ++low)
+                f(low);
+        }
+        break;
+    }
+}
+
+inline void __roaring_to_bitmap(__roaring_rc& c) {
+    vector<uint64_t> bitmap(size_t(__roaring_rc::BITMAP_WORDS), uint64_t(0));
+    const uint16_t* values = c.values.data();
+    if (c.type == __roaring_rc::ARRAY) {
+        for (size_t i = 0; i < c.values.size(); ++i)
+            bitmap[values[i] / BIT_WORD_BITS] |=
+                uint64_t(1) << (values[i] % BIT_WORD_BITS);
+    } else {
+        for (size_t i = 0; i < c.values.size(); i += 2)
+            __roaring_set_range(bitmap.data(), values[i],
+                                uint32_t(values[i]) + values[i + 1] + 1);
+    }
+    c.bitmap = STLL_NAMESPACE::move(bitmap);
+    c.values = vector<uint16_t>();
+    c.type = __roaring_rc::BITMAP;
+}
+
+inline void __roaring_to_array(__roaring_rc& c) {
+    vector<uint16_t> values;
+    values.reserve(c.cardinality);
+    auto push = [&values](uint32_t low) {
+        values.push_back(uint16_t(low));
+    };
+    __roaring_for_each(c, push);
+    c.values = STLL_NAMESPACE::move(values);
+    c.bitmap = vector<uint64_t>();
+    c.type = __roaring_rc::ARRAY;
+}
+
+// Put c in the smaller of the array and the bitmap forms.
+inline void __roaring_normalize(__roaring_rc& c) {
+    if (c.cardinality <= __roaring_rc::ARRAY_MAX) {
+        if (c.type != __roaring_rc::ARRAY)
+            __roaring_to_array(c);
+    } else if (c.type != __roaring_rc::BITMAP) {
+        __roaring_to_bitmap(c);
+    }
+}
+
+// The number of runs of consecutive values of c.
+inline size_t __roaring_run_count(const __roaring_rc& c) {
+    const uint16_t* values = c.values.data();
+    size_t runs = 0;
+    switch (c.type) {
+    case __roaring_rc::ARRAY:
+        for (size_t i = 0; i < c.values.size(); ++i) {
+            if (i == 0 or values[i] != values[i - 1] + 1)
+                ++runs;
+        }
+        break;
+    case __roaring_rc::BITMAP: {
+        // A run starts at a set bit whose lower neighbour is clear.
+        uint64_t carry = 0;
+        for (size_t i = 0; i < __roaring_rc::BITMAP_WORDS; ++i) {
+            uint64_t word = c.bitmap[i];
+            runs += __bit_popcount(word & ~((word << 1) | carry));
+            carry = word >> (BIT_WORD_BITS - 1);
+        }
+        break;
+    }
+    default:
+        runs = c.values.size() / 2;
+        break;
+    }
+    return runs;
+}
+
+inline void __roaring_to_runs(__roaring_rc& c) {
+    vector<uint16_t> runs;
+    runs.reserve(2 * __roaring_run_count(c));
+    auto push = [&runs](uint32_t low) {
+        size_t n = runs.size();
+        if (n != 0 and uint32_t(runs[n - 2]) + runs[n - 1] + 1 == low)
+            ++runs[n - 1];
+        else {
+            runs.push_back(uint16_t(low));
+            runs.push_back(0);
+        }
+    };
+    __roaring_for_each(c, push);
+    c.values = STLL_NAMESPACE::move(runs);
+    c.bitmap = vector<uint64_t>();
+    c.type = __roaring_rc::RUN;
+}
+
+inline bool __roaring_contains(const __roaring_rc& c, uint16_t low) {
+    const uint16_t* values = c.values.data();
+    switch (c.type) {
+    case __roaring_rc::ARRAY: {
+        size_t i = __roaring_lower_bound(values, c.values.size(), low);
+        return i < c.values.size() and values[i] == low;
+    }
+    case __roaring_rc::BITMAP:
+        return __roaring_test(c.bitmap.data(), low);
+    default: {
+        // The last run which starts at or before low.
+        size_t first = 0;
+        size_t last = c.values.size() / 2;
+        while (first < last) {
+            size_t middle = first + (last - first) / 2;
+            if (values[2 * middle] <= low)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+        return first != 0
+               and low - values[2 * first - 2] <= values[2 * first - 1];
+    }
+    }
+}
+
+// The capacity an array of size values grows to: twice the size while it
+// is small, then half and a quarter more, so a large array has at most 25%
+// of its storage unused instead of the 50% of a doubling.
+inline size_t __roaring_grow(size_t size) {
+    size_t cap = size < 64 ? 2 * size + 4
+                 : size < 1024 ? size + size / 2 : size + size / 4;
+    size_t limit = __roaring_rc::ARRAY_MAX;
+    return cap < limit ? cap : limit;
+}
+
+inline bool __roaring_add(__roaring_rc& c, uint16_t low) {
+    if (c.type == __roaring_rc::RUN) {
+        if (__roaring_contains(c, low))
+            return false;
+        __roaring_normalize(c);
+    }
+    if (c.type == __roaring_rc::BITMAP) {
+        uint64_t& word = c.bitmap[low / BIT_WORD_BITS];
+        uint64_t mask = uint64_t(1) << (low % BIT_WORD_BITS);
+        if (word & mask)
+            return false;
+        word |= mask;
+        ++c.cardinality;
+        return true;
+    }
+    size_t size = c.values.size();
+    size_t i = __roaring_lower_bound(c.values.data(), size, low);
+    if (i < size and c.values[i] == low)
+        return false;
+    if (size == __roaring_rc::ARRAY_MAX) {
+        __roaring_to_bitmap(c);
+        return __roaring_add(c, low);
+    }
+    if (size == c.values.capacity())
+        c.values.reserve(__roaring_grow(size));
+    c.values.push_back(low);
+    uint16_t* values = c.values.data();
+    std::memmove(values + i + 1, values + i, (size - i) * sizeof(uint16_t));
+    values[i] = low;
+    ++c.cardinality;
+    return true;
+}
+
+inline bool __roaring_remove(__roaring_rc& c, uint16_t low) {
+    if (!__roaring_contains(c, low))
+        return false;
+    if (c.type == __roaring_rc::RUN)
+        __roaring_normalize(c);
+    --c.cardinality;
+    if (c.type == __roaring_rc::BITMAP) {
+        c.bitmap[low / BIT_WORD_BITS] &=
+            ~(uint64_t(1) << (low % BIT_WORD_BITS));
+        if (c.cardinality <= __roaring_rc::ARRAY_MAX)
+            __roaring_to_array(c);
+        return true;
+    }
+    size_t size = c.values.size();
+    size_t i = __roaring_lower_bound(c.values.data(), size, low);
+    uint16_t* values = c.values.data();
+    std::memmove(values + i, values + i + 1, (size - i - 1) * sizeof(uint16_t));
+    c.values.pop_back();
+    return true;
+}
+
+// c, or a copy of it in the array or bitmap form in buffer.
+inline const __roaring_rc& __roaring_plain(const __roaring_rc& c,
+                                           __roaring_rc& buffer) {
+    if (c.type != __roaring_rc::RUN)
+        return c;
+    buffer = c;
+    __roaring_normalize(buffer);
+    return buffer;
+}
+
+// result = bitmap1 Operation bitmap2 with the SIMD kernels.
+template <int Operation>
+inline void __roaring_bitmaps(const __roaring_rc& c1, const __roaring_rc& c2,
+                              __roaring_rc& result) {
+    const uint64_t* words1 = c1.bitmap.data();
+    result.bitmap = vector<uint64_t>(size_t(__roaring_rc::BITMAP_WORDS),
+                                     uint64_t(0));
+    __bits_apply<Operation>(words1, words1 + __roaring_rc::BITMAP_WORDS,
+                            c2.bitmap.data(), result.bitmap.data());
+    result.type = __roaring_rc::BITMAP;
+    result.cardinality = uint32_t(__bits_count(
+        result.bitmap.data(),
+        result.bitmap.data() + __roaring_rc::BITMAP_WORDS));
+    __roaring_normalize(result);
+}
+
+// Keep the first count values of a vector filled to its size, and give
+// the rest of its storage back.
+inline void __roaring_truncate(vector<uint16_t>& values, size_t count) {
+    while (values.size() > count)
+        values.pop_back();
+    values.shrink_to_fit();
+}
+
+/*
+ * The values of the sorted array values1 which are (Keep true) or are not
+ * (Keep false) in the sorted array values2. When one is far smaller, its
+ * values are looked up in the other by binary search, in O(n1 log n2),
+ * else both are merged. The merge has no branch on the values, whose
+ * order is random: each value is written, the output advances by one if
+ * it is kept, and each input if its value is the smaller.
+ */
+template <bool Keep>
+inline void __roaring_filter_arrays(const vector<uint16_t>& values1,
+                                    const vector<uint16_t>& values2,
+                                    vector<uint16_t>& result) {
+    const uint16_t* first1 = values1.data();
+    const uint16_t* last1 = first1 + values1.size();
+    const uint16_t* first2 = values2.data();
+    const uint16_t* last2 = first2 + values2.size();
+    result = vector<uint16_t>(values1.size(), uint16_t(0));
+    uint16_t* out = result.data();
+    size_t count = 0;
+    if (values1.size() * 32 < values2.size()) {
+        for (; first1 != last1; ++first1) {
+            first2 += __roaring_lower_bound(first2, last2 - first2, *first1);
+            bool found = first2 != last2 and *first2 == *first1;
+            out[count] = *first1;
+            count += found == Keep;
+        }
+    } else {
+        while (first1 != last1 and first2 != last2) {
+            uint16_t value1 = *first1;
+            uint16_t value2 = *first2;
+            out[count] = value1;
+            count += Keep ? value1 == value2 : value1 < value2;
+            first1 += value1 <= value2;
+            first2 += value2 <= value1;
+        }
+        for (; !Keep and first1 != last1; ++first1)
+            out[count++] = *first1;
+    }
+    __roaring_truncate(result, count);
+}
+
+// The values of the array c1 which are (Keep true) or are not (Keep false)
+// in the bitmap c2.
+template <bool Keep>
+inline void __roaring_filter_array(const __roaring_rc& c1,
+                                   const __roaring_rc& c2,
+                                   __roaring_rc& result) {
+    const uint64_t* words = c2.bitmap.data();
+    result.values = vector<uint16_t>(c1.values.size(), uint16_t(0));
+    uint16_t* out = result.values.data();
+    size_t count = 0;
+    for (size_t i = 0; i < c1.values.size(); ++i) {
+        out[count] = c1.values[i];
+        count += __roaring_test(words, c1.values[i]) == Keep;
+    }
+    __roaring_truncate(result.values, count);
+    result.type = __roaring_rc::ARRAY;
+    result.cardinality = uint32_t(count);
+}
+
+inline void __roaring_and(const __roaring_rc& c1, const __roaring_rc& c2,
+                          __roaring_rc& result) {
+    if (c1.type == __roaring_rc::BITMAP and c2.type == __roaring_rc::BITMAP) {
+        __roaring_bitmaps<SIMD_BIT_AND>(c1, c2, result);
+    } else if (c1.type == __roaring_rc::BITMAP) {
+        __roaring_filter_array<true>(c2, c1, result);
+    } else if (c2.type == __roaring_rc::BITMAP) {
+        __roaring_filter_array<true>(c1, c2, result);
+    } else {
+        if (c1.values.size() <= c2.values.size())
+            __roaring_filter_arrays<true>(c1.values, c2.values, result.values);
+        else
+            __roaring_filter_arrays<true>(c2.values, c1.values, result.values);
+        result.type = __roaring_rc::ARRAY;
+        result.cardinality = uint32_t(result.values.size());
+    }
+}
+
+inline void __roaring_or(const __roaring_rc& c1, const __roaring_rc& c2,
+                         __roaring_rc& result) {
+    if (c1.type == __roaring_rc::BITMAP and c2.type == __roaring_rc::BITMAP) {
+        __roaring_bitmaps<SIMD_BIT_OR>(c1, c2, result);
+    } else if (c1.type == __roaring_rc::BITMAP
+               or c2.type == __roaring_rc::BITMAP) {
+        const __roaring_rc& array = c1.type == __roaring_rc::BITMAP ? c2 : c1;
+        result = c1.type == __roaring_rc::BITMAP ? c1 : c2;
+        uint64_t* words = result.bitmap.data();
+        for (size_t i = 0; i < array.values.size(); ++i) {
+            uint16_t low = array.values[i];
+            uint64_t mask = uint64_t(1) << (low % BIT_WORD_BITS);
+            result.cardinality += (words[low / BIT_WORD_BITS] & mask) == 0;
+            words[low / BIT_WORD_BITS] |= mask;
+        }
+    } else if (c1.cardinality + c2.cardinality > __roaring_rc::ARRAY_MAX) {
+        result = c1;
+        __roaring_to_bitmap(result);
+        uint64_t* words = result.bitmap.data();
+        for (size_t i = 0; i < c2.values.size(); ++i)
+            words[c2.values[i] / BIT_WORD_BITS] |=
+                uint64_t(1) << (c2.values[i] % BIT_WORD_BITS);
+        result.cardinality = uint32_t(__bits_count(
+            words, words + __roaring_rc::BITMAP_WORDS));
+        __roaring_normalize(result);
+    } else {
+        const uint16_t* first1 = c1.values.data();
+        const uint16_t* last1 = first1 + c1.values.size();
+        const uint16_t* first2 = c2.values.data();
+        const uint16_t* last2 = first2 + c2.values.size();
+        result.values.reserve(c1.values.size() + c2.values.size());
+        while (first1 != last1 and first2 != last2) {
+            if (*first1 < *first2) {
+                result.values.push_back(*first1++);
+            } else if (*first2 < *first1) {
+                result.values.push_back(*first2++);
+            } else {
+                result.values.push_back(*first1++);
+                ++first2;
+            }
+        }
+        for (; first1 != last1; ++first1)
+            result.values.push_back(*first1);
+        for (; first2 != last2; ++first2)
+            result.values.push_back(*first2);
+        result.values.shrink_to_fit();
+        result.type = __roaring_rc::ARRAY;
+        result.cardinality = uint32_t(result.values.size());
+    }
+}
+
+// The values of c1 which are not in c2.
+inline void __roaring_andnot(const __roaring_rc& c1, const __roaring_rc& c2,
+                             __roaring_rc& result) {
+    if (c1.type == __roaring_rc::BITMAP and c2.type == __roaring_rc::BITMAP) {
+        __roaring_bitmaps<SIMD_BIT_ANDNOT>(c1, c2, result);
+    } else if (c1.type == __roaring_rc::BITMAP) {
+        result = c1;
+        uint64_t* words = result.bitmap.data();
+        for (size_t i = 0; i < c2.values.size(); ++i) {
+            uint16_t low = c2.values[i];
+            uint64_t mask = uint64_t(1) << (low % BIT_WORD_BITS);
+            result.cardinality -= (words[low / BIT_WORD_BITS] & mask) != 0;
+            words[low / BIT_WORD_BITS] &= ~mask;
+        }
+        __roaring_normalize(result);
+    } else if (c2.type == __roaring_rc::BITMAP) {
+        __roaring_filter_array<false>(c1, c2, result);
+    } else {
+        __roaring_filter_arrays<false>(c1.values, c2.values, result.values);
+        result.type = __roaring_rc::ARRAY;
+        result.cardinality = uint32_t(result.values.size());
+    }
+}
+
+// result = c1 Operation c2, Operation one of SIMD_BIT_AND, SIMD_BIT_OR
+// and SIMD_BIT_ANDNOT. Run containers are expanded first.
+template <int Operation>
+inline void __roaring_apply(const __roaring_rc& c1, const __roaring_rc& c2,
+                            __roaring_rc& result) {
+    __roaring_rc buffer1;
+    __roaring_rc buffer2;
+    const __roaring_rc& plain1 = __roaring_plain(c1, buffer1);
+    const __roaring_rc& plain2 = __roaring_plain(c2, buffer2);
+    switch (Operation) {
+    case SIMD_BIT_AND:
+        __roaring_and(plain1, plain2, result);
+        break;
+    case SIMD_BIT_OR:
+        __roaring_or(plain1, plain2, result);
+        break;
+    default:
+        __roaring_andnot(plain1, plain2, result);
+        break;
+    }
+    result.key = c1.key;
+}
+
+// Little endian writes and reads of the serialized form.
+template <typename Tp>
+inline unsigned char* __roaring_put(unsigned char* out, const Tp* values,
+                                    size_t count) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (count != 0)
+        std::memcpy(out, values, count * sizeof(Tp));
+    return out + count * sizeof(Tp);
+#else
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t byte = 0; byte < sizeof(Tp); ++byte)
+            *out++ = (unsigned char)(uint64_t(values[i]) >> (8 * byte));
+    }
+    return out;
+#endif
+}
+
+template <typename Tp>
+inline const unsigned char* __roaring_get(const unsigned char* in,
+                                          Tp* values, size_t count) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if (count != 0)
+        std::memcpy(values, in, count * sizeof(Tp));
+    return in + count * sizeof(Tp);
+#else
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t value = 0;
+        for (size_t byte = 0; byte < sizeof(Tp); ++byte)
+            value |= uint64_t(*in++) << (8 * byte);
+        values[i] = Tp(value);
+    }
+    return in;
+#endif
+}
+
+}
+
+
+/*
+ * roaring_set: a set of uint32_t, compressed as a Roaring bitmap.
+ * The values are split by their high 16 bits into chunks of 65536, kept
+ * sorted by key in one vector; each chunk is an array, a bitmap or a list
+ * of runs, whichever fits its density (see __roaring_container). Random
+ * 32 bits ids take 2 bytes each in the arrays, plus the unused capacity
+ * the arrays grow into and 72 bytes per chunk: 2.4 to 2.9 bytes per id
+ * for 10 to 40 million ids, 2.1 to 2.5 after shrink_to_fit(). Dense or run
+ * heavy ids take less. A set or hash_set node takes 40 to 60.
+ * Union, intersection and difference go chunk by chunk: two bitmaps are
+ * combined and counted with the SIMD bitwise and popcount kernels, an
+ * array is checked against a bitmap with one bit test per value, two
+ * arrays are merged, or searched when one is far smaller.
+ * serialize() writes the portable Roaring format, which the Roaring
+ * libraries of other languages read.
+ */
+class roaring_set {
+public:
+    typedef uint32_t            key_type;
+    typedef uint32_t            value_type;
+    typedef size_t              size_type;
+    typedef ptrdiff_t           difference_type;
+
+    typedef roaring_set         self;
+
+    class const_iterator;
+    typedef const_iterator      iterator;
+
+protected:
+    typedef __roaring_container container;
+
+    // Sorted by key.
+    vector<container>   containers;
+    size_type           total;
+
+public:
+    roaring_set()
+        :containers(), total(0)
+    {}
+
+    template <typename InputIterator>
+    roaring_set(InputIterator first, InputIterator last)
+        :roaring_set() {
+        for (; first != last; ++first)
+            insert(*first);
+    }
+
+    roaring_set(const std::initializer_list<value_type>& value_list)
+        :roaring_set(value_list.begin(), value_list.end())
+    {}
+
+    size_type size() const {
+        return total;
+    }
+
+    bool empty() const {
+        return total == 0;
+    }
+
+    void clear() {
+        containers.clear();
+        total = 0;
+    }
+
+    // Give back the storage the arrays have grown into and do not use,
+    // up to a quarter of it after the ids have been inserted one by one.
+    void shrink_to_fit() {
+        for (size_type i = 0; i < containers.size(); ++i)
+            containers[i].values.shrink_to_fit();
+        containers.shrink_to_fit();
+    }
+
+    void swap(self& another) {
+        containers.swap(another.containers);
+        STLL_NAMESPACE::swap(total, another.total);
+    }
+
+    // Whether x was not in the set.
+    bool insert(value_type x) {
+        uint16_t key = uint16_t(x >> 16);
+        size_type index = lower_container(key);
+        if (index == containers.size() or containers[index].key != key)
+            insert_container(index, container(key));
+        if (!__roaring_add(containers[index], uint16_t(x)))
+            return false;
+        ++total;
+        return true;
+    }
+
+    size_type erase(value_type x) {
+        uint16_t key = uint16_t(x >> 16);
+        size_type index = lower_container(key);
+        if (index == containers.size() or containers[index].key != key
+            or !__roaring_remove(containers[index], uint16_t(x)))
+            return 0;
+        if (containers[index].cardinality == 0)
+            erase_container(index);
+        --total;
+        return 1;
+    }
+
+    bool contains(value_type x) const {
+        uint16_t key = uint16_t(x >> 16);
+        size_type index = lower_container(key);
+        return index != containers.size() and containers[index].key == key
+               and __roaring_contains(containers[index], uint16_t(x));
+    }
+
+    size_type count(value_type x) const {
+        return contains(x) ? 1 : 0;
+    }
+
+    const_iterator begin() const;
+
+    const_iterator end() const;
+
+    // Call f(x) on every value in order, faster than the iterators.
+    template <typename Function>
+    void for_each(Function f) const {
+        for (size_type i = 0; i < containers.size(); ++i) {
+            uint32_t high = uint32_t(containers[i].key) << 16;
+            auto call = [&f, high](uint32_t low) {
+                f(high | low);
+            };
+            __roaring_for_each(containers[i], call);
+        }
+    }
+
+    self& operator|=(const self& another) {
+        *this = combine<SIMD_BIT_OR>(*this, another);
+        return *this;
+    }
+
+    self& operator&=(const self& another) {
+        *this = combine<SIMD_BIT_AND>(*this, another);
+        return *this;
+    }
+
+    // Remove the values of another.
+    self& operator-=(const self& another) {
+        *this = combine<SIMD_BIT_ANDNOT>(*this, another);
+        return *this;
+    }
+
+    friend self operator|(const self& set1, const self& set2) {
+        return combine<SIMD_BIT_OR>(set1, set2);
+    }
+
+    friend self operator&(const self& set1, const self& set2) {
+        return combine<SIMD_BIT_AND>(set1, set2);
+    }
+
+    friend self operator-(const self& set1, const self& set2) {
+        return combine<SIMD_BIT_ANDNOT>(set1, set2);
+    }
+
+    bool operator==(const self& another) const;
+
+    bool operator!=(const self& another) const {
+        return !(*this == another);
+    }
+
+    /*
+     * Turn the chunks which are smaller as runs into run containers, and
+     * the run containers which are not back into arrays or bitmaps. Worth
+     * it after loading ids which come in ranges; insert and erase expand
+     * the run container they change.
+     */
+    void run_optimize() {
+        for (size_type i = 0; i < containers.size(); ++i) {
+            container& c = containers[i];
+            size_type run_bytes = 2 + 4 * __roaring_run_count(c);
+            size_type plain_bytes = c.cardinality <= container::ARRAY_MAX
+                                    ? 2 * c.cardinality : 8192;
+            if (run_bytes < plain_bytes) {
+                if (c.type != container::RUN)
+                    __roaring_to_runs(c);
+            } else {
+                __roaring_normalize(c);
+            }
+        }
+    }
+
+    // The bytes the set takes, with the unused capacity of its vectors.
+    size_type memory_usage() const {
+        size_type bytes = sizeof(*this)
+                          + containers.capacity() * sizeof(container);
+        for (size_type i = 0; i < containers.size(); ++i) {
+            bytes += containers[i].values.capacity() * sizeof(uint16_t)
+                     + containers[i].bitmap.capacity() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+
+    /*
+     * The portable Roaring format:
+     *   cookie: with runs, 12347 | (containers - 1) << 16 and a bit per
+     *           container telling which are runs; else 12346 and the
+     *           number of containers, 32 bits each.
+     *   a key and a cardinality - 1 per container, 16 bits each.
+     *   without runs or from NO_OFFSET_THRESHOLD containers, the 32 bits
+     *           offset of each container from the start.
+     *   the containers: an array as its values, a bitmap as its 1024
+     *           words, runs as their number then (start, length - 1)
+     *           pairs.
+     * All numbers are little endian.
+     */
+    enum {SERIAL_COOKIE_NO_RUN = 12346};
+    enum {SERIAL_COOKIE = 12347};
+    enum {NO_OFFSET_THRESHOLD = 4};
+
+    size_type serialized_size() const {
+        size_type n = containers.size();
+        bool runs = has_runs();
+        size_type bytes = runs ? 4 + (n + 7) / 8 : 8;
+        bytes += 4 * n;
+        if (!runs or n >= NO_OFFSET_THRESHOLD)
+            bytes += 4 * n;
+        for (size_type i = 0; i < n; ++i)
+            bytes += container_bytes(containers[i]);
+        return bytes;
+    }
+
+    // Write serialized_size() bytes to buffer, return their number.
+    size_type serialize(void* buffer) const {
+        unsigned char* out = static_cast<unsigned char*>(buffer);
+        size_type n = containers.size();
+        bool runs = has_runs();
+        uint32_t header[2];
+        if (runs) {
+            header[0] = SERIAL_COOKIE | uint32_t(n - 1) << 16;
+            out = __roaring_put(out, header, 1);
+            for (size_type i = 0; i < n; i += 8) {
+                unsigned char flags = 0;
+                for (size_type j = i; j < n and j < i + 8; ++j) {
+                    if (containers[j].type == container::RUN)
+                        flags |= (unsigned char)(1 << (j - i));
+                }
+                *out++ = flags;
+            }
+        } else {
+            header[0] = SERIAL_COOKIE_NO_RUN;
+            header[1] = uint32_t(n);
+            out = __roaring_put(out, header, 2);
+        }
+        for (size_type i = 0; i < n; ++i) {
+            uint16_t description[2] = {
+                containers[i].key,
+                uint16_t(containers[i].cardinality - 1)
+            };
+            out = __roaring_put(out, description, 2);
+        }
+        if (!runs or n >= NO_OFFSET_THRESHOLD) {
+            uint32_t offset = uint32_t(out - static_cast<unsigned char*>(
+                                                buffer) + 4 * n);
+            for (size_type i = 0; i < n; ++i) {
+                out = __roaring_put(out, &offset, 1);
+                offset += uint32_t(container_bytes(containers[i]));
+            }
+        }
+        for (size_type i = 0; i < n; ++i) {
+            const container& c = containers[i];
+            if (c.type == container::BITMAP) {
+                out = __roaring_put(out, c.bitmap.data(),
+                                    container::BITMAP_WORDS);
+            } else {
+                if (c.type == container::RUN) {
+                    uint16_t run_count = uint16_t(c.values.size() / 2);
+                    out = __roaring_put(out, &run_count, 1);
+                }
+                out = __roaring_put(out, c.values.data(), c.values.size());
+            }
+        }
+        return out - static_cast<unsigned char*>(buffer);
+    }
+
+    // The set serialize() wrote to buffer; throws std::invalid_argument if
+    // the size bytes from buffer are not one.
+    static self deserialize(const void* buffer, size_type size) {
+        const unsigned char* in = static_cast<const unsigned char*>(buffer);
+        const unsigned char* end = in + size;
+        self result;
+        uint32_t cookie;
+        in = read(in, end, &cookie, 1);
+        size_type n;
+        const unsigned char* run_flags = nullptr;
+        if ((cookie & 0xffff) == SERIAL_COOKIE) {
+            n = (cookie >> 16) + 1;
+            run_flags = in;
+            in = skip(in, end, (n + 7) / 8);
+        } else if (cookie == SERIAL_COOKIE_NO_RUN) {
+            uint32_t count;
+            in = read(in, end, &count, 1);
+            n = count;
+            if (n > 65536)
+                throw std::invalid_argument("roaring_set: bad data");
+        } else {
+            throw std::invalid_argument("roaring_set: bad cookie");
+        }
+        vector<uint16_t> descriptions(2 * n, uint16_t(0));
+        in = read(in, end, descriptions.data(), 2 * n);
+        if (run_flags == nullptr or n >= NO_OFFSET_THRESHOLD)
+            in = skip(in, end, 4 * n);
+
+        result.containers.reserve(n);
+        for (size_type i = 0; i < n; ++i) {
+            container c(descriptions[2 * i]);
+            c.cardinality = uint32_t(descriptions[2 * i + 1]) + 1;
+            if (i != 0 and c.key <= result.containers[i - 1].key)
+                throw std::invalid_argument("roaring_set: bad data");
+            if (run_flags and (run_flags[i / 8] >> (i % 8)) & 1)
+                in = read_runs(in, end, c);
+            else if (c.cardinality > container::ARRAY_MAX)
+                in = read_bitmap(in, end, c);
+            else
+                in = read_array(in, end, c);
+            result.total += c.cardinality;
+            result.containers.emplace_back(STLL_NAMESPACE::move(c));
+        }
+        return result;
+    }
+
+protected:
+    // The index of the first container whose key is not less than key.
+    // Ids are often added in increasing order, so the last container is
+    // tried first.
+    size_type lower_container(uint16_t key) const {
+        size_type size = containers.size();
+        if (size == 0 or containers[size - 1].key < key)
+            return size;
+        if (containers[size - 1].key == key)
+            return size - 1;
+        size_type low = 0;
+        size_type high = size - 1;
+        while (low < high) {
+            size_type middle = low + (high - low) / 2;
+            if (containers[middle].key < key)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        return low;
+    }
+
+    void insert_container(size_type index, container&& c) {
+        containers.emplace_back();
+        for (size_type i = containers.size() - 1; i > index; --i)
+            containers[i] = STLL_NAMESPACE::move(containers[i - 1]);
+        containers[index] = STLL_NAMESPACE::move(c);
+    }
+
+    void erase_container(size_type index) {
+        for (size_type i = index; i + 1 < containers.size(); ++i)
+            containers[i] = STLL_NAMESPACE::move(containers[i + 1]);
+        containers.pop_back();
+    }
+
+    void append_container(container&& c) {
+        total += c.cardinality;
+        containers.emplace_back(STLL_NAMESPACE::move(c));
+    }
+
+    // Walk the keys of both sets, as in a merge. Operation is one of
+    // SIMD_BIT_AND, SIMD_BIT_OR and SIMD_BIT_ANDNOT.
+    template <int Operation>
+    static self combine(const self& set1, const self& set2) {
+        self result;
+        size_type i = 0;
+        size_type j = 0;
+        size_type size1 = set1.containers.size();
+        size_type size2 = set2.containers.size();
+        while (i < size1 and j < size2) {
+            const container& c1 = set1.containers[i];
+            const container& c2 = set2.containers[j];
+            if (c1.key < c2.key) {
+                if (Operation != SIMD_BIT_AND)
+                    result.append_container(container(c1));
+                ++i;
+            } else if (c2.key < c1.key) {
+                if (Operation == SIMD_BIT_OR)
+                    result.append_container(container(c2));
+                ++j;
+            } else {
+                container c;
+                __roaring_apply<Operation>(c1, c2, c);
+                if (c.cardinality != 0)
+                    result.append_container(STLL_NAMESPACE::move(c));
+                ++i;
+                ++j;
+            }
+        }
+        for (; Operation != SIMD_BIT_AND and i < size1; ++i)
+            result.append_container(container(set1.containers[i]));
+        for (; Operation == SIMD_BIT_OR and j < size2; ++j)
+            result.append_container(container(set2.containers[j]));
+        return result;
+    }
+
+    bool has_runs() const {
+        for (size_type i = 0; i < containers.size(); ++i) {
+            if (containers[i].type == container::RUN)
+                return true;
+        }
+        return false;
+    }
+
+    static size_type container_bytes(const container& c) {
+        if (c.type == container::BITMAP)
+            return 8 * container::BITMAP_WORDS;
+        if (c.type == container::RUN)
+            return 2 + 2 * c.values.size();
+        return 2 * c.values.size();
+    }
+
+    static const unsigned char* skip(const unsigned char* in,
+                                     const unsigned char* end,
+                                     size_type bytes) {
+        if (size_type(end - in) < bytes)
+            throw std::invalid_argument("roaring_set: truncated data");
+        return in + bytes;
+    }
+
+    template <typename Tp>
+    static const unsigned char* read(const unsigned char* in,
+                                     const unsigned char* end,
+                                     Tp* values, size_type count) {
+        skip(in, end, count * sizeof(Tp));
+        return __roaring_get(in, values, count);
+    }
+
+    static const unsigned char* read_array(const unsigned char* in,
+                                           const unsigned char* end,
+                                           container& c) {
+        c.values = vector<uint16_t>(size_t(c.cardinality), uint16_t(0));
+        in = read(in, end, c.values.data(), c.cardinality);
+        for (size_type i = 1; i < c.values.size(); ++i) {
+            if (c.values[i] <= c.values[i - 1])
+                throw std::invalid_argument("roaring_set: bad data");
+        }
+        c.type = container::ARRAY;
+        return in;
+    }
+
+    static const unsigned char* read_bitmap(const unsigned char* in,
+                                            const unsigned char* end,
+                                            container& c) {
+        c.bitmap = vector<uint64_t>(size_t(container::BITMAP_WORDS),
+                                    uint64_t(0));
+        uint64_t* words = c.bitmap.data();
+        in = read(in, end, words, container::BITMAP_WORDS);
+        if (__bits_count(words, words + container::BITMAP_WORDS)
+            != c.cardinality)
+            throw std::invalid_argument("roaring_set: bad data");
+        c.type = container::BITMAP;
+        return in;
+    }
+
+    static const unsigned char* read_runs(const unsigned char* in,
+                                          const unsigned char* end,
+                                          container& c) {
+        uint16_t run_count;
+        in = read(in, end, &run_count, 1);
+        c.values = vector<uint16_t>(2 * size_t(run_count), uint16_t(0));
+        in = read(in, end, c.values.data(), 2 * size_t(run_count));
+        uint32_t cardinality = 0;
+        for (size_type i = 0; i < c.values.size(); i += 2) {
+            uint32_t last = uint32_t(c.values[i]) + c.values[i + 1];
+            if (last > 0xffff
+                or (i != 0 and c.values[i]
+                               <= uint32_t(c.values[i - 2]) + c.values[i - 1]))
+                throw std::invalid_argument("roaring_set: bad data");
+            cardinality += c.values[i + 1] + 1;
+        }
+        if (cardinality != c.cardinality)
+            throw std::invalid_argument("roaring_set: bad data");
+        c.type = container::RUN;
+        return in;
+    }
+};
+
+
+/*
+ * const_iterator: the values of a roaring_set in increasing order. It
+ * keeps the container, the position in it (an index in an array, a bit
+ * in a bitmap, a run in a run container) and the value there.
+ */
+class roaring_set::const_iterator {
+public:
+    typedef forward_iterator_tag    iterator_category;
+    typedef uint32_t                value_type;
+    typedef const uint32_t*         pointer;
+    typedef uint32_t                reference;
+    typedef ptrdiff_t               difference_type;
+
+    typedef const_iterator          self;
+
+protected:
+    const vector<container>*    containers;
+    size_type                   index;
+    size_type                   pos;
+    uint32_t                    value;
+
+public:
+    const_iterator()
+        :containers(nullptr), index(0), pos(0), value(0)
+    {}
+
+    // The first value of the container index, or the end.
+    const_iterator(const vector<container>* containers, size_type index)
+        :containers(containers), index(index), pos(0), value(0) {
+        load();
+    }
+
+    uint32_t operator*() const {
+        return value;
+    }
+
+    self& operator++() {
+        const container& c = (*containers)[index];
+        const uint16_t* values = c.values.data();
+        uint32_t high = value & 0xffff0000u;
+        switch (c.type) {
+        case container::ARRAY:
+            if (++pos < c.values.size()) {
+                value = high | values[pos];
+                return *this;
+            }
+            break;
+        case container::BITMAP:
+            pos = __bits_find(c.bitmap.data(), container::BITMAP_WORDS,
+                              pos + 1);
+            if (pos != size_type(-1)) {
+                value = high | uint32_t(pos);
+                return *this;
+            }
+            break;
+        default:
+            if ((value & 0xffff) < uint32_t(values[2 * pos])
+                                   + values[2 * pos + 1]) {
+                ++value;
+                return *this;
+            }
+            if (++pos < c.values.size() / 2) {
+                value = high | values[2 * pos];
+                return *this;
+            }
+            break;
+        }
+        ++index;
+        pos = 0;
+        load();
+        return *this;
+    }
+
+    self operator++(int) {
+        self result = *this;
+        ++*this;
+        return result;
+    }
+
+    bool operator==(const self& another) const {
+        return index == another.index and value == another.value;
+    }
+
+    bool operator!=(const self& another) const {
+        return !(*this == another);
+    }
+
+protected:
+    void load() {
+        if (index == containers->size()) {
+            value = 0;
+            return;
+        }
+        const container& c = (*containers)[index];
+        uint32_t high = uint32_t(c.key) << 16;
+        if (c.type == container::BITMAP) {
+            pos = __bits_find(c.bitmap.data(), container::BITMAP_WORDS, 0);
+            value = high | uint32_t(pos);
+        } else {
+            value = high | c.values[0];
+        }
+    }
+};
+
+inline roaring_set::const_iterator roaring_set::begin() const {
+    return const_iterator(&containers, 0);
+}
+
+inline roaring_set::const_iterator roaring_set::end() const {
+    return const_iterator(&containers, containers.size());
+}
+
+inline bool roaring_set::operator==(const self& another) const {
+    if (total != another.total
+        or containers.size() != another.containers.size())
+        return false;
+    for (const_iterator iter1 = begin(), iter2 = another.begin();
+         iter1 != end(); ++iter1, ++iter2) {
+        if (*iter1 != *iter2)
+            return false;
+    }
+    return true;
+}
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // ROARING_SET_HPP
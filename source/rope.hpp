@@ -0,0 +1,687 @@
+#ifndef ROPE_HPP
+#define ROPE_HPP
+
+#include <atomic>
+#include <stdexcept>
+
+#include "base.hpp"
+#include "algorithm.hpp"
+#include "allocator.hpp"
+#include "iterator.hpp"
+#include "span.hpp"
+#include "string.hpp"
+#include "string_view.hpp"
+#include "utility.hpp"
+
+__STLL_NAMESPACE_START__
+
+/*
+ * rope_node: a leaf holds size characters, stored right after the node,
+ * in room for capacity of them; a concat node holds no character and
+ * stands for left followed by right. A node may be shared by several
+ * ropes and is only changed in place while its refcount is 1.
+ */
+template <typename CharT>
+struct rope_node {
+    std::atomic<size_t>     refcount;
+    size_t                  size;
+    size_t                  capacity;
+    int                     height;     // 0 for a leaf
+    rope_node*              left;
+    rope_node*              right;
+
+    bool is_leaf() const {
+        return height == 0;
+    }
+
+    CharT* chars() {
+        return reinterpret_cast<CharT*>(this + 1);
+    }
+
+    const CharT* chars() const {
+        return reinterpret_cast<const CharT*>(this + 1);
+    }
+};
+
+
+/*
+ * rope: a string kept as an AVL tree of chunks of at most LEAF_CAPACITY
+ * characters, for big texts which are edited in the middle.
+ * insert, erase, substr and concatenation split and join trees along a
+ * path, in O(log n) node allocations and without touching the characters
+ * of other chunks; a contiguous string moves its whole tail instead.
+ * Copies share the tree: a copy is a snapshot which costs one reference
+ * count increment, later edits of either rope copy only the nodes on
+ * their path. A rope which owns its right spine alone appends in place,
+ * so a loop of push_back() fills the last chunk without copying it.
+ * for_each_chunk() visits the chunks as spans, e.g. to fill the iovec of
+ * writev() with no copy.
+ * Nodes may outlive the rope which made them, so Alloc is used through a
+ * default constructed instance.
+ */
+template <typename CharT, typename Alloc=allocator<CharT>>
+class rope {
+public:
+    typedef CharT               value_type;
+    typedef size_t              size_type;
+    typedef ptrdiff_t           difference_type;
+    typedef CharT               const_reference;
+
+    typedef rope_node<CharT>            node;
+    typedef basic_string_view<CharT>    view_type;
+    typedef rope<CharT, Alloc>          self;
+
+    typedef typename Alloc::template rebind<node>::other node_allocator;
+
+    static const size_type npos = size_type(-1);
+
+    enum {LEAF_BYTES = 512};
+    enum {LEAF_CAPACITY = LEAF_BYTES / sizeof(CharT)};
+
+    class const_iterator;
+
+protected:
+    node*   root;
+
+public:
+    rope()
+        :root(nullptr)
+    {}
+
+    rope(view_type text)
+        :root(build(text.data(), text.size()))
+    {}
+
+    rope(const CharT* s)
+        :root(nullptr) {
+        view_type text(s);
+        root = build(text.data(), text.size());
+    }
+
+    rope(const CharT* s, size_type n)
+        :root(build(s, n))
+    {}
+
+    // A snapshot: the tree is shared.
+    rope(const self& another)
+        :root(ref(another.root))
+    {}
+
+    rope(self&& another)
+        :root(another.root) {
+        another.root = nullptr;
+    }
+
+    ~rope() {
+        unref(root);
+    }
+
+    self& operator=(const self& another) {
+        node* old = root;
+        root = ref(another.root);
+        unref(old);
+        return *this;
+    }
+
+    self& operator=(self&& another) {
+        if (this != &another) {
+            unref(root);
+            root = another.root;
+            another.root = nullptr;
+        }
+        return *this;
+    }
+
+    void swap(self& another) {
+        STLL_NAMESPACE::swap(root, another.root);
+    }
+
+    size_type size() const {
+        return root ? root->size : 0;
+    }
+
+    size_type length() const {
+        return size();
+    }
+
+    bool empty() const {
+        return root == nullptr;
+    }
+
+    // The height of the tree, a leaf is 0.
+    int height() const {
+        return root ? root->height : 0;
+    }
+
+    CharT operator[](size_type index) const {
+        size_type first;
+        const node* leaf = find_leaf(root, index, first);
+        return leaf->chars()[index - first];
+    }
+
+    CharT at(size_type index) const {
+        if (index >= size())
+            throw std::range_error("index out of range");
+        return (*this)[index];
+    }
+
+    void clear() {
+        unref(root);
+        root = nullptr;
+    }
+
+    self& append(view_type text) {
+        root = join(root, build(text.data(), text.size()));
+        return *this;
+    }
+
+    self& append(const CharT* s) {
+        return append(view_type(s));
+    }
+
+    self& append(const self& another) {
+        root = join(root, ref(another.root));
+        return *this;
+    }
+
+    // In place when this rope alone holds the right spine and its last
+    // chunk has room: no node is allocated and no character moved.
+    void push_back(CharT c) {
+        node* last = root;
+        while (last and unique(last) and !last->is_leaf())
+            last = last->right;
+        if (last == nullptr or !unique(last) or last->size == last->capacity) {
+            root = join(root, new_leaf(&c, 1, 1));
+            return;
+        }
+        last->chars()[last->size] = c;
+        for (node* n = root; n != last; n = n->right)
+            ++n->size;
+        ++last->size;
+    }
+
+    self& operator+=(view_type text) {
+        return append(text);
+    }
+
+    self& operator+=(const CharT* s) {
+        return append(view_type(s));
+    }
+
+    self& operator+=(const self& another) {
+        return append(another);
+    }
+
+    self& operator+=(CharT c) {
+        push_back(c);
+        return *this;
+    }
+
+    self& insert(size_type pos, view_type text) {
+        return insert_node(pos, build(text.data(), text.size()));
+    }
+
+    self& insert(size_type pos, const CharT* s) {
+        return insert(pos, view_type(s));
+    }
+
+    self& insert(size_type pos, const self& another) {
+        return insert_node(pos, ref(another.root));
+    }
+
+    self& erase(size_type pos, size_type n=npos) {
+        if (pos > size())
+            throw std::range_error("index out of range");
+        n = min(n, size() - pos);
+        node* left;
+        node* rest;
+        node* middle;
+        node* right;
+        split(root, pos, left, rest);
+        split(rest, n, middle, right);
+        unref(middle);
+        root = join(left, right);
+        return *this;
+    }
+
+    // Shares the chunks inside [pos, pos + n), copies at most the two
+    // chunks at its ends.
+    self substr(size_type pos, size_type n=npos) const {
+        if (pos > size())
+            throw std::range_error("index out of range");
+        n = min(n, size() - pos);
+        node* left;
+        node* rest;
+        node* middle;
+        node* right;
+        split(ref(root), pos, left, rest);
+        split(rest, n, middle, right);
+        unref(left);
+        unref(right);
+        self result;
+        result.root = middle;
+        return result;
+    }
+
+    // Call f(span<const CharT>) on every chunk, front to back.
+    template <typename Function>
+    void for_each_chunk(Function f) const {
+        visit_chunks(root, f);
+    }
+
+    basic_string<CharT> str() const {
+        basic_string<CharT> result;
+        result.reserve(size());
+        for_each_chunk([&result](span<const CharT> chunk) {
+            result.append(chunk.data(), chunk.size());
+        });
+        return result;
+    }
+
+    const_iterator begin() const {
+        return const_iterator(root, 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(root, size());
+    }
+
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    const_iterator cend() const {
+        return end();
+    }
+
+    /*
+     * A random access iterator over the characters. It remembers the
+     * chunk of its position and only walks down the tree again when it
+     * leaves that chunk. An edit of the rope invalidates it.
+     */
+    class const_iterator {
+    public:
+        typedef random_access_iterator_tag  iterator_category;
+        typedef CharT                       value_type;
+        typedef const CharT*                pointer;
+        typedef const CharT&                reference;
+        typedef size_t                      size_type;
+        typedef ptrdiff_t                   difference_type;
+
+        typedef const_iterator              self;
+
+    protected:
+        const node*             root;
+        size_type               pos;
+        mutable const CharT*    chunk;
+        mutable size_type       chunk_first;
+        mutable size_type       chunk_last;
+
+    public:
+        const_iterator()
+            :root(nullptr), pos(0), chunk(nullptr), chunk_first(0)
+            ,chunk_last(0)
+        {}
+
+        const_iterator(const node* root, size_type pos)
+            :root(root), pos(pos), chunk(nullptr), chunk_first(0)
+            ,chunk_last(0)
+        {}
+
+        reference operator*() const {
+            if (pos < chunk_first or pos >= chunk_last) {
+                const node* leaf = find_leaf(root, pos, chunk_first);
+                chunk = leaf->chars();
+                chunk_last = chunk_first + leaf->size;
+            }
+            return chunk[pos - chunk_first];
+        }
+
+        reference operator[](difference_type n) const {
+            return *(*this + n);
+        }
+
+        self& operator++() {
+            ++pos;
+            return *this;
+        }
+
+        self operator++(int) {
+            self tmp = *this;
+            ++pos;
+            return tmp;
+        }
+
+        self& operator--() {
+            --pos;
+            return *this;
+        }
+
+        self operator--(int) {
+            self tmp = *this;
+            --pos;
+            return tmp;
+        }
+
+        self& operator+=(difference_type n) {
+            pos += n;
+            return *this;
+        }
+
+        self& operator-=(difference_type n) {
+            pos -= n;
+            return *this;
+        }
+
+        self operator+(difference_type n) const {
+            self tmp = *this;
+            return tmp += n;
+        }
+
+        self operator-(difference_type n) const {
+            self tmp = *this;
+            return tmp -= n;
+        }
+
+        difference_type operator-(const self& iter) const {
+            return difference_type(pos - iter.pos);
+        }
+
+        bool operator==(const self& iter) const {
+            return pos == iter.pos;
+        }
+
+        bool operator!=(const self& iter) const {
+            return pos != iter.pos;
+        }
+
+        bool operator<(const self& iter) const {
+            return pos < iter.pos;
+        }
+
+        bool operator>(const self& iter) const {
+            return pos > iter.pos;
+        }
+
+        bool operator<=(const self& iter) const {
+            return pos <= iter.pos;
+        }
+
+        bool operator>=(const self& iter) const {
+            return pos >= iter.pos;
+        }
+    };
+
+protected:
+    self& insert_node(size_type pos, node* middle) {
+        if (pos > size()) {
+            unref(middle);
+            throw std::range_error("index out of range");
+        }
+        node* left;
+        node* right;
+        split(root, pos, left, right);
+        root = join(join(left, middle), right);
+        return *this;
+    }
+
+    // Node allocation: a leaf takes enough nodes to hold its characters.
+    static size_type leaf_nodes(size_type capacity) {
+        return 1 + (capacity * sizeof(CharT) + sizeof(node) - 1)
+                   / sizeof(node);
+    }
+
+    static node* new_leaf(const CharT* s, size_type n, size_type capacity) {
+        node* leaf = node_allocator().allocate(leaf_nodes(capacity));
+        new (&leaf->refcount) std::atomic<size_t>(1);
+        leaf->size = n;
+        leaf->capacity = capacity;
+        leaf->height = 0;
+        leaf->left = leaf->right = nullptr;
+        char_traits<CharT>::copy(leaf->chars(), s, n);
+        return leaf;
+    }
+
+    // Takes over the references of left and right.
+    static node* make_concat(node* left, node* right) {
+        node* concat = node_allocator().allocate(1);
+        new (&concat->refcount) std::atomic<size_t>(1);
+        concat->size = left->size + right->size;
+        concat->capacity = 0;
+        concat->height = 1 + max(left->height, right->height);
+        concat->left = left;
+        concat->right = right;
+        return concat;
+    }
+
+    static void free_node(node* n) {
+        if (n->is_leaf())
+            node_allocator().deallocate(n, leaf_nodes(n->capacity));
+        else
+            node_allocator().deallocate(n, 1);
+    }
+
+    static node* ref(node* n) {
+        if (n)
+            n->refcount.fetch_add(1, std::memory_order_relaxed);
+        return n;
+    }
+
+    static void unref(node* n) {
+        if (n == nullptr
+            or n->refcount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        if (!n->is_leaf()) {
+            unref(n->left);
+            unref(n->right);
+        }
+        free_node(n);
+    }
+
+    static bool unique(const node* n) {
+        return n->refcount.load(std::memory_order_acquire) == 1;
+    }
+
+    /*
+     * Give up the reference to the concat node n for references to its
+     * children. A node nobody else holds is freed and its children are
+     * taken over as they are, so they may stay unique too.
+     */
+    static void detach(node* n, node*& left, node*& right) {
+        left = n->left;
+        right = n->right;
+        if (unique(n)) {
+            free_node(n);
+            return;
+        }
+        ref(left);
+        ref(right);
+        unref(n);
+    }
+
+    // A balanced tree of full chunks over s[0, n).
+    static node* build(const CharT* s, size_type n) {
+        if (n == 0)
+            return nullptr;
+        size_type leaves = (n + LEAF_CAPACITY - 1) / LEAF_CAPACITY;
+        if (leaves == 1)
+            return new_leaf(s, n, n);
+        size_type left_size = leaves / 2 * size_type(LEAF_CAPACITY);
+        return make_concat(build(s, left_size),
+                           build(s + left_size, n - left_size));
+    }
+
+    // a followed by b, two leaves which fit in one chunk.
+    static node* merge_leaves(node* a, node* b) {
+        size_type total = a->size + b->size;
+        if (unique(a) and total <= a->capacity) {
+            char_traits<CharT>::copy(a->chars() + a->size, b->chars(),
+                                     b->size);
+            a->size = total;
+            unref(b);
+            return a;
+        }
+        // Leave room to grow, for the next push_back.
+        size_type capacity = min(size_type(LEAF_CAPACITY),
+                                 max(total, 2 * a->size));
+        node* leaf = new_leaf(a->chars(), a->size, capacity);
+        char_traits<CharT>::copy(leaf->chars() + a->size, b->chars(),
+                                 b->size);
+        leaf->size = total;
+        unref(a);
+        unref(b);
+        return leaf;
+    }
+
+    // The concat of left and right, whose heights differ by 2 at most,
+    // rotated back to a difference of 1 at most.
+    static node* balance(node* left, node* right) {
+        node* a;
+        node* b;
+        node* c;
+        node* d;
+        if (left->height > right->height + 1) {
+            detach(left, a, b);
+            if (a->height >= b->height)
+                return make_concat(a, make_concat(b, right));
+            detach(b, c, d);
+            return make_concat(make_concat(a, c), make_concat(d, right));
+        }
+        if (right->height > left->height + 1) {
+            detach(right, a, b);
+            if (b->height >= a->height)
+                return make_concat(make_concat(left, a), b);
+            detach(a, c, d);
+            return make_concat(make_concat(left, c), make_concat(d, b));
+        }
+        return make_concat(left, right);
+    }
+
+    /*
+     * a followed by b, taking over both references. The taller tree is
+     * walked down on the side of the shorter one until the heights are
+     * close, as in the join of AVL trees; a leaf is always walked down to,
+     * so that two small chunks which meet are merged into one.
+     */
+    static node* join(node* a, node* b) {
+        if (a == nullptr)
+            return b;
+        if (b == nullptr)
+            return a;
+        node* left;
+        node* right;
+        if (a->is_leaf() and b->is_leaf()) {
+            if (a->size + b->size <= size_type(LEAF_CAPACITY))
+                return merge_leaves(a, b);
+            return make_concat(a, b);
+        }
+        if (a->height > b->height + 1 or b->is_leaf()) {
+            detach(a, left, right);
+            return balance(left, join(right, b));
+        }
+        if (b->height > a->height + 1 or a->is_leaf()) {
+            detach(b, left, right);
+            return balance(join(a, left), right);
+        }
+        return make_concat(a, b);
+    }
+
+    // n cut at pos into left and right, taking over the reference to n.
+    static void split(node* n, size_type pos, node*& left, node*& right) {
+        if (n == nullptr or pos == 0) {
+            left = nullptr;
+            right = n;
+            return;
+        }
+        if (pos >= n->size) {
+            left = n;
+            right = nullptr;
+            return;
+        }
+        if (n->is_leaf()) {
+            right = new_leaf(n->chars() + pos, n->size - pos, n->size - pos);
+            if (unique(n)) {
+                n->size = pos;
+                left = n;
+            } else {
+                left = new_leaf(n->chars(), pos, pos);
+                unref(n);
+            }
+            return;
+        }
+        node* a;
+        node* b;
+        node* middle;
+        detach(n, a, b);
+        if (pos < a->size) {
+            split(a, pos, left, middle);
+            right = join(middle, b);
+        } else if (pos > a->size) {
+            split(b, pos - a->size, middle, right);
+            left = join(a, middle);
+        } else {
+            left = a;
+            right = b;
+        }
+    }
+
+    // The leaf holding position pos, first is its first position.
+    static const node* find_leaf(const node* n, size_type pos,
+                                 size_type& first) {
+        first = 0;
+        while (!n->is_leaf()) {
+            if (pos < n->left->size) {
+                n = n->left;
+            } else {
+                pos -= n->left->size;
+                first += n->left->size;
+                n = n->right;
+            }
+        }
+        return n;
+    }
+
+    template <typename Function>
+    static void visit_chunks(const node* n, Function& f) {
+        if (n == nullptr)
+            return;
+        if (n->is_leaf()) {
+            f(span<const CharT>(n->chars(), n->size));
+            return;
+        }
+        visit_chunks(n->left, f);
+        visit_chunks(n->right, f);
+    }
+};
+
+template <typename CharT, typename Alloc>
+const typename rope<CharT, Alloc>::size_type rope<CharT, Alloc>::npos;
+
+
+template <typename CharT, typename Alloc>
+inline rope<CharT, Alloc> operator+(const rope<CharT, Alloc>& lhs,
+                                    const rope<CharT, Alloc>& rhs) {
+    rope<CharT, Alloc> result(lhs);
+    return STLL_NAMESPACE::move(result.append(rhs));
+}
+
+template <typename CharT, typename Alloc>
+inline bool operator==(const rope<CharT, Alloc>& lhs,
+                       const rope<CharT, Alloc>& rhs) {
+    return lhs.size() == rhs.size()
+           and STLL_NAMESPACE::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <typename CharT, typename Alloc>
+inline bool operator!=(const rope<CharT, Alloc>& lhs,
+                       const rope<CharT, Alloc>& rhs) {
+    return !(lhs == rhs);
+}
+
+
+typedef rope<char>      crope;
+typedef rope<wchar_t>   wrope;
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // ROPE_HPP
@@ -34,8 +34,8 @@ public:
 public:
     set() = default;
 
-    set(const Compare& comp)
-           :tree(comp)
+    set(const Compare& comp, const Alloc& allocator=Alloc())
+           :tree(comp, allocator)
     {}
 
     set(const self&) = default;
@@ -0,0 +1,918 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#include "base.hpp"
+#include "type_traits.hpp"
+
+/*
+ * SIMD kernels of the algorithms on contiguous ranges of arithmetic types.
+ * They are written once with the vector extension of GCC and clang, and
+ * compiled for 128 bits vectors, AVX2 and AVX-512. The widest one the CPU
+ * supports is picked at run time, so a binary built for plain x86-64 still
+ * runs the AVX-512 kernels where it can. Other compilers get no kernels and
+ * the algorithms keep their plain loops.
+ * STLL_SIMD_MAX_LEVEL caps the level, e.g. to SIMD_AVX2 where AVX-512
+ * lowers the clock more than it gains.
+ */
+#if defined(__GNUC__)
+#define __STLL_SIMD__
+#define __STLL_SIMD_INLINE inline __attribute__((always_inline))
+#if defined(__x86_64__)
+#define __STLL_SIMD_X86__
+#endif
+#endif
+
+__STLL_NAMESPACE_START__
+
+enum {
+    SIMD_SCALAR = 0,
+    SIMD_128    = 1,
+    SIMD_AVX2   = 2,
+    SIMD_AVX512 = 3
+};
+
+// The operations of the bitwise kernel: a & b, a | b, a ^ b, a & ~b.
+enum {
+    SIMD_BIT_AND    = 0,
+    SIMD_BIT_OR     = 1,
+    SIMD_BIT_XOR    = 2,
+    SIMD_BIT_ANDNOT = 3
+};
+
+#ifndef STLL_SIMD_MAX_LEVEL
+#define STLL_SIMD_MAX_LEVEL SIMD_AVX512
+#endif
+
+/*
+ * vectorizable: the kernels handle Tp.
+ * integral: Tp is an integer type. A sum of integers does not depend on the
+ * order of its terms, they wrap around, so accumulate may use several
+ * accumulators; and integers are equal when their bytes are, so ranges of
+ * them compare with memcmp. Neither holds for the floating point types.
+ * associative: the same as integral, for the sums.
+ */
+template <typename Tp>
+struct simd_traits {
+    typedef false_type      vectorizable;
+    typedef false_type      integral;
+    typedef false_type      associative;
+};
+
+template <typename Tp>
+struct simd_traits<const Tp> : public simd_traits<Tp> {};
+
+#ifdef __STLL_SIMD__
+#define __STLL_SIMD_TYPE(Tp, is_integral)           \
+    template <>                                     \
+    struct simd_traits<Tp> {                        \
+        typedef true_type       vectorizable;       \
+        typedef is_integral     integral;           \
+        typedef is_integral     associative;        \
+    };
+
+__STLL_SIMD_TYPE(char, true_type)
+__STLL_SIMD_TYPE(signed char, true_type)
+__STLL_SIMD_TYPE(unsigned char, true_type)
+__STLL_SIMD_TYPE(wchar_t, true_type)
+__STLL_SIMD_TYPE(char16_t, true_type)
+__STLL_SIMD_TYPE(char32_t, true_type)
+__STLL_SIMD_TYPE(short, true_type)
+__STLL_SIMD_TYPE(unsigned short, true_type)
+__STLL_SIMD_TYPE(int, true_type)
+__STLL_SIMD_TYPE(unsigned int, true_type)
+__STLL_SIMD_TYPE(long, true_type)
+__STLL_SIMD_TYPE(unsigned long, true_type)
+__STLL_SIMD_TYPE(long long, true_type)
+__STLL_SIMD_TYPE(unsigned long long, true_type)
+__STLL_SIMD_TYPE(float, false_type)
+__STLL_SIMD_TYPE(double, false_type)
+
+#undef __STLL_SIMD_TYPE
+#endif
+
+// simd_iterator_traits: whether Iterator points into contiguous memory of
+// a type the kernels handle.
+template <typename Iterator>
+struct simd_iterator_traits {
+    typedef false_type      vectorizable;
+};
+
+template <typename Tp>
+struct simd_iterator_traits<Tp*> {
+    typedef typename simd_traits<Tp>::vectorizable vectorizable;
+};
+
+/*
+ * simd_reduce_traits: the traits of a reduction of ranges of Value1 and
+ * Value2 into a Tp, or of a search of a Tp in them. Only ranges of Tp
+ * itself are vectorized: a conversion of every element would cost what the
+ * kernel saves, and a conversion of the Tp could change what it equals.
+ */
+template <typename Value1, typename Tp, typename Value2 = Tp>
+struct simd_reduce_traits {
+    typedef false_type      vectorizable;
+    typedef false_type      integral;
+    typedef false_type      associative;
+};
+
+template <typename Tp>
+struct simd_reduce_traits<Tp, Tp, Tp> : public simd_traits<Tp> {};
+
+template <typename Tp>
+struct simd_reduce_traits<const Tp, Tp, Tp> : public simd_traits<Tp> {};
+
+template <typename Tp>
+struct simd_reduce_traits<Tp, Tp, const Tp> : public simd_traits<Tp> {};
+
+template <typename Tp>
+struct simd_reduce_traits<const Tp, Tp, const Tp>
+    : public simd_traits<Tp> {};
+
+/*
+ * simd_compare_traits: the traits of an element by element comparison of
+ * the ranges of Iterator1 and Iterator2, vectorized when both are pointers
+ * to the same type.
+ */
+template <typename Iterator1, typename Iterator2>
+struct simd_compare_traits {
+    typedef false_type      vectorizable;
+    typedef false_type      integral;
+};
+
+template <typename Tp>
+struct simd_compare_traits<Tp*, Tp*> : public simd_traits<Tp> {};
+
+template <typename Tp>
+struct simd_compare_traits<const Tp*, Tp*> : public simd_traits<Tp> {};
+
+template <typename Tp>
+struct simd_compare_traits<Tp*, const Tp*> : public simd_traits<Tp> {};
+
+template <typename Tp>
+struct simd_compare_traits<const Tp*, const Tp*> : public simd_traits<Tp> {};
+
+namespace
+{
+
+inline int __simd_cpu_level() {
+#if defined(__STLL_SIMD_X86__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")
+        and __builtin_cpu_supports("avx512dq")
+        and __builtin_cpu_supports("avx512bw")
+        and __builtin_cpu_supports("avx512vl"))
+        return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return SIMD_AVX2;
+    return SIMD_128;
+#elif defined(__STLL_SIMD__)
+    return SIMD_128;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+}
+
+// The kernels the algorithms run on this CPU, one of SIMD_*.
+inline int simd_level() {
+    static const int cpu_level = __simd_cpu_level();
+    return cpu_level < STLL_SIMD_MAX_LEVEL ? cpu_level : STLL_SIMD_MAX_LEVEL;
+}
+
+#ifdef __STLL_SIMD__
+
+namespace
+{
+
+/*
+ * The kernels, for vectors of Bytes bytes. They are always inlined into the
+ * functions of __simd_isa below, which compile them for one instruction set.
+ * Loads are unaligned, a range may start anywhere. Vectors are passed by
+ * reference, a vector argument would depend on the instruction set.
+ */
+
+// Whether a lane of a comparison result is set.
+template <size_t Bytes, typename Mask>
+__STLL_SIMD_INLINE bool __simd_any(const Mask& mask) {
+    uint64_t words[Bytes / 8];
+    __builtin_memcpy(words, &mask, Bytes);
+    uint64_t any = 0;
+    for (size_t i = 0; i < Bytes / 8; ++i)
+        any |= words[i];
+    return any != 0;
+}
+
+/*
+ * The index of the first set lane of a comparison result, or Bytes /
+ * sizeof(Tp) if there is none: the movemask of SSE, written for any
+ * vector. On a little endian machine lane i starts at bit i * 8 *
+ * sizeof(Tp) of the words.
+ */
+template <size_t Bytes, typename Tp, typename Mask>
+__STLL_SIMD_INLINE ptrdiff_t __simd_first_lane(const Mask& mask) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t words[Bytes / 8];
+    __builtin_memcpy(words, &mask, Bytes);
+    for (size_t i = 0; i < Bytes / 8; ++i) {
+        if (words[i] != 0)
+            return (i * 64 + __builtin_ctzll(words[i])) / (8 * sizeof(Tp));
+    }
+#else
+    for (ptrdiff_t lane = 0; lane < ptrdiff_t(Bytes / sizeof(Tp)); ++lane) {
+        if (mask[lane])
+            return lane;
+    }
+#endif
+    return Bytes / sizeof(Tp);
+}
+
+// a + b. It wraps around for the integers: the partial sums of a kernel are
+// not those of a sequential loop, one may overflow where the loop does not.
+template <typename Tp>
+__STLL_SIMD_INLINE Tp __simd_add(Tp a, Tp b, true_type) {
+    Tp sum;
+    __builtin_add_overflow(a, b, &sum);
+    return sum;
+}
+
+template <typename Tp>
+__STLL_SIMD_INLINE Tp __simd_add(Tp a, Tp b, false_type) {
+    return a + b;
+}
+
+template <typename Tp>
+__STLL_SIMD_INLINE Tp __simd_mul(Tp a, Tp b, true_type) {
+    Tp product;
+    __builtin_mul_overflow(a, b, &product);
+    return product;
+}
+
+template <typename Tp>
+__STLL_SIMD_INLINE Tp __simd_mul(Tp a, Tp b, false_type) {
+    return a * b;
+}
+
+template <size_t Size>
+struct __simd_unsigned {};
+
+template <>
+struct __simd_unsigned<1> { typedef uint8_t type; };
+
+template <>
+struct __simd_unsigned<2> { typedef uint16_t type; };
+
+template <>
+struct __simd_unsigned<4> { typedef uint32_t type; };
+
+template <>
+struct __simd_unsigned<8> { typedef uint64_t type; };
+
+// The type of the lanes the kernels add and multiply Tp in: the unsigned
+// integer of its width for the integers, where a signed lane would
+// overflow, and Tp itself for the floating point types.
+template <typename Tp, typename Integral = typename simd_traits<Tp>::integral>
+struct __simd_lane {
+    typedef Tp type;
+};
+
+template <typename Tp>
+struct __simd_lane<Tp, true_type> {
+    typedef typename __simd_unsigned<sizeof(Tp)>::type type;
+};
+
+// init plus the sum of [first, last), with four accumulators to hide the
+// latency of the additions.
+template <size_t Bytes, typename Tp>
+__STLL_SIMD_INLINE Tp __simd_sum_kernel(const Tp* first, const Tp* last,
+                                        Tp init) {
+    typedef typename __simd_lane<Tp>::type lane_type;
+    typedef lane_type vector_type __attribute__((vector_size(Bytes)));
+    const ptrdiff_t lanes = Bytes / sizeof(Tp);
+
+    vector_type sum0 = {}, sum1 = {}, sum2 = {}, sum3 = {};
+    vector_type value0, value1, value2, value3;
+    for (; last - first >= 4 * lanes; first += 4 * lanes) {
+        __builtin_memcpy(&value0, first, Bytes);
+        __builtin_memcpy(&value1, first + lanes, Bytes);
+        __builtin_memcpy(&value2, first + 2 * lanes, Bytes);
+        __builtin_memcpy(&value3, first + 3 * lanes, Bytes);
+        sum0 += value0;
+        sum1 += value1;
+        sum2 += value2;
+        sum3 += value3;
+    }
+    for (; last - first >= lanes; first += lanes) {
+        __builtin_memcpy(&value0, first, Bytes);
+        sum0 += value0;
+    }
+    sum0 = (sum0 + sum1) + (sum2 + sum3);
+    typedef typename simd_traits<Tp>::associative wraps;
+    for (ptrdiff_t lane = 0; lane < lanes; ++lane)
+        init = __simd_add(init, Tp(sum0[lane]), wraps());
+    for (; first != last; ++first)
+        init = __simd_add(init, *first, wraps());
+    return init;
+}
+
+// init plus the sum of first1[i] * first2[i].
+template <size_t Bytes, typename Tp>
+__STLL_SIMD_INLINE Tp __simd_dot_kernel(const Tp* first1, const Tp* last1,
+                                        const Tp* first2, Tp init) {
+    typedef typename __simd_lane<Tp>::type lane_type;
+    typedef lane_type vector_type __attribute__((vector_size(Bytes)));
+    const ptrdiff_t lanes = Bytes / sizeof(Tp);
+
+    vector_type sum0 = {}, sum1 = {}, sum2 = {}, sum3 = {};
+    vector_type left0, left1, left2, left3;
+    vector_type right0, right1, right2, right3;
+    for (; last1 - first1 >= 4 * lanes;
+         first1 += 4 * lanes, first2 += 4 * lanes) {
+        __builtin_memcpy(&left0, first1, Bytes);
+        __builtin_memcpy(&left1, first1 + lanes, Bytes);
+        __builtin_memcpy(&left2, first1 + 2 * lanes, Bytes);
+        __builtin_memcpy(&left3, first1 + 3 * lanes, Bytes);
+        __builtin_memcpy(&right0, first2, Bytes);
+        __builtin_memcpy(&right1, first2 + lanes, Bytes);
+        __builtin_memcpy(&right2, first2 + 2 * lanes, Bytes);
+        __builtin_memcpy(&right3, first2 + 3 * lanes, Bytes);
+        sum0 += left0 * right0;
+        sum1 += left1 * right1;
+        sum2 += left2 * right2;
+        sum3 += left3 * right3;
+    }
+    for (; last1 - first1 >= lanes; first1 += lanes, first2 += lanes) {
+        __builtin_memcpy(&left0, first1, Bytes);
+        __builtin_memcpy(&right0, first2, Bytes);
+        sum0 += left0 * right0;
+    }
+    sum0 = (sum0 + sum1) + (sum2 + sum3);
+    typedef typename simd_traits<Tp>::associative wraps;
+    for (ptrdiff_t lane = 0; lane < lanes; ++lane)
+        init = __simd_add(init, Tp(sum0[lane]), wraps());
+    for (; first1 != last1; ++first1, ++first2)
+        init = __simd_add(init, __simd_mul(*first1, *first2, wraps()),
+                          wraps());
+    return init;
+}
+
+/*
+ * The smallest and the greatest values of [first, last), which is not
+ * empty. Returns false, leaving them unspecified, if the range holds a NaN:
+ * a NaN is not ordered, so where it stands changes what min_element finds.
+ */
+template <size_t Bytes, typename Tp>
+__STLL_SIMD_INLINE bool __simd_minmax_kernel(const Tp* first, const Tp* last,
+                                             Tp& min_value, Tp& max_value) {
+    typedef Tp vector_type __attribute__((vector_size(Bytes)));
+    const ptrdiff_t lanes = Bytes / sizeof(Tp);
+
+    vector_type low = vector_type{} + *first;
+    vector_type high = low;
+    vector_type value;
+    auto unordered = low != low;
+    for (; last - first >= lanes; first += lanes) {
+        __builtin_memcpy(&value, first, Bytes);
+        low = value < low ? value : low;
+        high = high < value ? value : high;
+        unordered |= value != value;
+    }
+    if (__simd_any<Bytes>(unordered))
+        return false;
+
+    min_value = low[0];
+    max_value = high[0];
+    for (ptrdiff_t lane = 1; lane < lanes; ++lane) {
+        if (low[lane] < min_value)
+            min_value = low[lane];
+        if (max_value < high[lane])
+            max_value = high[lane];
+    }
+    for (; first != last; ++first) {
+        if (*first != *first)
+            return false;
+        if (*first < min_value)
+            min_value = *first;
+        if (max_value < *first)
+            max_value = *first;
+    }
+    return true;
+}
+
+// out is in moved up by Shift lanes, the low lanes are 0.
+template <size_t Shift, typename Vector, size_t... Lane>
+__STLL_SIMD_INLINE void __simd_shift_lanes(const Vector& in, Vector& out,
+                                           std::index_sequence<Lane...>) {
+    const Vector zero = {};
+    out = __builtin_shufflevector(
+              zero, in, (Lane < Shift ? 0 : sizeof...(Lane) + Lane - Shift)...);
+}
+
+// out has every lane set to the last lane of in.
+template <typename Vector, size_t... Lane>
+__STLL_SIMD_INLINE void __simd_broadcast_last(const Vector& in, Vector& out,
+                                              std::index_sequence<Lane...>) {
+    out = __builtin_shufflevector(in, in, (0 * Lane + sizeof...(Lane) - 1)...);
+}
+
+/*
+ * In register inclusive scan of the Lanes lanes of a vector, in log2(Lanes)
+ * steps: every lane adds the lane Shift below it, for Shift = 1, 2, 4...
+ * The lanes of an integer vector are unsigned, see __simd_lane.
+ */
+template <size_t Shift, size_t Lanes, bool Done = (Shift >= Lanes)>
+struct __simd_lane_scan {
+    template <typename Vector>
+    __STLL_SIMD_INLINE static void apply(Vector& sums) {
+        Vector shifted;
+        __simd_shift_lanes<Shift>(sums, shifted,
+                                  std::make_index_sequence<Lanes>());
+        sums += shifted;
+        __simd_lane_scan<Shift * 2, Lanes>::apply(sums);
+    }
+};
+
+template <size_t Shift, size_t Lanes>
+struct __simd_lane_scan<Shift, Lanes, true> {
+    template <typename Vector>
+    __STLL_SIMD_INLINE static void apply(Vector&) {}
+};
+
+/*
+ * Scan [first, last) into result from init, result may be first. An
+ * inclusive scan writes init + first[0] + ... + first[i] at result[i], an
+ * exclusive one init + first[0] + ... + first[i - 1]. Each vector is
+ * scanned in register, then the carry, the sum of the vectors before it,
+ * is added: the carry is the only dependency from a vector to the next.
+ */
+template <size_t Bytes, bool Exclusive, typename Tp>
+__STLL_SIMD_INLINE Tp* __simd_scan_kernel(const Tp* first, const Tp* last,
+                                          Tp* result, Tp init) {
+    typedef typename __simd_lane<Tp>::type lane_type;
+    typedef lane_type vector_type __attribute__((vector_size(Bytes)));
+    const ptrdiff_t lanes = Bytes / sizeof(Tp);
+    typedef std::make_index_sequence<Bytes / sizeof(Tp)> lane_indices;
+
+    vector_type carry = vector_type{} + lane_type(init);
+    vector_type sums, shifted, total;
+    for (; last - first >= lanes; first += lanes, result += lanes) {
+        __builtin_memcpy(&sums, first, Bytes);
+        __simd_lane_scan<1, Bytes / sizeof(Tp)>::apply(sums);
+        __simd_broadcast_last(sums, total, lane_indices());
+        if (Exclusive) {
+            __simd_shift_lanes<1>(sums, shifted, lane_indices());
+            shifted += carry;
+        } else {
+            shifted = sums + carry;
+        }
+        __builtin_memcpy(result, &shifted, Bytes);
+        carry += total;
+    }
+
+    typedef typename simd_traits<Tp>::associative wraps;
+    init = Tp(carry[0]);
+    for (; first != last; ++first, ++result) {
+        Tp sum = __simd_add(init, *first, wraps());
+        *result = Exclusive ? init : sum;
+        init = sum;
+    }
+    return result;
+}
+
+// The first element of [first, last) equal to value, or last.
+template <size_t Bytes, typename Tp>
+__STLL_SIMD_INLINE const Tp* __simd_find_kernel(const Tp* first,
+                                                const Tp* last, Tp value) {
+    typedef Tp vector_type __attribute__((vector_size(Bytes)));
+    const ptrdiff_t lanes = Bytes / sizeof(Tp);
+
+    vector_type target = vector_type{} + value;
+    vector_type block0, block1;
+    for (; last - first >= 2 * lanes; first += 2 * lanes) {
+        __builtin_memcpy(&block0, first, Bytes);
+        __builtin_memcpy(&block1, first + lanes, Bytes);
+        auto found0 = block0 == target;
+        auto found1 = block1 == target;
+        if (__simd_any<Bytes>(found0 | found1)) {
+            if (__simd_any<Bytes>(found0))
+                return first + __simd_first_lane<Bytes, Tp>(found0);
+            return first + lanes + __simd_first_lane<Bytes, Tp>(found1);
+        }
+    }
+    for (; first != last; ++first) {
+        if (*first == value)
+            return first;
+    }
+    return last;
+}
+
+// The number of elements of [first, last) equal to value.
+template <size_t Bytes, typename Tp>
+__STLL_SIMD_INLINE size_t __simd_count_kernel(const Tp* first,
+                                              const Tp* last, Tp value) {
+    typedef Tp vector_type __attribute__((vector_size(Bytes)));
+    typedef decltype(vector_type{} == vector_type{}) mask_type;
+    const ptrdiff_t lanes = Bytes / sizeof(Tp);
+    // A lane of counts is as wide as Tp, it is added to total before it
+    // overflows.
+    const ptrdiff_t max_steps = sizeof(Tp) == 1 ? 127
+                                : sizeof(Tp) == 2 ? 32767 : 0x7fffffff;
+
+    vector_type target = vector_type{} + value;
+    vector_type block;
+    size_t total = 0;
+    while (last - first >= lanes) {
+        ptrdiff_t steps = (last - first) / lanes;
+        if (steps > max_steps)
+            steps = max_steps;
+        // A set lane of a comparison result is -1.
+        mask_type counts = {};
+        for (; steps > 0; --steps, first += lanes) {
+            __builtin_memcpy(&block, first, Bytes);
+            counts -= block == target;
+        }
+        for (ptrdiff_t lane = 0; lane < lanes; ++lane)
+            total += size_t(counts[lane]);
+    }
+    for (; first != last; ++first) {
+        if (*first == value)
+            ++total;
+    }
+    return total;
+}
+
+// The first element of [first1, last1) which differs from its counterpart
+// from first2, or last1.
+template <size_t Bytes, typename Tp>
+__STLL_SIMD_INLINE const Tp* __simd_mismatch_kernel(const Tp* first1,
+                                                    const Tp* last1,
+                                                    const Tp* first2) {
+    typedef Tp vector_type __attribute__((vector_size(Bytes)));
+    const ptrdiff_t lanes = Bytes / sizeof(Tp);
+
+    vector_type left0, left1, right0, right1;
+    for (; last1 - first1 >= 2 * lanes;
+         first1 += 2 * lanes, first2 += 2 * lanes) {
+        __builtin_memcpy(&left0, first1, Bytes);
+        __builtin_memcpy(&left1, first1 + lanes, Bytes);
+        __builtin_memcpy(&right0, first2, Bytes);
+        __builtin_memcpy(&right1, first2 + lanes, Bytes);
+        auto differ0 = left0 != right0;
+        auto differ1 = left1 != right1;
+        if (__simd_any<Bytes>(differ0 | differ1)) {
+            if (__simd_any<Bytes>(differ0))
+                return first1 + __simd_first_lane<Bytes, Tp>(differ0);
+            return first1 + lanes + __simd_first_lane<Bytes, Tp>(differ1);
+        }
+    }
+    for (; first1 != last1; ++first1, ++first2) {
+        if (!(*first1 == *first2))
+            return first1;
+    }
+    return last1;
+}
+
+// The last element of [first, last) equal to value, or last.
+template <size_t Bytes, typename Tp>
+__STLL_SIMD_INLINE const Tp* __simd_find_last_kernel(const Tp* first,
+                                                     const Tp* last,
+                                                     Tp value) {
+    typedef Tp vector_type __attribute__((vector_size(Bytes)));
+    const ptrdiff_t lanes = Bytes / sizeof(Tp);
+
+    vector_type target = vector_type{} + value;
+    vector_type block0, block1;
+    const Tp* cursor = last;
+    for (; cursor - first >= 2 * lanes; cursor -= 2 * lanes) {
+        __builtin_memcpy(&block0, cursor - 2 * lanes, Bytes);
+        __builtin_memcpy(&block1, cursor - lanes, Bytes);
+        if (__simd_any<Bytes>((block0 == target) | (block1 == target)))
+            break;
+    }
+    while (cursor != first) {
+        if (*--cursor == value)
+            return cursor;
+    }
+    return last;
+}
+
+// left = left Operation right, for words or vectors of words.
+template <int Operation, typename Vector>
+__STLL_SIMD_INLINE void __simd_bit_apply(Vector& left, const Vector& right) {
+    switch (Operation) {
+    case SIMD_BIT_AND:
+        left &= right;
+        break;
+    case SIMD_BIT_OR:
+        left |= right;
+        break;
+    case SIMD_BIT_XOR:
+        left ^= right;
+        break;
+    default:
+        left &= ~right;
+        break;
+    }
+}
+
+// result[i] = first1[i] Operation first2[i] for the words of [first1,
+// last1), result may be first1 or first2.
+template <size_t Bytes, int Operation, typename Word>
+__STLL_SIMD_INLINE void __simd_bitwise_kernel(const Word* first1,
+                                              const Word* last1,
+                                              const Word* first2,
+                                              Word* result) {
+    typedef Word vector_type __attribute__((vector_size(Bytes)));
+    const ptrdiff_t lanes = Bytes / sizeof(Word);
+
+    vector_type left, right;
+    for (; last1 - first1 >= lanes;
+         first1 += lanes, first2 += lanes, result += lanes) {
+        __builtin_memcpy(&left, first1, Bytes);
+        __builtin_memcpy(&right, first2, Bytes);
+        __simd_bit_apply<Operation>(left, right);
+        __builtin_memcpy(result, &left, Bytes);
+    }
+    for (; first1 != last1; ++first1, ++first2, ++result) {
+        Word word = *first1;
+        __simd_bit_apply<Operation>(word, *first2);
+        *result = word;
+    }
+}
+
+/*
+ * The number of set bits of the 64 bits words of [first, last). Each
+ * vector is counted per byte with shifts and masks, the byte counts of up
+ * to 31 vectors are added in place (31 * 8 < 256), then folded into 64
+ * bits lanes. It needs no popcount instruction, which x86-64 only has as
+ * an extension, and none for vectors before AVX-512 VPOPCNTDQ.
+ */
+template <size_t Bytes, typename Word>
+__STLL_SIMD_INLINE size_t __simd_popcount_kernel(const Word* first,
+                                                 const Word* last) {
+    typedef Word vector_type __attribute__((vector_size(Bytes)));
+    const ptrdiff_t lanes = Bytes / sizeof(Word);
+    const vector_type m1 = vector_type{} + 0x5555555555555555ull;
+    const vector_type m2 = vector_type{} + 0x3333333333333333ull;
+    const vector_type m4 = vector_type{} + 0x0f0f0f0f0f0f0f0full;
+    const vector_type m8 = vector_type{} + 0x00ff00ff00ff00ffull;
+    const vector_type m16 = vector_type{} + 0x0000ffff0000ffffull;
+    const vector_type m32 = vector_type{} + 0x00000000ffffffffull;
+
+    vector_type block;
+    size_t total = 0;
+    while (last - first >= lanes) {
+        ptrdiff_t steps = (last - first) / lanes;
+        if (steps > 31)
+            steps = 31;
+        vector_type counts = {};
+        for (; steps > 0; --steps, first += lanes) {
+            __builtin_memcpy(&block, first, Bytes);
+            block -= (block >> 1) & m1;
+            block = (block & m2) + ((block >> 2) & m2);
+            counts += (block + (block >> 4)) & m4;
+        }
+        counts = (counts & m8) + ((counts >> 8) & m8);
+        counts = (counts & m16) + ((counts >> 16) & m16);
+        counts = (counts & m32) + (counts >> 32);
+        for (ptrdiff_t lane = 0; lane < lanes; ++lane)
+            total += size_t(counts[lane]);
+    }
+    for (; first != last; ++first)
+        total += __builtin_popcountll(*first);
+    return total;
+}
+
+// The first nonzero word of [first, last), or last.
+template <size_t Bytes, typename Word>
+__STLL_SIMD_INLINE const Word* __simd_find_nonzero_kernel(const Word* first,
+                                                          const Word* last) {
+    typedef Word vector_type __attribute__((vector_size(Bytes)));
+    const ptrdiff_t lanes = Bytes / sizeof(Word);
+
+    vector_type block0, block1;
+    for (; last - first >= 2 * lanes; first += 2 * lanes) {
+        __builtin_memcpy(&block0, first, Bytes);
+        __builtin_memcpy(&block1, first + lanes, Bytes);
+        if (__simd_any<Bytes>(block0 | block1))
+            break;
+    }
+    for (; first != last; ++first) {
+        if (*first != 0)
+            return first;
+    }
+    return last;
+}
+
+
+/*
+ * __simd_isa: the kernels compiled for one instruction set. The functions
+ * of the wider sets carry a target attribute and must only be called when
+ * simd_level() says the CPU has it.
+ */
+#define __STLL_SIMD_ISA_FUNCTIONS(Bytes, ...)                               \
+    template <typename Tp>                                                  \
+    __VA_ARGS__ static Tp sum(const Tp* first, const Tp* last, Tp init) {   \
+        return __simd_sum_kernel<Bytes>(first, last, init);                 \
+    }                                                                       \
+                                                                            \
+    template <typename Tp>                                                  \
+    __VA_ARGS__ static Tp dot(const Tp* first1, const Tp* last1,            \
+                              const Tp* first2, Tp init) {                  \
+        return __simd_dot_kernel<Bytes>(first1, last1, first2, init);       \
+    }                                                                       \
+                                                                            \
+    template <typename Tp>                                                  \
+    __VA_ARGS__ static Tp* inclusive_scan(const Tp* first, const Tp* last,  \
+                                          Tp* result, Tp init) {            \
+        return __simd_scan_kernel<Bytes, false>(first, last, result, init); \
+    }                                                                       \
+                                                                            \
+    template <typename Tp>                                                  \
+    __VA_ARGS__ static Tp* exclusive_scan(const Tp* first, const Tp* last,  \
+                                          Tp* result, Tp init) {            \
+        return __simd_scan_kernel<Bytes, true>(first, last, result, init);  \
+    }                                                                       \
+                                                                            \
+    template <typename Tp>                                                  \
+    __VA_ARGS__ static bool minmax(const Tp* first, const Tp* last,         \
+                                   Tp& min_value, Tp& max_value) {          \
+        return __simd_minmax_kernel<Bytes>(first, last,                     \
+                                           min_value, max_value);           \
+    }                                                                       \
+                                                                            \
+    template <typename Tp>                                                  \
+    __VA_ARGS__ static const Tp* find(const Tp* first, const Tp* last,      \
+                                      Tp value) {                           \
+        return __simd_find_kernel<Bytes>(first, last, value);               \
+    }                                                                       \
+                                                                            \
+    template <typename Tp>                                                  \
+    __VA_ARGS__ static size_t count(const Tp* first, const Tp* last,        \
+                                    Tp value) {                             \
+        return __simd_count_kernel<Bytes>(first, last, value);              \
+    }                                                                       \
+                                                                            \
+    template <typename Tp>                                                  \
+    __VA_ARGS__ static const Tp* mismatch(const Tp* first1,                 \
+                                          const Tp* last1,                  \
+                                          const Tp* first2) {               \
+        return __simd_mismatch_kernel<Bytes>(first1, last1, first2);        \
+    }                                                                       \
+                                                                            \
+    template <typename Tp>                                                  \
+    __VA_ARGS__ static const Tp* find_last(const Tp* first, const Tp* last, \
+                                           Tp value) {                      \
+        return __simd_find_last_kernel<Bytes>(first, last, value);          \
+    }                                                                       \
+                                                                            \
+    template <int Operation>                                                \
+    __VA_ARGS__ static void bitwise(const uint64_t* first1,                 \
+                                    const uint64_t* last1,                  \
+                                    const uint64_t* first2,                 \
+                                    uint64_t* result) {                     \
+        __simd_bitwise_kernel<Bytes, Operation>(first1, last1,              \
+                                                first2, result);            \
+    }                                                                       \
+                                                                            \
+    __VA_ARGS__ static size_t popcount(const uint64_t* first,               \
+                                       const uint64_t* last) {              \
+        return __simd_popcount_kernel<Bytes>(first, last);                  \
+    }                                                                       \
+                                                                            \
+    __VA_ARGS__ static const uint64_t* find_nonzero(const uint64_t* first,  \
+                                                    const uint64_t* last) { \
+        return __simd_find_nonzero_kernel<Bytes>(first, last);              \
+    }
+
+struct __simd_isa_128 {
+    __STLL_SIMD_ISA_FUNCTIONS(16, inline)
+};
+
+#ifdef __STLL_SIMD_X86__
+struct __simd_isa_avx2 {
+    __STLL_SIMD_ISA_FUNCTIONS(32, __attribute__((target("avx2"))))
+};
+
+struct __simd_isa_avx512 {
+    __STLL_SIMD_ISA_FUNCTIONS(64, __attribute__((
+        target("avx512f,avx512dq,avx512bw,avx512vl"))))
+};
+#endif
+
+#undef __STLL_SIMD_ISA_FUNCTIONS
+
+// Call the function of the widest instruction set of this CPU.
+#ifdef __STLL_SIMD_X86__
+#define __STLL_SIMD_DISPATCH(function, ...)                         \
+    switch (simd_level()) {                                         \
+    case SIMD_AVX512:                                               \
+        return __simd_isa_avx512::function(__VA_ARGS__);            \
+    case SIMD_AVX2:                                                 \
+        return __simd_isa_avx2::function(__VA_ARGS__);              \
+    default:                                                        \
+        return __simd_isa_128::function(__VA_ARGS__);               \
+    }
+#else
+#define __STLL_SIMD_DISPATCH(function, ...)                         \
+    return __simd_isa_128::function(__VA_ARGS__);
+#endif
+
+template <typename Tp>
+inline Tp __simd_sum(const Tp* first, const Tp* last, Tp init) {
+    __STLL_SIMD_DISPATCH(sum, first, last, init)
+}
+
+template <typename Tp>
+inline Tp __simd_dot(const Tp* first1, const Tp* last1, const Tp* first2,
+                     Tp init) {
+    __STLL_SIMD_DISPATCH(dot, first1, last1, first2, init)
+}
+
+template <typename Tp>
+inline Tp* __simd_inclusive_scan(const Tp* first, const Tp* last, Tp* result,
+                                 Tp init) {
+    __STLL_SIMD_DISPATCH(inclusive_scan, first, last, result, init)
+}
+
+template <typename Tp>
+inline Tp* __simd_exclusive_scan(const Tp* first, const Tp* last, Tp* result,
+                                 Tp init) {
+    __STLL_SIMD_DISPATCH(exclusive_scan, first, last, result, init)
+}
+
+template <typename Tp>
+inline bool __simd_minmax(const Tp* first, const Tp* last,
+                          Tp& min_value, Tp& max_value) {
+    __STLL_SIMD_DISPATCH(minmax, first, last, min_value, max_value)
+}
+
+// Bytes are searched with memchr, which the C library already vectorizes
+// and tunes for each CPU.
+template <typename Tp>
+inline const Tp* __simd_find(const Tp* first, const Tp* last, Tp value) {
+    if (sizeof(Tp) == 1) {
+        if (first == last)
+            return last;
+        const void* found = std::memchr(first, (unsigned char)value,
+                                        size_t(last - first));
+        return found ? static_cast<const Tp*>(found) : last;
+    }
+    __STLL_SIMD_DISPATCH(find, first, last, value)
+}
+
+template <typename Tp>
+inline size_t __simd_count(const Tp* first, const Tp* last, Tp value) {
+    __STLL_SIMD_DISPATCH(count, first, last, value)
+}
+
+template <typename Tp>
+inline const Tp* __simd_mismatch(const Tp* first1, const Tp* last1,
+                                 const Tp* first2) {
+    __STLL_SIMD_DISPATCH(mismatch, first1, last1, first2)
+}
+
+// Whether [first1, last1) and the range from first2 hold the same bytes.
+template <typename Tp>
+inline bool __simd_equal_bytes(const Tp* first1, const Tp* last1,
+                               const Tp* first2) {
+    return first1 == last1
+           or std::memcmp(first1, first2, sizeof(Tp) * (last1 - first1)) == 0;
+}
+
+template <typename Tp>
+inline const Tp* __simd_find_last(const Tp* first, const Tp* last,
+                                  Tp value) {
+    __STLL_SIMD_DISPATCH(find_last, first, last, value)
+}
+
+
+template <int Operation>
+inline void __simd_bitwise(const uint64_t* first1, const uint64_t* last1,
+                           const uint64_t* first2, uint64_t* result) {
+    __STLL_SIMD_DISPATCH(template bitwise<Operation>,
+                         first1, last1, first2, result)
+}
+
+inline size_t __simd_popcount(const uint64_t* first, const uint64_t* last) {
+    __STLL_SIMD_DISPATCH(popcount, first, last)
+}
+
+inline const uint64_t* __simd_find_nonzero(const uint64_t* first,
+                                           const uint64_t* last) {
+    __STLL_SIMD_DISPATCH(find_nonzero, first, last)
+}
+
+}
+
+#undef __STLL_SIMD_DISPATCH
+
+#endif // __STLL_SIMD__
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // SIMD_HPP
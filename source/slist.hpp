@@ -74,6 +74,7 @@ public:
     typedef ptrdiff_t    difference_type;
 
     typedef Alloc        node_alloc;
+    typedef Alloc        allocator_type;
 
     typedef slist<Tp, Alloc>               self;
 
@@ -81,15 +82,24 @@ public:
     typedef slist_iterator<Tp, const Tp&, const Tp*> const_iterator;
 
 protected:
-    slist_node<Tp>       head;
     typedef slist_node<Tp> node_type;
 
+    Alloc                node_allocator;
+    slist_node<Tp>       head;
+
 public:
-    slist() {
+    slist()
+        :node_allocator() {
+        head.next = nullptr;
+    }
+
+    explicit slist(const Alloc& allocator)
+        :node_allocator(allocator) {
         head.next = nullptr;
     }
 
-    slist(self&& L) {
+    slist(self&& L)
+        :node_allocator(L.node_allocator) {
         head.next = L.head.next;
         L.head.next = nullptr;
     }
@@ -132,9 +142,14 @@ public:
         node_type* p_tmp = nullptr;
         while (p_node) {
             p_tmp = p_node->next;
-            node_alloc::deallocate(p_node);
+            destroy_node(p_node);
             p_node = p_tmp;
         }
+        head.next = nullptr;
+    }
+
+    Alloc get_allocator() const {
+        return node_allocator;
     }
 
     iterator begin() {
@@ -162,17 +177,21 @@ public:
     }
 
     void swap(self& L) {
-        swap(L.head.next, head.next);
+        STLL_NAMESPACE::swap(L.node_allocator, node_allocator);
+        STLL_NAMESPACE::swap(L.head.next, head.next);
     }
 
-    static node_type* create_node(const value_type& value) {
-        node_type* new_node = node_alloc::allocate(1);
+protected:
+    node_type* create_node(const value_type& value) {
+        node_type* new_node = node_allocator.allocate(1);
         construct(&new_node->data, value);
         new_node->next = nullptr;
+        return new_node;
     }
 
-    static void destroy_node(node_type* node) {
-        node_alloc::deallocate(node, 1);
+    void destroy_node(node_type* node) {
+        STLL_NAMESPACE::destroy(&node->data);
+        node_allocator.deallocate(node, 1);
     }
 
 };
@@ -0,0 +1,704 @@
+#ifndef SOA_VECTOR_HPP
+#define SOA_VECTOR_HPP
+
+#include <stdexcept>
+#include <utility>
+
+#include "base.hpp"
+#include "allocator.hpp"
+#include "construct.hpp"
+#include "iterator.hpp"
+#include "memory.hpp"
+#include "move.hpp"
+#include "span.hpp"
+#include "type_traits.hpp"
+
+__STLL_NAMESPACE_START__
+
+/*
+ * __soa_tuple<index_sequence<I...>, Types...>: one value of each type, in
+ * the __soa_leaf<I, Tp> bases; I tells apart two leaves of the same type.
+ * soa_row keeps its fields in it, soa_vector and its iterators their
+ * column pointers.
+ */
+template <size_t I, typename Tp>
+struct __soa_leaf {
+    Tp      value;
+
+    __soa_leaf()
+        :value()
+    {}
+
+    template <typename Up>
+    explicit __soa_leaf(Up&& value)
+        :value(STLL_NAMESPACE::forward<Up>(value))
+    {}
+};
+
+template <typename Indices, typename... Types>
+struct __soa_tuple;
+
+template <size_t... I, typename... Types>
+struct __soa_tuple<std::index_sequence<I...>, Types...>
+    : public __soa_leaf<I, Types>... {
+    __soa_tuple() {}
+
+    // The index_sequence only tells this one from the copy constructor.
+    template <typename... Up>
+    __soa_tuple(std::index_sequence<I...>, Up&&... values)
+        :__soa_leaf<I, Types>(STLL_NAMESPACE::forward<Up>(values))...
+    {}
+
+    // Column pointers to Tp convert to column pointers to const Tp.
+    template <typename... Up>
+    __soa_tuple(const __soa_tuple<std::index_sequence<I...>, Up...>& another)
+        :__soa_leaf<I, Types>(
+            static_cast<const __soa_leaf<I, Up>&>(another).value)...
+    {}
+};
+
+// The type of the I-th of Types.
+template <size_t I, typename Tp, typename... Types>
+struct __soa_field {
+    typedef typename __soa_field<I - 1, Types...>::type type;
+};
+
+template <typename Tp, typename... Types>
+struct __soa_field<0, Tp, Types...> {
+    typedef Tp type;
+};
+
+namespace
+{
+
+template <size_t I, typename Tp>
+inline Tp& __soa_get(__soa_leaf<I, Tp>& leaf) {
+    return leaf.value;
+}
+
+template <size_t I, typename Tp>
+inline const Tp& __soa_get(const __soa_leaf<I, Tp>& leaf) {
+    return leaf.value;
+}
+
+}
+
+
+template <typename... Fields>
+class soa_reference;
+
+/*
+ * soa_row: the value of one row of a soa_vector, i.e. its value_type.
+ * It is what a copy out of the vector gives, e.g. the pivot or the
+ * temporary of a swap in an algorithm.
+ */
+template <typename... Fields>
+class soa_row
+    : public __soa_tuple<std::index_sequence_for<Fields...>, Fields...> {
+public:
+    typedef std::index_sequence_for<Fields...>  indices;
+    typedef __soa_tuple<indices, Fields...>     base;
+    typedef soa_row<Fields...>                  self;
+
+public:
+    soa_row() {}
+
+    explicit soa_row(const Fields&... values)
+        :base(indices(), values...)
+    {}
+
+    template <typename... Up>
+    soa_row(const soa_reference<Up...>& row)
+        :soa_row(row, indices())
+    {}
+
+    template <size_t I>
+    typename __soa_field<I, Fields...>::type& get() {
+        return __soa_get<I>(*this);
+    }
+
+    template <size_t I>
+    const typename __soa_field<I, Fields...>::type& get() const {
+        return __soa_get<I>(*this);
+    }
+
+protected:
+    template <typename Reference, size_t... I>
+    soa_row(const Reference& row, std::index_sequence<I...>)
+        :base(indices(), row.template get<I>()...)
+    {}
+};
+
+
+/*
+ * soa_reference: the reference of a soa_vector, a proxy holding a pointer
+ * to each field of one row. Assigning to it assigns the fields of the
+ * row; copying it copies the pointers, like binding a reference.
+ * Fields are const in the const_reference.
+ */
+template <typename... Fields>
+class soa_reference {
+public:
+    typedef std::index_sequence_for<Fields...>  indices;
+    typedef __soa_tuple<indices, Fields*...>    pointers_type;
+    typedef soa_row<typename remove_const<Fields>::type...>  value_type;
+    typedef soa_reference<Fields...>            self;
+
+protected:
+    pointers_type   fields;
+
+public:
+    // The row index of the columns.
+    soa_reference(const pointers_type& columns, size_t index)
+        :soa_reference(columns, index, indices())
+    {}
+
+    // A reference to Tp converts to a reference to const Tp.
+    template <typename... Up>
+    soa_reference(const soa_reference<Up...>& another)
+        :soa_reference(another, indices())
+    {}
+
+    soa_reference(const self&) = default;
+
+    self& operator=(const self& another) {
+        assign(another, indices());
+        return *this;
+    }
+
+    template <typename... Up>
+    self& operator=(const soa_reference<Up...>& another) {
+        assign(another, indices());
+        return *this;
+    }
+
+    self& operator=(const value_type& row) {
+        assign(row, indices());
+        return *this;
+    }
+
+    self& operator=(value_type&& row) {
+        assign_moved(row, indices());
+        return *this;
+    }
+
+    template <size_t I>
+    typename __soa_field<I, Fields...>::type& get() const {
+        return *__soa_get<I>(fields);
+    }
+
+    void swap(const self& another) const {
+        swap_fields(another, indices());
+    }
+
+protected:
+    template <size_t... I>
+    soa_reference(const pointers_type& columns, size_t index,
+                  std::index_sequence<I...>)
+        :fields(indices(), __soa_get<I>(columns) + index...)
+    {}
+
+    template <typename Reference, size_t... I>
+    soa_reference(const Reference& another, std::index_sequence<I...>)
+        :fields(indices(), &another.template get<I>()...)
+    {}
+
+    template <typename Row, size_t... I>
+    void assign(const Row& row, std::index_sequence<I...>) {
+        ((get<I>() = row.template get<I>()), ...);
+    }
+
+    template <size_t... I>
+    void assign_moved(value_type& row, std::index_sequence<I...>) {
+        ((get<I>() = STLL_NAMESPACE::move(row.template get<I>())), ...);
+    }
+
+    template <size_t... I>
+    void swap_fields(const self& another, std::index_sequence<I...>) const {
+        (STLL_NAMESPACE::swap(get<I>(), another.template get<I>()), ...);
+    }
+};
+
+// Swaps the rows, not the proxies: swap(*iter1, *iter2).
+template <typename... Fields>
+inline void swap(soa_reference<Fields...> row1,
+                 soa_reference<Fields...> row2) {
+    row1.swap(row2);
+}
+
+
+/*
+ * soa_iterator: random access iterator over the rows of a soa_vector, it
+ * keeps the column pointers and a row index. operator* gives a
+ * soa_reference, so the generic (not the contiguous) paths of the
+ * algorithms are taken; scan one column through its span to get the
+ * contiguous ones.
+ */
+template <typename... Fields>
+class soa_iterator {
+public:
+    typedef random_access_iterator_tag          iterator_category;
+    typedef soa_row<typename remove_const<Fields>::type...>  value_type;
+    typedef soa_reference<Fields...>            reference;
+    typedef void                                pointer;
+    typedef ptrdiff_t                           difference_type;
+
+    typedef __soa_tuple<std::index_sequence_for<Fields...>, Fields*...>
+            columns_type;
+    typedef soa_iterator<Fields...>             self;
+
+    template <typename... Up>
+    friend class soa_iterator;
+
+protected:
+    columns_type        columns;
+    difference_type     index;
+
+public:
+    soa_iterator()
+        :columns(), index(0)
+    {}
+
+    soa_iterator(const columns_type& columns, difference_type index)
+        :columns(columns), index(index)
+    {}
+
+    // iterator converts to const_iterator.
+    template <typename... Up>
+    soa_iterator(const soa_iterator<Up...>& another)
+        :columns(another.columns), index(another.index)
+    {}
+
+    reference operator*() const {
+        return reference(columns, index);
+    }
+
+    reference operator[](difference_type n) const {
+        return reference(columns, index + n);
+    }
+
+    self& operator++() {
+        ++index;
+        return *this;
+    }
+
+    self operator++(int) {
+        self result = *this;
+        ++index;
+        return result;
+    }
+
+    self& operator--() {
+        --index;
+        return *this;
+    }
+
+    self operator--(int) {
+        self result = *this;
+        --index;
+        return result;
+    }
+
+    self& operator+=(difference_type n) {
+        index += n;
+        return *this;
+    }
+
+    self& operator-=(difference_type n) {
+        index -= n;
+        return *this;
+    }
+
+    self operator+(difference_type n) const {
+        return self(columns, index + n);
+    }
+
+    self operator-(difference_type n) const {
+        return self(columns, index - n);
+    }
+
+    difference_type operator-(const self& another) const {
+        return index - another.index;
+    }
+
+    bool operator==(const self& another) const {
+        return index == another.index;
+    }
+
+    bool operator!=(const self& another) const {
+        return index != another.index;
+    }
+
+    bool operator<(const self& another) const {
+        return index < another.index;
+    }
+
+    bool operator>(const self& another) const {
+        return index > another.index;
+    }
+
+    bool operator<=(const self& another) const {
+        return index <= another.index;
+    }
+
+    bool operator>=(const self& another) const {
+        return index >= another.index;
+    }
+};
+
+template <typename... Fields>
+inline soa_iterator<Fields...> operator+(
+        typename soa_iterator<Fields...>::difference_type n,
+        const soa_iterator<Fields...>& iter) {
+    return iter + n;
+}
+
+
+/*
+ * soa_vector: a vector of rows of Fields... stored as a structure of
+ * arrays, one contiguous array per field. A pass over one field reads
+ * only that field's array, so every byte of every cache line it fetches
+ * is used; with the rows of a vector<record> it would read the whole
+ * records.
+ * The arrays share one allocation and each one starts on a cache line,
+ * so column<I>() gives an aligned span<field_type<I>> that the SIMD
+ * kernels, e.g. reduce or find, take as plain pointers.
+ * Rows are reached through proxies: operator[] and the iterators give a
+ * soa_reference, and value_type is a soa_row.
+ */
+template <typename... Fields>
+class soa_vector {
+public:
+    typedef soa_row<Fields...>                  value_type;
+    typedef soa_reference<Fields...>            reference;
+    typedef soa_reference<const Fields...>      const_reference;
+    typedef soa_iterator<Fields...>             iterator;
+    typedef soa_iterator<const Fields...>       const_iterator;
+    typedef size_t                              size_type;
+    typedef ptrdiff_t                           difference_type;
+
+    typedef soa_vector<Fields...>               self;
+
+    template <size_t I>
+    using field_type = typename __soa_field<I, Fields...>::type;
+
+    enum {COLUMN_ALIGN = CACHE_LINE_SIZE};
+    enum {FIELD_COUNT = sizeof...(Fields)};
+
+    typedef aligned_allocator<unsigned char, COLUMN_ALIGN> block_allocator;
+
+    static_assert(sizeof...(Fields) > 0, "soa_vector needs a field");
+    static_assert(((alignof(Fields) <= COLUMN_ALIGN) && ...),
+                  "a field is aligned beyond a cache line");
+
+protected:
+    typedef std::index_sequence_for<Fields...>  indices;
+    typedef __soa_tuple<indices, Fields*...>    columns_type;
+
+    columns_type    columns;
+    unsigned char*  block;
+    size_type       count;
+    size_type       cap;
+
+public:
+    soa_vector()
+        :columns(), block(nullptr), count(0), cap(0)
+    {}
+
+    explicit soa_vector(size_type size)
+        :soa_vector() {
+        resize(size);
+    }
+
+    soa_vector(const self& another)
+        :soa_vector() {
+        reserve(another.size());
+        copy_columns(another, indices());
+        count = another.count;
+    }
+
+    soa_vector(self&& another)
+        :columns(another.columns), block(another.block),
+         count(another.count), cap(another.cap) {
+        another.columns = columns_type();
+        another.block = nullptr;
+        another.count = another.cap = 0;
+    }
+
+    ~soa_vector() {
+        release();
+    }
+
+    self& operator=(const self& another) {
+        if (this != &another) {
+            self copy(another);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    // another is left empty.
+    self& operator=(self&& another) {
+        if (this != &another) {
+            self moved(STLL_NAMESPACE::move(another));
+            swap(moved);
+        }
+        return *this;
+    }
+
+    void swap(self& another) {
+        STLL_NAMESPACE::swap(columns, another.columns);
+        STLL_NAMESPACE::swap(block, another.block);
+        STLL_NAMESPACE::swap(count, another.count);
+        STLL_NAMESPACE::swap(cap, another.cap);
+    }
+
+    size_type size() const {
+        return count;
+    }
+
+    size_type capacity() const {
+        return cap;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    // The I-th field of every row, contiguous and cache line aligned.
+    template <size_t I>
+    span<field_type<I>> column() {
+        return span<field_type<I>>(__soa_get<I>(columns), count);
+    }
+
+    template <size_t I>
+    span<const field_type<I>> column() const {
+        return span<const field_type<I>>(__soa_get<I>(columns), count);
+    }
+
+    template <size_t I>
+    field_type<I>* data() {
+        return __soa_get<I>(columns);
+    }
+
+    template <size_t I>
+    const field_type<I>* data() const {
+        return __soa_get<I>(columns);
+    }
+
+    reference operator[](size_type index) {
+        return reference(columns, index);
+    }
+
+    const_reference operator[](size_type index) const {
+        return const_reference(columns, index);
+    }
+
+    reference at(size_type index) {
+        if (index >= size())
+            throw std::range_error("index out of range");
+        return (*this)[index];
+    }
+
+    const_reference at(size_type index) const {
+        if (index >= size())
+            throw std::range_error("index out of range");
+        return (*this)[index];
+    }
+
+    reference front() {
+        return (*this)[0];
+    }
+
+    const_reference front() const {
+        return (*this)[0];
+    }
+
+    reference back() {
+        return (*this)[count - 1];
+    }
+
+    const_reference back() const {
+        return (*this)[count - 1];
+    }
+
+    iterator begin() {
+        return iterator(columns, 0);
+    }
+
+    iterator end() {
+        return iterator(columns, count);
+    }
+
+    const_iterator begin() const {
+        return const_iterator(columns, 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(columns, count);
+    }
+
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    const_iterator cend() const {
+        return end();
+    }
+
+    void reserve(size_type size) {
+        if (size > cap)
+            reallocate(size);
+    }
+
+    void push_back(const Fields&... values) {
+        if (count == cap) {
+            // The values may be fields of this vector, so the row is built
+            // in the new block before the old one is released.
+            size_type new_cap = max(size_type(1), cap * 2);
+            columns_type new_columns;
+            unsigned char* new_block = allocate_columns(new_columns, new_cap);
+            construct_row(new_columns, count, indices(), values...);
+            replace_columns(new_columns, new_block, new_cap);
+        } else {
+            construct_row(columns, count, indices(), values...);
+        }
+        ++count;
+    }
+
+    void push_back(const value_type& row) {
+        if (count == cap)
+            reallocate(max(size_type(1), cap * 2));
+        construct_row(count, row, indices());
+        ++count;
+    }
+
+    void pop_back() {
+        destroy_rows(count - 1, count, indices());
+        --count;
+    }
+
+    // New rows have value initialized fields.
+    void resize(size_type size) {
+        if (size < count) {
+            destroy_rows(size, count, indices());
+        } else {
+            reserve(size);
+            for (; count < size; ++count)
+                construct_row(count, indices());
+        }
+        count = size;
+    }
+
+    void clear() {
+        destroy_rows(0, count, indices());
+        count = 0;
+    }
+
+protected:
+    // Puts the offset of each column in offsets and returns the bytes of
+    // a block for n rows; every column starts on a COLUMN_ALIGN boundary.
+    static size_type layout(size_type n, size_type* offsets) {
+        const size_type sizes[] = {sizeof(Fields)...};
+        size_type bytes = 0;
+        for (size_type i = 0; i < FIELD_COUNT; ++i) {
+            offsets[i] = bytes;
+            bytes += (sizes[i] * n + COLUMN_ALIGN - 1)
+                     / COLUMN_ALIGN * COLUMN_ALIGN;
+        }
+        return bytes;
+    }
+
+    // Move the rows to a block for new_cap rows.
+    void reallocate(size_type new_cap) {
+        columns_type new_columns;
+        unsigned char* new_block = allocate_columns(new_columns, new_cap);
+        replace_columns(new_columns, new_block, new_cap);
+    }
+
+    // Allocate a block for n rows and point to_columns at its columns.
+    unsigned char* allocate_columns(columns_type& to_columns, size_type n) {
+        size_type offsets[FIELD_COUNT];
+        unsigned char* to_block = block_allocator::allocate(layout(n, offsets));
+        place_columns(to_columns, to_block, offsets, indices());
+        return to_block;
+    }
+
+    // Move the rows to to_columns, then release the old block for the
+    // one of to_columns.
+    void replace_columns(columns_type& to_columns, unsigned char* to_block,
+                         size_type to_cap) {
+        move_columns(to_columns, indices());
+        release();
+        columns = to_columns;
+        block = to_block;
+        cap = to_cap;
+    }
+
+    // Destroy the rows and give the block back, count is left alone.
+    void release() {
+        if (block == nullptr)
+            return;
+        destroy_rows(0, count, indices());
+        size_type offsets[FIELD_COUNT];
+        block_allocator::deallocate(block, layout(cap, offsets));
+        block = nullptr;
+    }
+
+    template <size_t... I>
+    static void place_columns(columns_type& to, unsigned char* to_block,
+                              const size_type* offsets,
+                              std::index_sequence<I...>) {
+        ((__soa_get<I>(to) =
+              reinterpret_cast<Fields*>(to_block + offsets[I])), ...);
+    }
+
+    template <size_t... I>
+    void move_columns(columns_type& to, std::index_sequence<I...>) {
+        (move_column(__soa_get<I>(columns), __soa_get<I>(to)), ...);
+    }
+
+    template <typename Tp>
+    void move_column(Tp* from, Tp* to) {
+        for (size_type i = 0; i < count; ++i)
+            construct(to + i, STLL_NAMESPACE::move(from[i]));
+    }
+
+    template <size_t... I>
+    void copy_columns(const self& another, std::index_sequence<I...>) {
+        (STLL_NAMESPACE::uninitialized_copy(
+             __soa_get<I>(another.columns),
+             __soa_get<I>(another.columns) + another.count,
+             __soa_get<I>(columns)), ...);
+    }
+
+    template <size_t... I, typename... Args>
+    static void construct_row(columns_type& to, size_type index,
+                              std::index_sequence<I...>,
+                              const Args&... values) {
+        (construct(__soa_get<I>(to) + index, values), ...);
+    }
+
+    template <size_t... I>
+    void construct_row(size_type index, std::index_sequence<I...>) {
+        (construct(__soa_get<I>(columns) + index), ...);
+    }
+
+    template <size_t... I>
+    void construct_row(size_type index, const value_type& row,
+                       std::index_sequence<I...>) {
+        (construct(__soa_get<I>(columns) + index, row.template get<I>()),
+         ...);
+    }
+
+    template <size_t... I>
+    void destroy_rows(size_type first, size_type last,
+                      std::index_sequence<I...>) {
+        (STLL_NAMESPACE::destroy(__soa_get<I>(columns) + first,
+                                 __soa_get<I>(columns) + last), ...);
+    }
+};
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // SOA_VECTOR_HPP
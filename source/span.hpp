@@ -0,0 +1,301 @@
+#ifndef SPAN_HPP
+#define SPAN_HPP
+
+#include <stdexcept>
+
+#include "base.hpp"
+#include "hash.hpp"
+#include "iterator.hpp"
+#include "simd.hpp"
+#include "type_traits.hpp"
+
+__STLL_NAMESPACE_START__
+
+// The Extent of a span whose size is only known at run time.
+const size_t dynamic_extent = ~size_t(0);
+
+// A span of a fixed Extent keeps only its pointer.
+template <typename Tp, size_t Extent>
+struct __span_storage {
+    Tp*     ptr;
+
+    constexpr __span_storage(Tp* ptr, size_t count)
+        :ptr(ptr) {
+        if (count != Extent)
+            throw std::length_error("span size differs from its extent");
+    }
+
+    constexpr size_t size() const {
+        return Extent;
+    }
+};
+
+template <typename Tp>
+struct __span_storage<Tp, dynamic_extent> {
+    Tp*     ptr;
+    size_t  count;
+
+    constexpr __span_storage(Tp* ptr, size_t count)
+        :ptr(ptr), count(count)
+    {}
+
+    constexpr size_t size() const {
+        return count;
+    }
+};
+
+// Whether Up elements may be viewed as Tp: the same type, or made const.
+template <typename Up, typename Tp>
+struct __span_compatible {
+    static const bool value = false;
+};
+
+template <typename Tp>
+struct __span_compatible<Tp, Tp> {
+    static const bool value = true;
+};
+
+template <typename Tp>
+struct __span_compatible<Tp, const Tp> {
+    static const bool value = true;
+};
+
+template <typename...>
+struct __span_void {
+    typedef void type;
+};
+
+template <typename Tp, size_t Extent>
+class span;
+
+template <typename Tp>
+struct __span_is_span {
+    static const bool value = false;
+};
+
+template <typename Up, size_t N>
+struct __span_is_span<span<Up, N>> {
+    static const bool value = true;
+};
+
+// Whether Container has data() and size(), and its elements may be viewed
+// as Tp. A span is not taken as a container: the converting constructor
+// checks its extent.
+template <typename Container, typename Tp, typename = void>
+struct __span_container {
+    static const bool value = false;
+};
+
+template <typename Container, typename Tp>
+struct __span_container<Container, Tp, typename __span_void<
+        decltype(declval<Container&>().data()),
+        decltype(declval<Container&>().size())>::type> {
+    typedef typename remove_reference<
+                decltype(*declval<Container&>().data())>::type element_type;
+
+    static const bool value =
+        __span_compatible<element_type, Tp>::value
+        and !__span_is_span<typename remove_const<Container>::type>::value;
+};
+
+/*
+ * span: a view of count contiguous Tp owned by someone else, e.g. a slice
+ * of a receive buffer, a vector, a C array or a deque segment. Slicing
+ * copies two words and never the elements. Tp may be const to make the
+ * view read only. The iterators are plain pointers, so the algorithms take
+ * their contiguous (SIMD, memcmp) paths on a span.
+ * span<Tp, N> has N elements for sure and is one pointer wide; building
+ * it from a range of another size throws std::length_error.
+ */
+template <typename Tp, size_t Extent=dynamic_extent>
+class span {
+public:
+    typedef Tp                  element_type;
+    typedef typename iterator_traits<Tp*>::value_type   value_type;
+    typedef Tp*                 pointer;
+    typedef const Tp*           const_pointer;
+    typedef Tp&                 reference;
+    typedef const Tp&           const_reference;
+    typedef size_t              size_type;
+    typedef ptrdiff_t           difference_type;
+
+    typedef pointer             iterator;
+
+    typedef span<Tp, Extent>    self;
+
+    static const size_type extent = Extent;
+
+protected:
+    __span_storage<Tp, Extent> storage;
+
+public:
+    // Only a span that may be empty has a default.
+    template <size_t E = Extent, typename = typename enable_if<
+                  E == 0 or E == dynamic_extent>::type>
+    constexpr span()
+        :storage(nullptr, 0)
+    {}
+
+    constexpr span(pointer ptr, size_type count)
+        :storage(ptr, count)
+    {}
+
+    // A template, so that span(ptr, 0) means a count.
+    template <typename Pointer, typename = typename enable_if<
+                  __span_compatible<typename remove_reference<
+                      decltype(*declval<Pointer&>())>::type, Tp>::value>::type>
+    constexpr span(Pointer first, Pointer last)
+        :storage(first, last - first)
+    {}
+
+    template <size_t N, typename = typename enable_if<
+                  Extent == dynamic_extent or N == Extent>::type>
+    constexpr span(element_type (&array)[N])
+        :storage(array, N)
+    {}
+
+    // Any contiguous container with data() and size(), e.g. vector or
+    // basic_string.
+    template <typename Container, typename = typename enable_if<
+                  __span_container<Container, Tp>::value>::type>
+    constexpr span(Container& container)
+        :storage(container.data(), container.size())
+    {}
+
+    template <typename Container, typename = typename enable_if<
+                  __span_container<const Container, Tp>::value>::type>
+    constexpr span(const Container& container)
+        :storage(container.data(), container.size())
+    {}
+
+    // span<Tp> converts to span<const Tp>, and a span of a fixed extent to
+    // a span of a dynamic one.
+    template <typename Up, size_t N, typename = typename enable_if<
+                  __span_compatible<Up, Tp>::value
+                  and (Extent == dynamic_extent or N == dynamic_extent
+                       or N == Extent)>::type>
+    constexpr span(const span<Up, N>& another)
+        :storage(another.data(), another.size())
+    {}
+
+    constexpr span(const self&) = default;
+
+    self& operator=(const self&) = default;
+
+    constexpr size_type size() const {
+        return storage.size();
+    }
+
+    constexpr size_type size_bytes() const {
+        return size() * sizeof(Tp);
+    }
+
+    constexpr bool empty() const {
+        return size() == 0;
+    }
+
+    constexpr pointer data() const {
+        return storage.ptr;
+    }
+
+    constexpr iterator begin() const {
+        return data();
+    }
+
+    constexpr iterator end() const {
+        return data() + size();
+    }
+
+    constexpr reference operator[](size_type index) const {
+        return data()[index];
+    }
+
+    reference at(size_type index) const {
+        if (index >= size())
+            throw std::range_error("index out of range");
+        return data()[index];
+    }
+
+    constexpr reference front() const {
+        return data()[0];
+    }
+
+    constexpr reference back() const {
+        return data()[size() - 1];
+    }
+
+    // The first count elements.
+    constexpr span<Tp> first(size_type count) const {
+        return span<Tp>(data(), count);
+    }
+
+    // The last count elements.
+    constexpr span<Tp> last(size_type count) const {
+        return span<Tp>(data() + size() - count, count);
+    }
+
+    // count elements from offset, or all of them to the end.
+    constexpr span<Tp> subspan(size_type offset,
+                               size_type count=dynamic_extent) const {
+        return span<Tp>(data() + offset,
+                        count == dynamic_extent ? size() - offset : count);
+    }
+
+    template <size_t Count>
+    constexpr span<Tp, Count> first() const {
+        return span<Tp, Count>(data(), Count);
+    }
+
+    template <size_t Count>
+    constexpr span<Tp, Count> last() const {
+        return span<Tp, Count>(data() + size() - Count, Count);
+    }
+};
+
+template <typename Tp, size_t Extent>
+const typename span<Tp, Extent>::size_type span<Tp, Extent>::extent;
+
+
+// The bytes of the elements, for I/O and hashing.
+template <typename Tp, size_t Extent>
+inline span<const unsigned char> as_bytes(const span<Tp, Extent>& s) {
+    return span<const unsigned char>(
+                reinterpret_cast<const unsigned char*>(s.data()),
+                s.size_bytes());
+}
+
+namespace
+{
+
+template <typename Tp>
+inline size_t __hash_span(const Tp* first, const Tp* last, false_type) {
+    size_t hash_value = last - first;
+    for (; first != last; ++first) {
+        hash_value ^= hash<Tp>()(*first) + 0x9e3779b97f4a7c15ull
+                      + (hash_value << 6) + (hash_value >> 2);
+    }
+    return hash_value;
+}
+
+// Integers are equal when their bytes are: hash the bytes at once.
+template <typename Tp>
+inline size_t __hash_span(const Tp* first, const Tp* last, true_type) {
+    return hash_bytes(first, (last - first) * sizeof(Tp));
+}
+
+}
+
+// Hashes the elements, not the pointer: equal contents hash alike.
+template <typename Tp, size_t Extent>
+struct hash<span<Tp, Extent>> {
+    size_t operator()(const span<Tp, Extent>& s) const {
+        typedef typename span<Tp, Extent>::value_type value_type;
+        typedef typename simd_traits<value_type>::integral integral;
+        const value_type* first = s.data();
+        return __hash_span(first, first + s.size(), integral());
+    }
+};
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // SPAN_HPP
@@ -20,7 +20,7 @@ public:
     typedef stack<Tp, Sequence> self;
 
 protected:
-    deque<int> sequence;
+    Sequence sequence;
 
 public:
     stack()
@@ -55,7 +55,7 @@ public:
     }
 
     void swap(self& another) {
-        sequence.swap(another);
+        sequence.swap(another.sequence);
     }
 
     reference top() {
@@ -75,6 +75,23 @@ public:
         sequence.pop_back();
     }
 
+    // Push every element of [first, last) in one batch, the last one
+    // becomes the top.
+    template <typename InputIterator>
+    void push_range(InputIterator first, InputIterator last) {
+        sequence.append(first, last);
+    }
+
+    // Pop n elements in one batch, writing them to out in pop() order.
+    template <typename OutputIterator>
+    OutputIterator pop_n(size_type n, OutputIterator out) {
+        return sequence.pop_back_n(n, out);
+    }
+
+    void pop_n(size_type n) {
+        sequence.pop_back_n(n);
+    }
+
 };
 
 __STLL_NAMESPACE_FINISH__
@@ -0,0 +1,781 @@
+#ifndef STRING_HPP
+#define STRING_HPP
+
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+
+#include "base.hpp"
+#include "algorithm.hpp"
+#include "allocator.hpp"
+#include "hash.hpp"
+#include "iterator.hpp"
+#include "string_view.hpp"
+
+__STLL_NAMESPACE_START__
+
+/*
+ * basic_string: characters with a terminator, in a 3 words object.
+ * A string of up to LOCAL_CAPACITY characters, 23 chars on a 64 bits
+ * machine, is kept inside the object and costs no allocation. The last
+ * character of the local buffer holds LOCAL_CAPACITY - size(): it is the
+ * terminator when the buffer is full. A longer string lives in storage of
+ * Alloc, which grows geometrically; its capacity word overlaps that last
+ * character and has the top bit of the character set, which no local size
+ * has, so the bit tells the two forms apart.
+ * Comparisons go through char_traits (memcmp for char), and the hash reads
+ * the whole byte range with hash_bytes.
+ */
+template <typename CharT, typename Alloc=allocator<CharT>>
+class basic_string {
+public:
+    typedef CharT               value_type;
+    typedef CharT*              pointer;
+    typedef const CharT*        const_pointer;
+    typedef CharT&              reference;
+    typedef const CharT&        const_reference;
+    typedef size_t              size_type;
+    typedef ptrdiff_t           difference_type;
+
+    typedef pointer             iterator;
+    typedef const_pointer       const_iterator;
+    typedef char_traits<CharT>  traits_type;
+    typedef Alloc               alloc;
+    typedef Alloc               allocator_type;
+
+    typedef basic_string<CharT, Alloc>  self;
+    typedef basic_string_view<CharT>    view_type;
+
+    static const size_type npos = size_type(-1);
+
+protected:
+    struct long_rep {
+        CharT*      data;
+        size_type   size;
+        size_type   capacity;   // encoded, see encode_capacity()
+    };
+
+    enum {LOCAL_CAPACITY = sizeof(long_rep) / sizeof(CharT) - 1};
+
+    // An empty Alloc takes no room as a base.
+    struct rep_type : public Alloc {
+        union {
+            long_rep    heap;
+            CharT       local[LOCAL_CAPACITY + 1];
+        };
+
+        explicit rep_type(const Alloc& allocator)
+            :Alloc(allocator), heap()
+        {}
+    };
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    // The last character overlaps the low bits of the capacity word.
+    static const size_type LONG_FLAG =
+        size_type(1) << (8 * sizeof(CharT) - 1);
+
+    static size_type encode_capacity(size_type capacity) {
+        return (capacity << (8 * sizeof(CharT))) | LONG_FLAG;
+    }
+
+    static size_type decode_capacity(size_type word) {
+        return word >> (8 * sizeof(CharT));
+    }
+#else
+    // The last character overlaps the high bits of the capacity word.
+    static const size_type LONG_FLAG = ~(~size_type(0) >> 1);
+
+    static size_type encode_capacity(size_type capacity) {
+        return capacity | LONG_FLAG;
+    }
+
+    static size_type decode_capacity(size_type word) {
+        return word & ~LONG_FLAG;
+    }
+#endif
+
+    rep_type rep;
+
+public:
+    basic_string()
+        :rep(Alloc()) {
+        set_local_size(0);
+    }
+
+    explicit basic_string(const Alloc& allocator)
+        :rep(allocator) {
+        set_local_size(0);
+    }
+
+    basic_string(const CharT* s, const Alloc& allocator=Alloc())
+        :rep(allocator) {
+        init(s, traits_type::length(s));
+    }
+
+    basic_string(const CharT* s, size_type n, const Alloc& allocator=Alloc())
+        :rep(allocator) {
+        init(s, n);
+    }
+
+    explicit basic_string(view_type view, const Alloc& allocator=Alloc())
+        :rep(allocator) {
+        init(view.data(), view.size());
+    }
+
+    basic_string(size_type n, CharT c, const Alloc& allocator=Alloc())
+        :rep(allocator) {
+        set_local_size(0);
+        append(n, c);
+    }
+
+    template <typename InputIterator>
+    basic_string(InputIterator first, InputIterator last,
+                 const Alloc& allocator=Alloc())
+        :rep(allocator) {
+        set_local_size(0);
+        for (; first != last; ++first)
+            push_back(*first);
+    }
+
+    basic_string(const std::initializer_list<CharT>& initializer_list,
+                 const Alloc& allocator=Alloc())
+        :rep(allocator) {
+        init(initializer_list.begin(), initializer_list.size());
+    }
+
+    basic_string(const self& str)
+        :rep(str.get_allocator()) {
+        init(str.data(), str.size());
+    }
+
+    // The storage of str is taken, str is left empty.
+    basic_string(self&& str)
+        :rep(str.rep) {
+        str.set_local_size(0);
+    }
+
+    ~basic_string() {
+        release();
+    }
+
+    self& operator=(const self& str) {
+        if (this != &str)
+            assign(str.data(), str.size());
+        return *this;
+    }
+
+    // The storage of str is taken with its allocator.
+    self& operator=(self&& str) {
+        if (this == &str)
+            return *this;
+        release();
+        rep = str.rep;
+        str.set_local_size(0);
+        return *this;
+    }
+
+    self& operator=(const CharT* s) {
+        return assign(s, traits_type::length(s));
+    }
+
+    self& operator=(CharT c) {
+        return assign(&c, 1);
+    }
+
+    Alloc get_allocator() const {
+        return static_cast<const Alloc&>(rep);
+    }
+
+    void swap(self& str) {
+        STLL_NAMESPACE::swap(rep, str.rep);
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    size_type size() const {
+        if (is_long())
+            return rep.heap.size;
+        return LOCAL_CAPACITY - size_type(rep.local[LOCAL_CAPACITY]);
+    }
+
+    size_type length() const {
+        return size();
+    }
+
+    size_type capacity() const {
+        return is_long() ? decode_capacity(rep.heap.capacity)
+                         : size_type(LOCAL_CAPACITY);
+    }
+
+    // The capacity must leave the flag bit alone.
+    static size_type max_size() {
+        return (~size_type(0) >> (8 * sizeof(CharT))) - 1;
+    }
+
+    const CharT* data() const {
+        return is_long() ? rep.heap.data : rep.local;
+    }
+
+    CharT* data() {
+        return is_long() ? rep.heap.data : rep.local;
+    }
+
+    const CharT* c_str() const {
+        return data();
+    }
+
+    const_iterator begin() const {
+        return data();
+    }
+
+    const_iterator end() const {
+        return data() + size();
+    }
+
+    const_iterator cbegin() const {
+        return begin();
+    }
+
+    const_iterator cend() const {
+        return end();
+    }
+
+    iterator begin() {
+        return data();
+    }
+
+    iterator end() {
+        return data() + size();
+    }
+
+    const_reference operator[](size_type index) const {
+        return data()[index];
+    }
+
+    reference operator[](size_type index) {
+        return data()[index];
+    }
+
+    const_reference at(size_type index) const {
+        if (index >= size())
+            throw std::range_error("index out of range");
+        return data()[index];
+    }
+
+    reference at(size_type index) {
+        if (index >= size())
+            throw std::range_error("index out of range");
+        return data()[index];
+    }
+
+    const_reference front() const {
+        return data()[0];
+    }
+
+    const_reference back() const {
+        return data()[size() - 1];
+    }
+
+    reference front() {
+        return data()[0];
+    }
+
+    reference back() {
+        return data()[size() - 1];
+    }
+
+    void reserve(size_type n) {
+        if (n > capacity())
+            reallocate(n);
+    }
+
+    // A string which fits goes back into the object.
+    void shrink_to_fit() {
+        if (!is_long() or size() == capacity())
+            return;
+        if (size() > size_type(LOCAL_CAPACITY)) {
+            reallocate(size());
+            return;
+        }
+        long_rep old = rep.heap;
+        traits_type::copy(rep.local, old.data, old.size);
+        set_local_size(old.size);
+        deallocate(old.data, decode_capacity(old.capacity));
+    }
+
+    void clear() {
+        set_size(0);
+    }
+
+    void resize(size_type n, CharT c=CharT()) {
+        if (n > size())
+            append(n - size(), c);
+        else
+            set_size(n);
+    }
+
+    void push_back(CharT c) {
+        size_type old_size = size();
+        if (old_size == capacity())
+            reallocate(grown_capacity(old_size + 1), &c, 1);
+        else
+            set_size_and_put(old_size, c);
+    }
+
+    void pop_back() {
+        set_size(size() - 1);
+    }
+
+    self& assign(const CharT* s, size_type n) {
+        if (n <= capacity()) {
+            // s may point into this string.
+            traits_type::move(data(), s, n);
+            set_size(n);
+            return *this;
+        }
+        check_length(n);
+        CharT* storage = allocate(n);
+        traits_type::copy(storage, s, n);
+        release();
+        set_heap(storage, n, n);
+        return *this;
+    }
+
+    self& assign(const self& str) {
+        return *this = str;
+    }
+
+    self& append(const CharT* s, size_type n) {
+        size_type old_size = size();
+        check_length(old_size + n);
+        if (old_size + n > capacity()) {
+            // s may point into the old storage, which is still alive.
+            reallocate(grown_capacity(old_size + n), s, n);
+            return *this;
+        }
+        traits_type::copy(data() + old_size, s, n);
+        set_size(old_size + n);
+        return *this;
+    }
+
+    self& append(const CharT* s) {
+        return append(s, traits_type::length(s));
+    }
+
+    self& append(const self& str) {
+        return append(str.data(), str.size());
+    }
+
+    self& append(view_type view) {
+        return append(view.data(), view.size());
+    }
+
+    self& append(size_type n, CharT c) {
+        size_type old_size = size();
+        check_length(old_size + n);
+        if (old_size + n > capacity())
+            reallocate(grown_capacity(old_size + n));
+        traits_type::assign(data() + old_size, n, c);
+        set_size(old_size + n);
+        return *this;
+    }
+
+    /*
+     * Append every piece, a string, a view, a null terminated array or a
+     * character, in order, after one reservation for all of them, e.g.
+     *     path.append_all(directory, '/', name, ".txt");
+     * grows the storage at most once where a chain of += could grow it at
+     * each step. A piece may be this string or point into it: the pieces
+     * are read as they were before the call, and the old storage is only
+     * given back once they are all copied.
+     */
+    template <typename... Pieces>
+    self& append_all(const Pieces&... pieces) {
+        size_type sizes[] = {0, piece_size(pieces)...};
+        size_type old_size = size();
+        size_type total = old_size;
+        for (size_type n : sizes)
+            total += n;
+        check_length(total);
+        bool grow = total > capacity();
+        CharT* storage = grow ? allocate(total) : data();
+        if (grow)
+            traits_type::copy(storage, data(), old_size);
+        CharT* out = storage + old_size;
+        const size_type* n = sizes;
+        int expand_copy[] = {
+            0, (traits_type::copy(out, piece_data(pieces), *++n),
+                out += *n, 0)...
+        };
+        (void)expand_copy;
+        if (grow) {
+            release();
+            set_heap(storage, total, total);
+        } else {
+            set_size(total);
+        }
+        return *this;
+    }
+
+    self& operator+=(const self& str) {
+        return append(str.data(), str.size());
+    }
+
+    self& operator+=(const CharT* s) {
+        return append(s);
+    }
+
+    self& operator+=(view_type view) {
+        return append(view.data(), view.size());
+    }
+
+    self& operator+=(CharT c) {
+        push_back(c);
+        return *this;
+    }
+
+    self& insert(size_type pos, const CharT* s, size_type n) {
+        size_type old_size = size();
+        if (pos > old_size)
+            throw std::range_error("index out of range");
+        if (s >= data() and s < data() + old_size) {
+            self copy(s, n);
+            return insert(pos, copy.data(), n);
+        }
+        check_length(old_size + n);
+        if (old_size + n > capacity()) {
+            size_type new_capacity = grown_capacity(old_size + n);
+            CharT* storage = allocate(new_capacity);
+            traits_type::copy(storage, data(), pos);
+            traits_type::copy(storage + pos, s, n);
+            traits_type::copy(storage + pos + n, data() + pos, old_size - pos);
+            release();
+            set_heap(storage, old_size + n, new_capacity);
+            return *this;
+        }
+        CharT* p = data();
+        traits_type::move(p + pos + n, p + pos, old_size - pos);
+        traits_type::copy(p + pos, s, n);
+        set_size(old_size + n);
+        return *this;
+    }
+
+    self& insert(size_type pos, const self& str) {
+        return insert(pos, str.data(), str.size());
+    }
+
+    self& erase(size_type pos=0, size_type n=npos) {
+        size_type old_size = size();
+        if (pos > old_size)
+            throw std::range_error("index out of range");
+        n = min(n, old_size - pos);
+        CharT* p = data();
+        traits_type::move(p + pos, p + pos + n, old_size - pos - n);
+        set_size(old_size - n);
+        return *this;
+    }
+
+    self substr(size_type pos=0, size_type n=npos) const {
+        if (pos > size())
+            throw std::range_error("index out of range");
+        return self(data() + pos, min(n, size() - pos), get_allocator());
+    }
+
+    // The searches and comparisons are those of the view.
+    size_type find(const CharT* s, size_type pos, size_type n) const {
+        return view_type(*this).find(view_type(s, n), pos);
+    }
+
+    size_type find(view_type view, size_type pos=0) const {
+        return view_type(*this).find(view, pos);
+    }
+
+    size_type find(const self& str, size_type pos=0) const {
+        return view_type(*this).find(view_type(str), pos);
+    }
+
+    size_type find(const CharT* s, size_type pos=0) const {
+        return view_type(*this).find(view_type(s), pos);
+    }
+
+    size_type find(CharT c, size_type pos=0) const {
+        return view_type(*this).find(c, pos);
+    }
+
+    size_type rfind(CharT c, size_type pos=npos) const {
+        return view_type(*this).rfind(c, pos);
+    }
+
+    int compare(view_type view) const {
+        return view_type(*this).compare(view);
+    }
+
+    int compare(const self& str) const {
+        return view_type(*this).compare(view_type(str));
+    }
+
+    int compare(const CharT* s) const {
+        return view_type(*this).compare(view_type(s));
+    }
+
+    // A view of the characters, valid until the string changes.
+    operator view_type() const {
+        return view_type(data(), size());
+    }
+
+protected:
+    bool is_long() const {
+        return (rep.heap.capacity & LONG_FLAG) != 0;
+    }
+
+    CharT* allocate(size_type capacity) {
+        // One more for the terminator.
+        return rep.allocate(capacity + 1);
+    }
+
+    void deallocate(CharT* storage, size_type capacity) {
+        rep.deallocate(storage, capacity + 1);
+    }
+
+    void release() {
+        if (is_long())
+            deallocate(rep.heap.data, decode_capacity(rep.heap.capacity));
+    }
+
+    void check_length(size_type n) const {
+        if (n > max_size())
+            throw std::length_error("string too long");
+    }
+
+    size_type grown_capacity(size_type n) const {
+        return max(n, min(capacity() * 2, max_size()));
+    }
+
+    void set_local_size(size_type n) {
+        rep.local[n] = CharT();
+        rep.local[LOCAL_CAPACITY] = CharT(LOCAL_CAPACITY - n);
+    }
+
+    void set_heap(CharT* storage, size_type n, size_type capacity) {
+        rep.heap.data = storage;
+        rep.heap.size = n;
+        rep.heap.capacity = encode_capacity(capacity);
+        storage[n] = CharT();
+    }
+
+    void set_size(size_type n) {
+        if (is_long()) {
+            rep.heap.size = n;
+            rep.heap.data[n] = CharT();
+        } else {
+            set_local_size(n);
+        }
+    }
+
+    // Put c at the end, there is room for it.
+    void set_size_and_put(size_type old_size, CharT c) {
+        data()[old_size] = c;
+        set_size(old_size + 1);
+    }
+
+    void init(const CharT* s, size_type n) {
+        if (n <= size_type(LOCAL_CAPACITY)) {
+            traits_type::copy(rep.local, s, n);
+            set_local_size(n);
+            return;
+        }
+        check_length(n);
+        CharT* storage = allocate(n);
+        traits_type::copy(storage, s, n);
+        set_heap(storage, n, n);
+    }
+
+    // Move the characters to storage of new_capacity, then append s[0, n),
+    // which may point into the old storage.
+    void reallocate(size_type new_capacity, const CharT* s=nullptr,
+                    size_type n=0) {
+        size_type old_size = size();
+        CharT* storage = allocate(new_capacity);
+        traits_type::copy(storage, data(), old_size);
+        traits_type::copy(storage + old_size, s, n);
+        release();
+        set_heap(storage, old_size + n, new_capacity);
+    }
+
+    static size_type piece_size(const self& str) {
+        return str.size();
+    }
+
+    static size_type piece_size(const CharT* s) {
+        return traits_type::length(s);
+    }
+
+    static size_type piece_size(view_type view) {
+        return view.size();
+    }
+
+    static size_type piece_size(CharT) {
+        return 1;
+    }
+
+    static const CharT* piece_data(const self& str) {
+        return str.data();
+    }
+
+    static const CharT* piece_data(const CharT* s) {
+        return s;
+    }
+
+    static const CharT* piece_data(const view_type& view) {
+        return view.data();
+    }
+
+    static const CharT* piece_data(const CharT& c) {
+        return &c;
+    }
+};
+
+template <typename CharT, typename Alloc>
+const typename basic_string<CharT, Alloc>::size_type
+basic_string<CharT, Alloc>::npos;
+
+template <typename CharT, typename Alloc>
+const typename basic_string<CharT, Alloc>::size_type
+basic_string<CharT, Alloc>::LONG_FLAG;
+
+
+template <typename CharT, typename Alloc>
+inline basic_string<CharT, Alloc>
+operator+(const basic_string<CharT, Alloc>& lhs,
+          const basic_string<CharT, Alloc>& rhs) {
+    basic_string<CharT, Alloc> result(lhs.get_allocator());
+    return STLL_NAMESPACE::move(result.append_all(lhs, rhs));
+}
+
+template <typename CharT, typename Alloc>
+inline basic_string<CharT, Alloc>
+operator+(const basic_string<CharT, Alloc>& lhs, const CharT* rhs) {
+    basic_string<CharT, Alloc> result(lhs.get_allocator());
+    return STLL_NAMESPACE::move(result.append_all(lhs, rhs));
+}
+
+template <typename CharT, typename Alloc>
+inline basic_string<CharT, Alloc>
+operator+(const CharT* lhs, const basic_string<CharT, Alloc>& rhs) {
+    basic_string<CharT, Alloc> result(rhs.get_allocator());
+    return STLL_NAMESPACE::move(result.append_all(lhs, rhs));
+}
+
+template <typename CharT, typename Alloc>
+inline basic_string<CharT, Alloc>
+operator+(const basic_string<CharT, Alloc>& lhs, CharT rhs) {
+    basic_string<CharT, Alloc> result(lhs.get_allocator());
+    return STLL_NAMESPACE::move(result.append_all(lhs, rhs));
+}
+
+// The sizes are compared first, most unequal strings stop there.
+template <typename CharT, typename Alloc>
+inline bool operator==(const basic_string<CharT, Alloc>& lhs,
+                       const basic_string<CharT, Alloc>& rhs) {
+    return lhs.size() == rhs.size()
+           and char_traits<CharT>::compare(lhs.data(), rhs.data(),
+                                           lhs.size()) == 0;
+}
+
+template <typename CharT, typename Alloc>
+inline bool operator==(const basic_string<CharT, Alloc>& lhs,
+                       const CharT* rhs) {
+    return basic_string_view<CharT>(lhs) == basic_string_view<CharT>(rhs);
+}
+
+template <typename CharT, typename Alloc>
+inline bool operator==(const CharT* lhs,
+                       const basic_string<CharT, Alloc>& rhs) {
+    return rhs == lhs;
+}
+
+template <typename CharT, typename Alloc>
+inline bool operator==(const basic_string<CharT, Alloc>& lhs,
+                       const basic_string_view<CharT>& rhs) {
+    return basic_string_view<CharT>(lhs) == rhs;
+}
+
+template <typename CharT, typename Alloc>
+inline bool operator==(const basic_string_view<CharT>& lhs,
+                       const basic_string<CharT, Alloc>& rhs) {
+    return rhs == lhs;
+}
+
+template <typename CharT, typename Alloc>
+inline bool operator!=(const basic_string<CharT, Alloc>& lhs,
+                       const basic_string<CharT, Alloc>& rhs) {
+    return !(lhs == rhs);
+}
+
+template <typename CharT, typename Alloc>
+inline bool operator!=(const basic_string<CharT, Alloc>& lhs,
+                       const CharT* rhs) {
+    return !(lhs == rhs);
+}
+
+template <typename CharT, typename Alloc>
+inline bool operator!=(const CharT* lhs,
+                       const basic_string<CharT, Alloc>& rhs) {
+    return !(lhs == rhs);
+}
+
+template <typename CharT, typename Alloc>
+inline bool operator!=(const basic_string<CharT, Alloc>& lhs,
+                       const basic_string_view<CharT>& rhs) {
+    return !(lhs == rhs);
+}
+
+template <typename CharT, typename Alloc>
+inline bool operator!=(const basic_string_view<CharT>& lhs,
+                       const basic_string<CharT, Alloc>& rhs) {
+    return !(lhs == rhs);
+}
+
+template <typename CharT, typename Alloc>
+inline bool operator<(const basic_string<CharT, Alloc>& lhs,
+                      const basic_string<CharT, Alloc>& rhs) {
+    return lhs.compare(rhs) < 0;
+}
+
+template <typename CharT, typename Alloc>
+inline bool operator>(const basic_string<CharT, Alloc>& lhs,
+                      const basic_string<CharT, Alloc>& rhs) {
+    return rhs < lhs;
+}
+
+template <typename CharT, typename Alloc>
+inline bool operator<=(const basic_string<CharT, Alloc>& lhs,
+                       const basic_string<CharT, Alloc>& rhs) {
+    return !(rhs < lhs);
+}
+
+template <typename CharT, typename Alloc>
+inline bool operator>=(const basic_string<CharT, Alloc>& lhs,
+                       const basic_string<CharT, Alloc>& rhs) {
+    return !(lhs < rhs);
+}
+
+
+template <typename CharT, typename Alloc>
+struct hash<basic_string<CharT, Alloc>> {
+    size_t operator()(const basic_string<CharT, Alloc>& s) const {
+        return hash_bytes(s.data(), s.size() * sizeof(CharT));
+    }
+};
+
+
+typedef basic_string<char>      string;
+typedef basic_string<wchar_t>   wstring;
+typedef basic_string<char16_t>  u16string;
+typedef basic_string<char32_t>  u32string;
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // STRING_HPP
@@ -0,0 +1,327 @@
+#ifndef STRING_VIEW_HPP
+#define STRING_VIEW_HPP
+
+#include <cstring>
+#include <stdexcept>
+
+#include "base.hpp"
+#include "algorithm.hpp"
+#include "hash.hpp"
+#include "iterator.hpp"
+#include "utility.hpp"
+
+__STLL_NAMESPACE_START__
+
+template <typename CharT>
+struct __char_traits_base {
+    typedef CharT       char_type;
+
+    static CharT* copy(CharT* dest, const CharT* src, size_t n) {
+        if (n != 0)
+            std::memcpy(dest, src, n * sizeof(CharT));
+        return dest;
+    }
+
+    // The ranges may overlap.
+    static CharT* move(CharT* dest, const CharT* src, size_t n) {
+        if (n != 0)
+            std::memmove(dest, src, n * sizeof(CharT));
+        return dest;
+    }
+
+    static CharT* assign(CharT* dest, size_t n, CharT c) {
+        for (size_t i = 0; i < n; ++i)
+            dest[i] = c;
+        return dest;
+    }
+};
+
+/*
+ * char_traits: what basic_string does on runs of characters.
+ * char goes to the C library (strlen, memchr, memcmp), which is tuned for
+ * each CPU; the wider types use the SIMD find and mismatch of algorithm.hpp.
+ */
+template <typename CharT>
+struct char_traits : public __char_traits_base<CharT> {
+    static size_t length(const CharT* s) {
+        const CharT* end = s;
+        while (!(*end == CharT()))
+            ++end;
+        return end - s;
+    }
+
+    static const CharT* find(const CharT* s, size_t n, CharT c) {
+        const CharT* found = STLL_NAMESPACE::find(s, s + n, c);
+        return found == s + n ? nullptr : found;
+    }
+
+    static int compare(const CharT* s1, const CharT* s2, size_t n) {
+        pair<const CharT*, const CharT*> diff =
+            STLL_NAMESPACE::mismatch(s1, s1 + n, s2);
+        if (diff.first == s1 + n)
+            return 0;
+        return *diff.first < *diff.second ? -1 : 1;
+    }
+};
+
+template <>
+struct char_traits<char> : public __char_traits_base<char> {
+    static size_t length(const char* s) {
+        return std::strlen(s);
+    }
+
+    static const char* find(const char* s, size_t n, char c) {
+        return n == 0 ? nullptr
+                      : static_cast<const char*>(std::memchr(s, c, n));
+    }
+
+    // Like memcmp, the characters compare as unsigned char.
+    static int compare(const char* s1, const char* s2, size_t n) {
+        return n == 0 ? 0 : std::memcmp(s1, s2, n);
+    }
+
+    static char* assign(char* dest, size_t n, char c) {
+        if (n != 0)
+            std::memset(dest, c, n);
+        return dest;
+    }
+};
+
+
+/*
+ * basic_string_view: a view of size() characters owned by someone else,
+ * e.g. a basic_string, a literal or a slice of a receive buffer. It is two
+ * words, substr() and remove_prefix() copy no character, and it hashes
+ * and compares like a basic_string of the same characters.
+ * A view does not keep its characters alive and is not null terminated.
+ */
+template <typename CharT>
+class basic_string_view {
+public:
+    typedef CharT               value_type;
+    typedef const CharT*        pointer;
+    typedef const CharT*        const_pointer;
+    typedef const CharT&        reference;
+    typedef const CharT&        const_reference;
+    typedef size_t              size_type;
+    typedef ptrdiff_t           difference_type;
+
+    typedef const_pointer       iterator;
+    typedef const_pointer       const_iterator;
+    typedef char_traits<CharT>  traits_type;
+
+    typedef basic_string_view<CharT>    self;
+
+    static const size_type npos = size_type(-1);
+
+protected:
+    const CharT*    start;
+    size_type       count;
+
+public:
+    constexpr basic_string_view()
+        :start(nullptr), count(0)
+    {}
+
+    constexpr basic_string_view(const CharT* s, size_type count)
+        :start(s), count(count)
+    {}
+
+    basic_string_view(const CharT* s)
+        :start(s), count(traits_type::length(s))
+    {}
+
+    constexpr basic_string_view(const self&) = default;
+
+    self& operator=(const self&) = default;
+
+    constexpr size_type size() const {
+        return count;
+    }
+
+    constexpr size_type length() const {
+        return count;
+    }
+
+    constexpr bool empty() const {
+        return count == 0;
+    }
+
+    constexpr const CharT* data() const {
+        return start;
+    }
+
+    constexpr const_iterator begin() const {
+        return start;
+    }
+
+    constexpr const_iterator end() const {
+        return start + count;
+    }
+
+    constexpr const_iterator cbegin() const {
+        return start;
+    }
+
+    constexpr const_iterator cend() const {
+        return start + count;
+    }
+
+    constexpr const_reference operator[](size_type index) const {
+        return start[index];
+    }
+
+    const_reference at(size_type index) const {
+        if (index >= count)
+            throw std::range_error("index out of range");
+        return start[index];
+    }
+
+    constexpr const_reference front() const {
+        return start[0];
+    }
+
+    constexpr const_reference back() const {
+        return start[count - 1];
+    }
+
+    constexpr void remove_prefix(size_type n) {
+        start += n;
+        count -= n;
+    }
+
+    constexpr void remove_suffix(size_type n) {
+        count -= n;
+    }
+
+    void swap(self& view) {
+        STLL_NAMESPACE::swap(start, view.start);
+        STLL_NAMESPACE::swap(count, view.count);
+    }
+
+    constexpr self substr(size_type pos=0, size_type n=npos) const {
+        if (pos > count)
+            throw std::range_error("index out of range");
+        return self(start + pos, n < count - pos ? n : count - pos);
+    }
+
+    int compare(const self& view) const {
+        int result = traits_type::compare(start, view.start,
+                                          min(count, view.count));
+        if (result != 0)
+            return result;
+        return count < view.count ? -1 : (count > view.count ? 1 : 0);
+    }
+
+    bool starts_with(const self& view) const {
+        return count >= view.count
+               and traits_type::compare(start, view.start, view.count) == 0;
+    }
+
+    bool ends_with(const self& view) const {
+        return count >= view.count
+               and traits_type::compare(start + count - view.count,
+                                        view.start, view.count) == 0;
+    }
+
+    size_type find(const self& view, size_type pos=0) const {
+        if (pos > count)
+            return npos;
+        if (view.count == 0)
+            return pos;
+        const CharT* first = start + pos;
+        const CharT* last = start + count;
+        while (size_type(last - first) >= view.count) {
+            // Only where the first character matches is the rest compared.
+            first = traits_type::find(first, (last - first) - view.count + 1,
+                                      view.start[0]);
+            if (first == nullptr)
+                return npos;
+            if (traits_type::compare(first + 1, view.start + 1,
+                                     view.count - 1) == 0)
+                return first - start;
+            ++first;
+        }
+        return npos;
+    }
+
+    size_type find(CharT c, size_type pos=0) const {
+        if (pos >= count)
+            return npos;
+        const CharT* found = traits_type::find(start + pos, count - pos, c);
+        return found ? found - start : npos;
+    }
+
+    size_type rfind(CharT c, size_type pos=npos) const {
+        if (count == 0)
+            return npos;
+        for (size_type i = min(pos, count - 1) + 1; i > 0; --i) {
+            if (start[i - 1] == c)
+                return i - 1;
+        }
+        return npos;
+    }
+};
+
+template <typename CharT>
+const typename basic_string_view<CharT>::size_type
+basic_string_view<CharT>::npos;
+
+
+// The sizes are compared first, most unequal views stop there.
+template <typename CharT>
+inline bool operator==(const basic_string_view<CharT>& lhs,
+                       const basic_string_view<CharT>& rhs) {
+    return lhs.size() == rhs.size()
+           and char_traits<CharT>::compare(lhs.data(), rhs.data(),
+                                           lhs.size()) == 0;
+}
+
+template <typename CharT>
+inline bool operator!=(const basic_string_view<CharT>& lhs,
+                       const basic_string_view<CharT>& rhs) {
+    return !(lhs == rhs);
+}
+
+template <typename CharT>
+inline bool operator<(const basic_string_view<CharT>& lhs,
+                      const basic_string_view<CharT>& rhs) {
+    return lhs.compare(rhs) < 0;
+}
+
+template <typename CharT>
+inline bool operator>(const basic_string_view<CharT>& lhs,
+                      const basic_string_view<CharT>& rhs) {
+    return rhs < lhs;
+}
+
+template <typename CharT>
+inline bool operator<=(const basic_string_view<CharT>& lhs,
+                       const basic_string_view<CharT>& rhs) {
+    return !(rhs < lhs);
+}
+
+template <typename CharT>
+inline bool operator>=(const basic_string_view<CharT>& lhs,
+                       const basic_string_view<CharT>& rhs) {
+    return !(lhs < rhs);
+}
+
+
+// The same value as the hash of a basic_string of the same characters.
+template <typename CharT>
+struct hash<basic_string_view<CharT>> {
+    size_t operator()(const basic_string_view<CharT>& view) const {
+        return hash_bytes(view.data(), view.size() * sizeof(CharT));
+    }
+};
+
+
+typedef basic_string_view<char>         string_view;
+typedef basic_string_view<wchar_t>      wstring_view;
+typedef basic_string_view<char16_t>     u16string_view;
+typedef basic_string_view<char32_t>     u32string_view;
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // STRING_VIEW_HPP
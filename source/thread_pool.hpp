@@ -0,0 +1,432 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "base.hpp"
+
+__STLL_NAMESPACE_START__
+
+// Threads of thread_pool::default_pool(), 0 for one per hardware thread.
+#ifndef STLL_DEFAULT_POOL_THREADS
+#define STLL_DEFAULT_POOL_THREADS 0
+#endif
+
+/*
+ * work_stealing_deque: the Chase-Lev deque.
+ * The owner thread pushes and pops at the bottom without a lock, other
+ * threads steal from the top, a compare and swap on top settles the race
+ * for the last element. The ring doubles when it is full; the old rings
+ * are kept until the deque is destroyed, since a thief may still be
+ * reading one.
+ * Tp must be trivially copyable, it is a task pointer in thread_pool.
+ */
+template <typename Tp>
+class work_stealing_deque {
+protected:
+    struct ring {
+        int64_t             capacity;
+        std::atomic<Tp>*    slots;
+        ring*               previous;
+
+        explicit ring(int64_t capacity, ring* previous=nullptr)
+            :capacity(capacity), slots(new std::atomic<Tp>[capacity])
+            ,previous(previous)
+        {}
+
+        ~ring() {
+            delete[] slots;
+        }
+
+        Tp get(int64_t index) const {
+            return slots[index & (capacity - 1)].load(
+                        std::memory_order_relaxed);
+        }
+
+        void put(int64_t index, Tp value) {
+            slots[index & (capacity - 1)].store(value,
+                                                std::memory_order_relaxed);
+        }
+    };
+
+    enum {INITIAL_CAPACITY = 64};
+
+    std::atomic<int64_t>    top;
+    std::atomic<int64_t>    bottom;
+    std::atomic<ring*>      array;
+
+public:
+    work_stealing_deque()
+        :top(0), bottom(0), array(new ring(INITIAL_CAPACITY))
+    {}
+
+    work_stealing_deque(const work_stealing_deque&) = delete;
+
+    work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+    ~work_stealing_deque() {
+        ring* current = array.load(std::memory_order_relaxed);
+        while (current) {
+            ring* previous = current->previous;
+            delete current;
+            current = previous;
+        }
+    }
+
+    // Only the owner may push.
+    void push(Tp value) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        ring* current = array.load(std::memory_order_relaxed);
+        if (b - t >= current->capacity) {
+            ring* bigger = new ring(current->capacity * 2, current);
+            for (int64_t index = t; index < b; ++index)
+                bigger->put(index, current->get(index));
+            array.store(bigger, std::memory_order_release);
+            current = bigger;
+        }
+        current->put(b, value);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // Only the owner may pop, it takes the most recent element.
+    bool pop(Tp& value) {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        ring* current = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_seq_cst);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        value = current->get(b);
+        if (t == b) {
+            // Last element, race with the thieves for it.
+            bool won = top.compare_exchange_strong(
+                            t, t + 1, std::memory_order_seq_cst,
+                            std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread may steal, it takes the oldest element.
+    bool steal(Tp& value) {
+        int64_t t = top.load(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_seq_cst);
+        if (t >= b)
+            return false;
+        ring* current = array.load(std::memory_order_acquire);
+        value = current->get(t);
+        return top.compare_exchange_strong(t, t + 1,
+                                           std::memory_order_seq_cst,
+                                           std::memory_order_relaxed);
+    }
+
+    bool empty() const {
+        return top.load(std::memory_order_relaxed)
+               >= bottom.load(std::memory_order_relaxed);
+    }
+};
+
+
+/*
+ * thread_pool: worker threads with a work_stealing_deque each.
+ * parallel_for splits its range in halves: a worker pushes the right half
+ * on its own deque and goes on with the left half, an idle worker steals
+ * the oldest, biggest, half from the top of a deque. A worker waiting for
+ * a half to finish runs other tasks meanwhile, so nested parallel_for
+ * calls do not block any thread.
+ * A thread which is not a worker hands its range to the pool and sleeps
+ * until the range is done.
+ * The body must not throw.
+ */
+class thread_pool {
+public:
+    typedef size_t      size_type;
+
+protected:
+    struct task {
+        void            (*run)(task*);
+        std::atomic<bool>   done;
+        task*           next;
+
+        explicit task(void (*run)(task*))
+            :run(run), done(false), next(nullptr)
+        {}
+    };
+
+    struct worker {
+        work_stealing_deque<task*>  tasks;
+        std::thread                 thread;
+        thread_pool*                pool;
+        uint64_t                    seed;
+    };
+
+    template <typename Function>
+    struct range_task : public task {
+        size_type       first;
+        size_type       last;
+        size_type       grain;
+        Function*       body;
+        thread_pool*    pool;
+
+        range_task(size_type first, size_type last, size_type grain,
+                   Function* body, thread_pool* pool)
+            :task(&range_task::execute), first(first), last(last)
+            ,grain(grain), body(body), pool(pool)
+        {}
+
+        static void execute(task* base) {
+            range_task* self = static_cast<range_task*>(base);
+            self->pool->split_and_run(self->first, self->last, self->grain,
+                                      *self->body);
+        }
+    };
+
+    worker*                     workers;
+    size_type                   worker_number;
+
+    // Tasks handed over by threads which are not workers.
+    std::mutex                  lock;
+    std::condition_variable     wakeup;
+    std::condition_variable     finished;
+    task*                       injected;
+    std::atomic<size_type>      injected_number;
+    size_type                   epoch;
+    std::atomic<size_type>      sleeping;
+    std::atomic<bool>           stopping;
+
+public:
+    // 0 threads means one per hardware thread.
+    explicit thread_pool(size_type thread_number=0)
+        :workers(nullptr), worker_number(thread_number), injected(nullptr)
+        ,injected_number(0), epoch(0), sleeping(0), stopping(false)
+    {
+        if (worker_number == 0)
+            worker_number = std::thread::hardware_concurrency();
+        if (worker_number == 0)
+            worker_number = 1;
+        workers = new worker[worker_number];
+        for (size_type i = 0; i < worker_number; ++i) {
+            workers[i].pool = this;
+            workers[i].seed = i * 0x9e3779b97f4a7c15ull + 1;
+        }
+        for (size_type i = 0; i < worker_number; ++i)
+            workers[i].thread = std::thread(&thread_pool::work, this,
+                                            &workers[i]);
+    }
+
+    thread_pool(const thread_pool&) = delete;
+
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping.store(true);
+            ++epoch;
+        }
+        wakeup.notify_all();
+        for (size_type i = 0; i < worker_number; ++i)
+            workers[i].thread.join();
+        delete[] workers;
+    }
+
+    size_type size() const {
+        return worker_number;
+    }
+
+    /*
+     * Call body(begin, end) on pieces of [first, last) of grain elements
+     * or less, in parallel, and return when every piece is done.
+     */
+    template <typename Function>
+    void parallel_for(size_type first, size_type last, size_type grain,
+                      Function body) {
+        if (grain == 0)
+            grain = 1;
+        if (last - first <= grain) {
+            if (first != last)
+                body(first, last);
+            return;
+        }
+
+        worker* self = current_worker();
+        if (self and self->pool == this) {
+            split_and_run(first, last, grain, body);
+            return;
+        }
+
+        range_task<Function> root(first, last, grain, &body, this);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            root.next = injected;
+            injected = &root;
+            injected_number.fetch_add(1);
+            ++epoch;
+        }
+        wakeup.notify_one();
+
+        std::unique_lock<std::mutex> guard(lock);
+        finished.wait(guard, [&root]() {
+            return root.done.load(std::memory_order_acquire);
+        });
+    }
+
+    // The pool of the algorithms with an execution policy, of
+    // STLL_DEFAULT_POOL_THREADS threads.
+    static thread_pool& default_pool() {
+        static thread_pool pool(STLL_DEFAULT_POOL_THREADS);
+        return pool;
+    }
+
+protected:
+    static worker*& current_worker() {
+        thread_local worker* current = nullptr;
+        return current;
+    }
+
+    template <typename Function>
+    void split_and_run(size_type first, size_type last, size_type grain,
+                       Function& body) {
+        worker* self = current_worker();
+        if (last - first <= grain) {
+            body(first, last);
+            return;
+        }
+        size_type middle = first + (last - first) / 2;
+        range_task<Function> right(middle, last, grain, &body, this);
+        self->tasks.push(&right);
+        notify_work();
+        split_and_run(first, middle, grain, body);
+
+        // Run other tasks until right is done, most of the time it is
+        // still on our deque and popped right away.
+        while (!right.done.load(std::memory_order_acquire)) {
+            task* next = nullptr;
+            if (self->tasks.pop(next) or steal(self, next))
+                execute(next);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    void execute(task* current) {
+        current->run(current);
+        current->done.store(true, std::memory_order_release);
+    }
+
+    // A task taken from injected also wakes up its waiting thread.
+    void execute_injected(task* current) {
+        current->run(current);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            current->done.store(true, std::memory_order_release);
+        }
+        finished.notify_all();
+    }
+
+    // Try every other worker once, from a random one.
+    bool steal(worker* self, task*& stolen) {
+        self->seed ^= self->seed << 13;
+        self->seed ^= self->seed >> 7;
+        self->seed ^= self->seed << 17;
+        size_type start = size_type(self->seed % worker_number);
+        for (size_type i = 0; i < worker_number; ++i) {
+            worker& victim = workers[(start + i) % worker_number];
+            if (&victim != self and victim.tasks.steal(stolen))
+                return true;
+        }
+        return false;
+    }
+
+    bool take_injected(task*& taken) {
+        if (injected_number.load() == 0)
+            return false;
+        std::lock_guard<std::mutex> guard(lock);
+        if (injected == nullptr)
+            return false;
+        taken = injected;
+        injected = injected->next;
+        injected_number.fetch_sub(1);
+        return true;
+    }
+
+    bool has_work() const {
+        if (injected_number.load() != 0)
+            return true;
+        for (size_type i = 0; i < worker_number; ++i) {
+            if (!workers[i].tasks.empty())
+                return true;
+        }
+        return false;
+    }
+
+    // Called after a push, wakes a sleeping worker to steal the task.
+    void notify_work() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load() == 0)
+            return;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            ++epoch;
+        }
+        wakeup.notify_one();
+    }
+
+    /*
+     * A worker announces that it goes to sleep before it looks for work a
+     * last time, and a pusher looks for sleepers after its push; with a
+     * fence between the store and the load on both sides, one of them
+     * sees the other. A pusher which sees the sleeper moves epoch on
+     * under the lock, and injected tasks and the destructor always do, so
+     * the worker sleeps until then without polling.
+     */
+    void wait_for_work() {
+        std::unique_lock<std::mutex> guard(lock);
+        size_type seen = epoch;
+        sleeping.fetch_add(1);
+        guard.unlock();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!has_work() and !stopping.load()) {
+            guard.lock();
+            wakeup.wait(guard, [this, seen]() {
+                return stopping.load() or epoch != seen;
+            });
+            guard.unlock();
+        }
+        sleeping.fetch_sub(1);
+    }
+
+    void work(worker* self) {
+        current_worker() = self;
+        const int spin_count = 64;
+        int idle = 0;
+        while (!stopping.load(std::memory_order_relaxed)) {
+            task* next = nullptr;
+            if (self->tasks.pop(next) or steal(self, next)) {
+                execute(next);
+                idle = 0;
+            } else if (take_injected(next)) {
+                execute_injected(next);
+                idle = 0;
+            } else if (++idle < spin_count) {
+                std::this_thread::yield();
+            } else {
+                wait_for_work();
+                idle = 0;
+            }
+        }
+        current_worker() = nullptr;
+    }
+};
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,211 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <cstdint>
+
+#include "intrusive_list.hpp"
+
+__STLL_NAMESPACE_START__
+
+struct timer_wheel_tag {};
+
+/*
+ * Hook of timer_wheel, a timer object derives from it. The wheel keeps
+ * the deadline and the slot the timer is linked in, so cancel is O(1).
+ */
+struct timer_wheel_hook : public list_base_hook<timer_wheel_tag> {
+    uint64_t    deadline;
+    uint32_t    slot;
+
+    timer_wheel_hook()
+        :deadline(0), slot(0)
+    {}
+
+    bool is_scheduled() const {
+        return is_linked();
+    }
+};
+
+
+/*
+ * timer_wheel: a hierarchical timing wheel, Levels wheels of 2^SlotBits
+ * slots each. Level l covers deadlines which differ from the current tick
+ * only in the l-th group of SlotBits bits, a slot is an intrusive list.
+ *
+ * schedule, cancel and reschedule are O(1): the slot is found from the
+ * deadline with a few shifts. When the current tick reaches a slot of an
+ * upper level, its timers cascade down to the lower levels, so a timer
+ * moves at most Levels times. Deadlines beyond the last level wait in an
+ * overflow list.
+ *
+ * Ticks are in the caller's unit. advance(now, callback) expires every
+ * timer due at or before now, in deadline order, and calls
+ * callback(Timer&) for each of them. The timer is already unlinked, so
+ * the callback may reschedule it, or cancel any other timer.
+ *
+ * Timer must derive from timer_wheel_hook. The wheel does not own the
+ * timers, a timer must be cancelled before it is destroyed.
+ */
+template <typename Timer, size_t SlotBits=8, size_t Levels=4>
+class timer_wheel {
+public:
+    typedef Timer           value_type;
+    typedef uint64_t        tick_type;
+    typedef size_t          size_type;
+
+    typedef timer_wheel<Timer, SlotBits, Levels>    self;
+
+protected:
+    static_assert(SlotBits * Levels < 64, "too many wheel bits");
+
+    enum {SLOT_NUMBER = size_t(1) << SlotBits};
+    enum {OVERFLOW_SLOT = SLOT_NUMBER * Levels};
+    enum {EXPIRING_SLOT = OVERFLOW_SLOT + 1};
+
+    typedef intrusive_list<Timer,
+                           base_hook<Timer, list_base_hook<timer_wheel_tag>>>
+            slot_type;
+
+    // Every level, then the overflow list, then the timers being expired.
+    slot_type   slots[EXPIRING_SLOT + 1];
+    tick_type   current;
+    size_type   length;
+
+public:
+    // Ticks before now are considered expired.
+    explicit timer_wheel(tick_type now=0)
+        :current(now), length(0)
+    {}
+
+    timer_wheel(const self&) = delete;
+
+    self& operator=(const self&) = delete;
+
+    ~timer_wheel() {
+        clear();
+    }
+
+    size_type size() const {
+        return length;
+    }
+
+    bool empty() const {
+        return length == 0;
+    }
+
+    // The first tick which has not been expired yet.
+    tick_type next_tick() const {
+        return current;
+    }
+
+    // Arm timer for deadline, or move it if it is already scheduled.
+    // A deadline in the past expires on the next advance.
+    void schedule(Timer& timer, tick_type deadline) {
+        timer_wheel_hook& hook = timer;
+        if (hook.is_scheduled())
+            cancel(timer);
+        hook.deadline = deadline < current ? current : deadline;
+        link(timer);
+        ++length;
+    }
+
+    void reschedule(Timer& timer, tick_type deadline) {
+        schedule(timer, deadline);
+    }
+
+    // Disarm timer, nothing happens if it is not scheduled.
+    void cancel(Timer& timer) {
+        timer_wheel_hook& hook = timer;
+        if (!hook.is_scheduled())
+            return;
+        slots[hook.slot].erase(timer);
+        --length;
+    }
+
+    // Expire every timer due at or before now, return how many expired.
+    template <typename Callback>
+    size_type advance(tick_type now, Callback callback) {
+        size_type expired = 0;
+        slot_type& expiring = slots[EXPIRING_SLOT];
+        while (current <= now) {
+            if (length == 0) {
+                current = now + 1;
+                break;
+            }
+            cascade();
+            expiring.splice(expiring.end(), slots[current & (SLOT_NUMBER - 1)]);
+            for (Timer& timer : expiring)
+                static_cast<timer_wheel_hook&>(timer).slot = EXPIRING_SLOT;
+            ++current;
+
+            while (!expiring.empty()) {
+                Timer& timer = expiring.front();
+                expiring.pop_front();
+                --length;
+                ++expired;
+                callback(timer);
+            }
+        }
+        return expired;
+    }
+
+    // Unlink every timer without calling anything.
+    void clear() {
+        for (size_t i = 0; i <= EXPIRING_SLOT; ++i)
+            slots[i].clear();
+        length = 0;
+    }
+
+protected:
+    static tick_type level_span(size_t level) {
+        return tick_type(1) << (SlotBits * level);
+    }
+
+    // Put timer in the slot of the lowest level where its deadline and
+    // current only differ in that level's bits.
+    void link(Timer& timer) {
+        timer_wheel_hook& hook = timer;
+        tick_type diff = hook.deadline ^ current;
+        size_t slot = OVERFLOW_SLOT;
+        for (size_t level = 0; level < Levels; ++level) {
+            if (diff < level_span(level + 1)) {
+                slot = level * SLOT_NUMBER
+                       + ((hook.deadline >> (SlotBits * level))
+                          & (SLOT_NUMBER - 1));
+                break;
+            }
+        }
+        hook.slot = uint32_t(slot);
+        slots[slot].push_back(timer);
+    }
+
+    // Re-link the timers of slot, each one goes to a lower level.
+    void relink(size_t slot) {
+        slot_type pending;
+        pending.splice(pending.end(), slots[slot]);
+        while (!pending.empty()) {
+            Timer& timer = pending.front();
+            pending.pop_front();
+            link(timer);
+        }
+    }
+
+    // When the low bits of current wrap to zero, the slot of the upper
+    // level that current now points to is due, and is spread over the
+    // lower levels. The highest level goes first, since it can refill a
+    // slot of a lower level which is cascaded at the same tick.
+    void cascade() {
+        if ((current & (level_span(Levels) - 1)) == 0)
+            relink(OVERFLOW_SLOT);
+        for (size_t level = Levels - 1; level > 0; --level) {
+            if ((current & (level_span(level) - 1)) != 0)
+                continue;
+            relink(level * SLOT_NUMBER
+                   + ((current >> (SlotBits * level)) & (SLOT_NUMBER - 1)));
+        }
+    }
+};
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // TIMER_WHEEL_HPP
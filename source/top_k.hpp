@@ -0,0 +1,182 @@
+#ifndef TOP_K_HPP
+#define TOP_K_HPP
+
+#include <thread>
+
+#include "vector.hpp"
+#include "heap.hpp"
+#include "functor.hpp"
+#include "move.hpp"
+
+__STLL_NAMESPACE_START__
+
+/*
+ * top_k: a streaming accumulator of the k greatest elements under Compare.
+ * The kept elements form a heap whose top is the smallest of them, so a
+ * new element is compared once with that threshold, and only replaces it
+ * in O(log k) if it is greater: n elements cost O(n log k) time and O(k)
+ * memory, whatever n is.
+ * Accumulators filled separately, for example by several threads, are
+ * combined with merge().
+ */
+template <typename Tp, typename Compare=less<Tp>>
+class top_k {
+public:
+    typedef Tp                  value_type;
+    typedef const Tp&           const_reference;
+    typedef size_t              size_type;
+    typedef ptrdiff_t           difference_type;
+    typedef Compare             value_compare;
+
+    typedef top_k<Tp, Compare>  self;
+
+protected:
+    // Reversed order, the heap keeps the smallest element on top.
+    struct threshold_compare {
+        Compare comp;
+
+        threshold_compare(const Compare& comp)
+            :comp(comp)
+        {}
+
+        bool operator()(const Tp& lhs, const Tp& rhs) const {
+            return comp(rhs, lhs);
+        }
+    };
+
+    vector<Tp>          heap;
+    size_type           limit;
+    threshold_compare   comp;
+
+public:
+    explicit top_k(size_type k, const Compare& comp=Compare())
+        :heap(), limit(k), comp(comp)
+    {
+        heap.reserve(k);
+    }
+
+    size_type size() const {
+        return heap.size();
+    }
+
+    bool empty() const {
+        return heap.empty();
+    }
+
+    // The k of top_k.
+    size_type capacity() const {
+        return limit;
+    }
+
+    bool full() const {
+        return heap.size() == limit;
+    }
+
+    // The smallest kept element, a new element must be greater than it to
+    // get in once the accumulator is full.
+    const_reference threshold() const {
+        return heap.front();
+    }
+
+    void push(const value_type& value) {
+        if (heap.size() < limit) {
+            heap.push_back(value);
+            STLL_NAMESPACE::push_heap(heap.begin(), heap.end(), comp);
+        } else if (limit != 0 and comp.comp(heap.front(), value)) {
+            __adjust_heap<2>(heap.begin(), difference_type(0),
+                             difference_type(heap.size()), value_type(value),
+                             comp);
+        }
+    }
+
+    template <typename InputIterator>
+    void push_range(InputIterator first, InputIterator last) {
+        for (; first != last; ++first)
+            push(*first);
+    }
+
+    // Add the elements kept by other, which stays unchanged.
+    void merge(const self& other) {
+        push_range(other.heap.cbegin(), other.heap.cend());
+    }
+
+    // Write the kept elements to out, greatest first, empty the
+    // accumulator and return the end of out.
+    template <typename OutputIterator>
+    OutputIterator extract(OutputIterator out) {
+        STLL_NAMESPACE::sort_heap(heap.begin(), heap.end(), comp);
+        for (Tp* iter = heap.begin(); iter != heap.end(); ++iter, ++out)
+            *out = STLL_NAMESPACE::move(*iter);
+        heap.clear();
+        return out;
+    }
+
+    void clear() {
+        heap.clear();
+    }
+};
+
+
+/*
+ * Write the k greatest elements of [first, last) to out, greatest first,
+ * and return the end of out. The range is split between thread_number
+ * threads, 0 means one per hardware thread, each one fills its own top_k
+ * and the partial results are merged at the end.
+ */
+template <typename RandomAcessIterator, typename OutputIterator,
+          typename Compare>
+OutputIterator parallel_top_k(RandomAcessIterator first,
+                              RandomAcessIterator last, size_t k,
+                              OutputIterator out, const Compare& comp,
+                              size_t thread_number=0) {
+    typedef typename iterator_traits<RandomAcessIterator>::difference_type
+            Distance;
+    typedef typename iterator_traits<RandomAcessIterator>::value_type
+            Tp;
+    // Below this many elements per thread, a thread costs more than it
+    // saves.
+    const Distance min_chunk = 4096;
+
+    if (thread_number == 0)
+        thread_number = std::thread::hardware_concurrency();
+    Distance len = last - first;
+    if (Distance(thread_number) > len / min_chunk)
+        thread_number = size_t(len / min_chunk);
+    if (thread_number == 0)
+        thread_number = 1;
+
+    vector<top_k<Tp, Compare>> partial;
+    partial.reserve(thread_number);
+    for (size_t i = 0; i < thread_number; ++i)
+        partial.emplace_back(k, comp);
+
+    vector<std::thread> threads;
+    threads.reserve(thread_number);
+    for (size_t i = 1; i < thread_number; ++i) {
+        RandomAcessIterator chunk_first = first + len * i / thread_number;
+        RandomAcessIterator chunk_last = first + len * (i + 1) / thread_number;
+        top_k<Tp, Compare>* result = &partial[i];
+        threads.emplace_back([=]() {
+            result->push_range(chunk_first, chunk_last);
+        });
+    }
+    partial[0].push_range(first, first + len / thread_number);
+
+    for (size_t i = 1; i < thread_number; ++i) {
+        threads[i - 1].join();
+        partial[0].merge(partial[i]);
+    }
+    return partial[0].extract(out);
+}
+
+template <typename RandomAcessIterator, typename OutputIterator>
+inline OutputIterator parallel_top_k(RandomAcessIterator first,
+                                     RandomAcessIterator last, size_t k,
+                                     OutputIterator out) {
+    typedef typename iterator_traits<RandomAcessIterator>::value_type Tp;
+    return STLL_NAMESPACE::parallel_top_k(first, last, k, out, less<Tp>());
+}
+
+__STLL_NAMESPACE_FINISH__
+
+#endif // TOP_K_HPP
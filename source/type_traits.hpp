@@ -191,6 +191,24 @@ struct remove_reference<Tp&> { using type = Tp; };
 template <class Tp>
 struct remove_reference<Tp&&> { using type = Tp; };
 
+template <class Tp>
+struct remove_const { using type = Tp; };
+
+template <class Tp>
+struct remove_const<const Tp> { using type = Tp; };
+
+// type is Tp if Condition holds, else there is no type and a template
+// using it drops out of overload resolution.
+template <bool Condition, class Tp = void>
+struct enable_if {};
+
+template <class Tp>
+struct enable_if<true, Tp> { using type = Tp; };
+
+// A Tp&& for use in decltype only, never defined.
+template <class Tp>
+Tp&& declval();
+
 
 __STLL_NAMESPACE_FINISH__
 
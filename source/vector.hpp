@@ -8,6 +8,7 @@
 #include "allocator.hpp"
 #include "iterator.hpp"
 #include "memory.hpp"
+#include "span.hpp"
 
 __STLL_NAMESPACE_START__
 
@@ -25,25 +26,37 @@ class vector {
   typedef pointer iterator;
   typedef const_pointer const_iterator;
   typedef Alloc alloc;
+  typedef Alloc allocator_type;
 
   typedef vector<Tp, Alloc> self;
 
  public:
-  vector() : start(nullptr), finish(nullptr), end_of_storage(nullptr) {}
+  vector()
+      : data_allocator(), start(nullptr), finish(nullptr),
+        end_of_storage(nullptr) {}
 
-  vector(size_type size) {
-    start = alloc::allocate(size);
+  explicit vector(const Alloc& allocator)
+      : data_allocator(allocator), start(nullptr), finish(nullptr),
+        end_of_storage(nullptr) {}
+
+  vector(size_type size, const Alloc& allocator = Alloc())
+      : data_allocator(allocator) {
+    start = data_allocator.allocate(size);
     finish = end_of_storage = start + size;
     uninitialized_fill(start, finish, Tp());
   }
 
-  vector(size_type size, const value_type& value) {
-    start = alloc::allocate(size);
+  vector(size_type size, const value_type& value,
+         const Alloc& allocator = Alloc())
+      : data_allocator(allocator) {
+    start = data_allocator.allocate(size);
     finish = end_of_storage = start + size;
     uninitialized_fill(start, finish, value);
   }
 
-  vector(const std::initializer_list<value_type>& value_list) : vector() {
+  vector(const std::initializer_list<value_type>& value_list,
+         const Alloc& allocator = Alloc())
+      : vector(allocator) {
     reserve(value_list.size());
     for (const value_type& value : value_list) {
       construct(finish, value);
@@ -51,20 +64,26 @@ class vector {
     }
   }
 
+  // A copy of the elements of a view, e.g. a slice of another vector.
+  explicit vector(span<const Tp> values, const Alloc& allocator = Alloc())
+      : vector(values.begin(), values.end(), allocator) {}
+
   template <class InputIterator>
-  vector(InputIterator first, InputIterator last) {
+  vector(InputIterator first, InputIterator last,
+         const Alloc& allocator = Alloc())
+      : vector(allocator) {
     typedef typename iterator_traits<InputIterator>::iterator_category category;
     construct_from_range(first, last, category());
   }
 
-  vector(const self& vec) {
+  vector(const self& vec) : data_allocator(vec.data_allocator) {
     size_type size = vec.size();
-    start = alloc::allocate(size);
+    start = data_allocator.allocate(size);
     finish = end_of_storage = start + size;
-    copy(vec.begin(), vec.end(), start);
+    STLL_NAMESPACE::uninitialized_copy(vec.cbegin(), vec.cend(), start);
   }
 
-  vector(self&& vec) {
+  vector(self&& vec) : data_allocator(vec.data_allocator) {
     start = vec.start;
     finish = vec.finish;
     end_of_storage = vec.end_of_storage;
@@ -72,27 +91,36 @@ class vector {
   }
 
   self& operator=(const self& vec) {
-    if (vec.size() > capacity()) {
-      extend_capacity(vec.size());
-    }
+    if (this == &vec) return *this;
     clear();
-    copy(vec.begin(), vec.end(), start);
-    finish = start + vec.size();
+    reserve(vec.size());
+    finish =
+        STLL_NAMESPACE::uninitialized_copy(vec.cbegin(), vec.cend(), start);
+    return *this;
   }
 
+  // The storage of vec is taken with its allocator.
   self& operator=(self&& vec) {
+    if (this == &vec) return *this;
+    release();
+    data_allocator = vec.data_allocator;
     start = vec.start;
     finish = vec.finish;
     end_of_storage = vec.end_of_storage;
 
     vec.start = vec.finish = vec.end_of_storage = nullptr;
+    return *this;
   }
 
-  ~vector() {
-    if (start) {
-      alloc::deallocate(start, capacity());
-    }
-    end_of_storage = finish = start = nullptr;
+  ~vector() { release(); }
+
+  Alloc get_allocator() const { return data_allocator; }
+
+  void swap(self& vec) {
+    STLL_NAMESPACE::swap(data_allocator, vec.data_allocator);
+    STLL_NAMESPACE::swap(start, vec.start);
+    STLL_NAMESPACE::swap(finish, vec.finish);
+    STLL_NAMESPACE::swap(end_of_storage, vec.end_of_storage);
   }
 
   bool empty() const { return finish == start; }
@@ -101,6 +129,8 @@ class vector {
 
   size_type capacity() const { return end_of_storage - start; }
 
+  const Tp* data() const { return start; }
+
   const_iterator cbegin() const { return start; }
 
   const_iterator cend() const { return finish; }
@@ -119,10 +149,12 @@ class vector {
   void reserve(size_type size) { extend_capacity(size); }
 
   void clear() {
-    destroy(start, finish);
+    STLL_NAMESPACE::destroy(start, finish);
     finish = start;
   }
 
+  Tp* data() { return start; }
+
   iterator begin() { return start; }
 
   iterator end() { return finish; }
@@ -144,7 +176,7 @@ class vector {
   template <class... Args>
   void emplace_back(Args... args) {
     if (!(capacity() > size())) extend_capacity();
-    construct(finish, forward<Args>(args)...);
+    construct(finish, STLL_NAMESPACE::forward<Args>(args)...);
     ++finish;
   }
 
@@ -182,9 +214,17 @@ class vector {
   void shrink_to_fit() {
     if (size() == capacity()) return;
     size_type old_size = size();
-    iterator new_start = alloc::allocate(size());
-    copy(begin(), end(), new_start);
-    alloc::deallocate(start, capacity());
+    if (old_size == 0) {
+      release();
+      return;
+    }
+    iterator new_start = data_allocator.allocate(old_size);
+
+    // As in extend_capacity, the elements are move constructed.
+    for (size_type i = 0; i < old_size; ++i)
+      construct(new_start + i, STLL_NAMESPACE::move(start[i]));
+    STLL_NAMESPACE::destroy(start, finish);
+    data_allocator.deallocate(start, capacity());
     start = new_start;
     end_of_storage = finish = start + old_size;
   }
@@ -193,9 +233,7 @@ class vector {
   template <class InputIterator>
   void construct_from_range(InputIterator first, InputIterator last,
                             input_iterator_tag) {
-    while (first != last) {
-      push_back(*first);
-    }
+    for (; first != last; ++first) push_back(*first);
   }
 
   template <class RandomAcessIterator>
@@ -204,9 +242,18 @@ class vector {
     typedef
         typename iterator_traits<RandomAcessIterator>::difference_type Distance;
     Distance size = last - first;
-    start = alloc::allocate(size);
+    start = data_allocator.allocate(size);
     end_of_storage = finish = start + size;
-    copy(first, last, start);
+    STLL_NAMESPACE::uninitialized_copy(first, last, start);
+  }
+
+  // Destroy the elements and give the storage back.
+  void release() {
+    if (start) {
+      STLL_NAMESPACE::destroy(start, finish);
+      data_allocator.deallocate(start, capacity());
+    }
+    end_of_storage = finish = start = nullptr;
   }
 
   // Extend vector's capacity to cap.
@@ -217,17 +264,19 @@ class vector {
 
     if (capacity() > cap || cap <= this->size()) return;
 
-    size_type old_cap = capacity();
-    iterator new_start = alloc::allocate(cap);
+    size_type old_size = size();
+    iterator new_start = data_allocator.allocate(cap);
 
-    move(start, finish, new_start);
+    // The new storage is raw memory, so the elements are move constructed.
+    for (size_type i = 0; i < old_size; ++i)
+      construct(new_start + i, STLL_NAMESPACE::move(start[i]));
     if (start) {
-      destroy(start, finish);
-      alloc::deallocate(start, finish - start);
+      STLL_NAMESPACE::destroy(start, finish);
+      data_allocator.deallocate(start, capacity());
     }
 
     start = new_start;
-    finish = start + old_cap;
+    finish = start + old_size;
     end_of_storage = start + cap;
   }
 
@@ -241,6 +290,7 @@ class vector {
   }
 
  protected:
+  Alloc data_allocator;
   iterator start;
   iterator finish;
   iterator end_of_storage;
@@ -255,6 +305,10 @@ const vector<T, Alloc>& vec2) {
 }
 */
 
+// A vector whose data starts on a cache line, see aligned_allocator.
+template <class Tp>
+using cache_aligned_vector = vector<Tp, aligned_allocator<Tp, CACHE_LINE_SIZE>>;
+
 __STLL_NAMESPACE_FINISH__
 
 #endif  // VECTOR_HPP
\ No newline at end of file